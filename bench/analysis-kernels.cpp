@@ -0,0 +1,156 @@
+// Times the vectorized analysis kernels against the plain loops they fall back to, on synthetic analyses.
+// Usage: bench-analysis-kernels [segments] [repetitions]
+
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "analysis-kernels.hpp"
+#include "bench.hpp"
+
+using namespace spotify_api;
+
+// About the size of a 20 minute track; real analyses have 3 to 4 segments per second
+static columnar_analysis_t make_analysis(size_t segment_count)
+{
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	columnar_analysis_t analysis;
+	columnar_analysis_t::segment_columns_t &segments = analysis.segments;
+
+	float time = 0.0f;
+	for (size_t i = 0; i < segment_count; i++)
+	{
+		float duration = 0.1f + 0.4f * unit(random);
+		segments.start.push_back(time);
+		segments.duration.push_back(duration);
+		segments.confidence.push_back(unit(random));
+		segments.loudness_start.push_back(-60.0f * unit(random));
+		segments.loudness_max.push_back(-30.0f * unit(random));
+		segments.loudness_max_time.push_back(duration * unit(random));
+		segments.loudness_end.push_back(-60.0f * unit(random));
+
+		columnar_analysis_t::vector_row_t pitches, timbre;
+		for (size_t j = 0; j < columnar_analysis_t::vector_size; j++)
+		{
+			pitches[j] = unit(random);
+			timbre[j] = 200.0f * unit(random) - 100.0f;
+		}
+		segments.pitches.push_back(pitches);
+		segments.timbre.push_back(timbre);
+		time += duration;
+	}
+
+	// Beats of half a second, bars of four beats
+	for (float start = 0.0f; start < time; start += 0.5f)
+	{
+		analysis.beats.start.push_back(start);
+		analysis.beats.duration.push_back(0.5f);
+		analysis.beats.confidence.push_back(1.0f);
+	}
+	for (float start = 0.0f; start < time; start += 2.0f)
+	{
+		analysis.bars.start.push_back(start);
+		analysis.bars.duration.push_back(2.0f);
+		analysis.bars.confidence.push_back(1.0f);
+	}
+	analysis.duration = time;
+	return analysis;
+}
+
+struct results_t
+{
+	std::vector<float> loudness_per_beat;
+	std::vector<columnar_analysis_t::vector_row_t> pitches_per_bar;
+	std::vector<float> curve;
+	std::vector<float> distances;
+	std::vector<float> bounded;
+};
+
+static float max_difference(const std::vector<float> &lhs, const std::vector<float> &rhs)
+{
+	float difference = 0.0f;
+	for (size_t i = 0; i < lhs.size() && i < rhs.size(); i++)
+	{
+		// Rows outside the bounds are infinite in both
+		if (std::isinf(lhs[i]) && std::isinf(rhs[i])) continue;
+		difference = std::max(difference, std::abs(lhs[i] - rhs[i]) / std::max(1.0f, std::abs(rhs[i])));
+	}
+	return difference;
+}
+
+static results_t run(const columnar_analysis_t &analysis, int repetitions)
+{
+	const auto &segments = analysis.segments;
+	auto beats = analysis_kernels::segments_per_interval(segments, analysis.beats);
+	auto bars = analysis_kernels::segments_per_interval(segments, analysis.bars);
+	columnar_analysis_t::vector_row_t query = segments.timbre[segments.size() / 2];
+
+	columnar_analysis_t::vector_row_t lower, upper, target, weights;
+	lower.fill(-50.0f);
+	upper.fill(50.0f);
+	target.fill(0.0f);
+	weights.fill(1.0f);
+
+	// Every kernel is run many times per repetition, since one pass over a single analysis takes microseconds
+	constexpr int passes = 200;
+	results_t results;
+	double mean = bench::best_of(repetitions, [&] {
+		for (int i = 0; i < passes; i++) results.loudness_per_beat = analysis_kernels::mean_per_interval(segments.loudness_max, beats);
+	});
+	double mean_rows = bench::best_of(repetitions, [&] {
+		for (int i = 0; i < passes; i++) results.pitches_per_bar = analysis_kernels::mean_rows_per_interval(segments.pitches, bars);
+	});
+	double curve = bench::best_of(repetitions, [&] {
+		for (int i = 0; i < passes; i++) results.curve = analysis_kernels::loudness_curve(segments, 0.0f, 0.01f, static_cast<size_t>(analysis.duration * 100));
+	});
+	double distances = bench::best_of(repetitions, [&] {
+		for (int i = 0; i < passes; i++) results.distances = analysis_kernels::distances(query, segments.timbre);
+	});
+	results.bounded.resize(segments.size());
+	double bounded = bench::best_of(repetitions, [&] {
+		for (int i = 0; i < passes; i++) analysis_kernels::bounded_distances(lower, upper, target, weights, segments.timbre, results.bounded);
+	});
+	bench::keep(results);
+
+	std::printf("%-8s mean_per_interval %8.2f ms  mean_rows_per_interval %8.2f ms  loudness_curve %8.2f ms  distances %8.2f ms  bounded_distances %8.2f ms\n",
+		std::string(analysis_kernels::instruction_set()).c_str(), mean, mean_rows, curve, distances, bounded);
+	return results;
+}
+
+int main(int argc, char **argv)
+{
+	size_t segment_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4000;
+	int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+
+	columnar_analysis_t analysis = make_analysis(segment_count);
+	std::printf("%zu segments, %zu beats, %zu bars, best of %d runs of 200 passes\n", analysis.segments.size(), analysis.beats.size(), analysis.bars.size(), repetitions);
+
+	std::string vectorized(analysis_kernels::instruction_set());
+	results_t fast = run(analysis, repetitions);
+	if (vectorized == "scalar")
+	{
+		std::printf("No vectorized kernels on this CPU\n");
+		return 0;
+	}
+
+	analysis_kernels::use_instruction_set("scalar");
+	results_t scalar = run(analysis, repetitions);
+
+	std::vector<float> fast_rows, scalar_rows;
+	for (const auto &row : fast.pitches_per_bar) fast_rows.insert(fast_rows.end(), row.begin(), row.end());
+	for (const auto &row : scalar.pitches_per_bar) scalar_rows.insert(scalar_rows.end(), row.begin(), row.end());
+
+	// The vectorized sums add in a different order, so the results only match up to rounding
+	float difference = std::max({
+		max_difference(fast.loudness_per_beat, scalar.loudness_per_beat),
+		max_difference(fast_rows, scalar_rows),
+		max_difference(fast.curve, scalar.curve),
+		max_difference(fast.distances, scalar.distances),
+		max_difference(fast.bounded, scalar.bounded)
+	});
+	std::printf("Largest relative difference between %s and scalar: %g\n", vectorized.c_str(), difference);
+	return difference < 1e-3f ? 0 : 1;
+}
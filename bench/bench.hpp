@@ -0,0 +1,40 @@
+#pragma once
+#ifndef _SPOTIFY_API_BENCH_
+#define _SPOTIFY_API_BENCH_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+
+namespace bench
+{
+
+/**
+ * @brief Runs `body` a few times and returns the fastest run, in milliseconds.
+ * The fastest run is the one least disturbed by the rest of the system.
+ */
+template <class Body>
+double best_of(int repetitions, Body &&body)
+{
+	double best = std::numeric_limits<double>::infinity();
+	for (int i = 0; i < repetitions; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		body();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count());
+	}
+	return best;
+}
+
+/// Keeps the compiler from optimizing away a result that is otherwise unused.
+template <class T>
+void keep(const T &value)
+{
+	asm volatile("" : : "r"(&value) : "memory");
+}
+
+} // namespace bench
+
+#endif
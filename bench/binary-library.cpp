@@ -0,0 +1,97 @@
+// Compares loading a library of tracks from json with opening the same tracks as a binary library file.
+// Usage: bench-binary-library [tracks] [repetitions]
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "binary-library.hpp"
+#include "bench.hpp"
+#include "synthetic.hpp"
+
+using namespace spotify_api;
+
+static std::string read_text(const std::filesystem::path &path)
+{
+	std::ifstream file(path, std::ios::binary);
+	std::ostringstream text;
+	text << file.rdbuf();
+	return text.str();
+}
+
+int main(int argc, char **argv)
+{
+	size_t track_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+	int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path();
+	std::filesystem::path json_path = directory / "spotify-api-bench-library.json";
+	std::filesystem::path library_path = directory / "spotify-api-bench-library.bin";
+
+	// The same tracks are saved both ways first, so each run below starts from a file
+	{
+		nlohmann::json tracks = nlohmann::json::array();
+		for (size_t i = 0; i < track_count; i++) tracks.push_back(bench::synthetic_track(i));
+		std::ofstream(json_path, std::ios::binary) << tracks.dump();
+
+		binary_library_writer_t writer;
+		for (const auto &track : tracks) writer.add(*track_t::from_json(track));
+		if (!writer.write(library_path.string()))
+		{
+			std::fprintf(stderr, "Could not write %s\n", library_path.string().c_str());
+			return 1;
+		}
+	}
+
+	size_t json_checksum = 0;
+	double json_time = bench::best_of(repetitions, [&] {
+		nlohmann::json tracks = nlohmann::json::parse(read_text(json_path));
+		std::vector<std::unique_ptr<track_t>> decoded;
+		decoded.reserve(tracks.size());
+		for (const auto &track : tracks) decoded.push_back(track_t::from_json(track));
+
+		json_checksum = 0;
+		for (const auto &track : decoded)
+		{
+			json_checksum += track->name.size() + track->album->name.size() + track->artists.size() + track->external_ids.size();
+		}
+	});
+
+	// Every track is read in full through the views, so the comparison includes the work opening defers
+	uint32_t version = 0;
+	size_t binary_checksum = 0;
+	double binary_time = bench::best_of(repetitions, [&] {
+		auto library = binary_library_t::open(library_path.string());
+		if (!library) return;
+		version = library->version();
+
+		binary_checksum = 0;
+		for (size_t i = 0; i < library->track_count(); i++)
+		{
+			track_view_t track = library->track(i);
+			auto album = track.album();
+			binary_checksum += track.name().size() + (album ? album->name().size() : 0) + track.artists().size() + track.external_ids().size();
+			for (artist_view_t artist : track.artists()) bench::keep(artist.name());
+			bench::keep(track.available_markets());
+		}
+	});
+
+	std::printf("%zu tracks, best of %d runs\n", track_count, repetitions);
+	std::printf("json:   %10.2f ms  %10ju bytes  (parse and decode every track)\n", json_time, static_cast<uintmax_t>(std::filesystem::file_size(json_path)));
+	std::printf("binary: %10.2f ms  %10ju bytes  (open format %u.%u and read every track through views)\n", binary_time,
+		static_cast<uintmax_t>(std::filesystem::file_size(library_path)), version >> 16, version & 0xFFFF);
+
+	std::filesystem::remove(json_path);
+	std::filesystem::remove(library_path);
+
+	if (json_checksum != binary_checksum)
+	{
+		std::fprintf(stderr, "The two loads read different data\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,93 @@
+// Counts the heap allocations made while decoding a page of tracks, with and without a memory resource.
+// Usage: bench-decode-allocations [pages] [repetitions]
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+
+#include "categories/tracks.hpp"
+#include "entity-store.hpp"
+#include "bench.hpp"
+#include "synthetic.hpp"
+
+using namespace spotify_api;
+
+static std::atomic<size_t> allocations{0};
+
+void *operator new(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void *pointer = std::malloc(size == 0 ? 1 : size)) return pointer;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { std::free(pointer); }
+
+static nlohmann::json synthetic_page(size_t page)
+{
+	nlohmann::json items = nlohmann::json::array();
+	for (size_t i = 0; i < 50; i++) items.push_back(bench::synthetic_track(page * 50 + i));
+	return {
+		{"href", "https://api.spotify.com/v1/me/tracks?offset=" + std::to_string(page * 50) + "&limit=50"},
+		{"items", items},
+		{"limit", 50},
+		{"next", nullptr},
+		{"offset", page * 50},
+		{"previous", nullptr},
+		{"total", 50}
+	};
+}
+
+struct result_t
+{
+	double allocations_per_page;
+	double milliseconds_per_page;
+};
+
+// Decodes every page and throws it away again, counting what that allocated
+template<class Decode>
+static result_t measure(const std::vector<nlohmann::json> &pages, int repetitions, Decode &&decode)
+{
+	size_t counted = 0;
+	double time = bench::best_of(repetitions, [&] {
+		size_t before = allocations.load(std::memory_order_relaxed);
+		for (const auto &page : pages) decode(page);
+		counted = allocations.load(std::memory_order_relaxed) - before;
+	});
+	return result_t{static_cast<double>(counted) / pages.size(), time / pages.size()};
+}
+
+int main(int argc, char **argv)
+{
+	size_t page_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20;
+	int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+
+	std::vector<nlohmann::json> pages;
+	for (size_t i = 0; i < page_count; i++) pages.push_back(synthetic_page(i));
+
+	result_t heap = measure(pages, repetitions, [](const nlohmann::json &page) {
+		bench::keep(page_t<std::shared_ptr<track_t>>::from_json(page));
+	});
+
+	result_t arena = measure(pages, repetitions, [](const nlohmann::json &page) {
+		std::pmr::monotonic_buffer_resource resource;
+		bench::keep(page_t<std::shared_ptr<track_t>>::from_json(page, &resource));
+	});
+
+	// Albums and artists shared by several tracks of the page are decoded once
+	result_t shared = measure(pages, repetitions, [](const nlohmann::json &page) {
+		std::pmr::monotonic_buffer_resource resource;
+		entity_store_t store;
+		bench::keep(page_t<std::shared_ptr<track_t>>::from_json(page, decode_context_t{&resource, &store}));
+	});
+
+	std::printf("%zu pages of 50 tracks, best of %d runs\n", page_count, repetitions);
+	std::printf("%-24s %12s %12s\n", "", "allocations", "ms");
+	std::printf("%-24s %12.0f %12.3f\n", "heap", heap.allocations_per_page, heap.milliseconds_per_page);
+	std::printf("%-24s %12.0f %12.3f\n", "memory resource", arena.allocations_per_page, arena.milliseconds_per_page);
+	std::printf("%-24s %12.0f %12.3f\n", "memory resource + store", shared.allocations_per_page, shared.milliseconds_per_page);
+	return 0;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#ifndef _SPOTIFY_API_BENCH_SYNTHETIC_
+#define _SPOTIFY_API_BENCH_SYNTHETIC_
+
+#include <cstddef>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "categories/ids.hpp"
+
+namespace bench
+{
+
+inline std::string synthetic_id(uint64_t kind, size_t index)
+{
+	return spotify_api::spotify_id_t(kind, index + 1).to_string();
+}
+
+inline nlohmann::json synthetic_object(const char *type, const std::string &id, const std::string &name)
+{
+	return {
+		{"external_urls", {{"spotify", std::string("https://open.spotify.com/") + type + "/" + id}}},
+		{"href", std::string("https://api.spotify.com/v1/") + type + "s/" + id},
+		{"id", id},
+		{"name", name},
+		{"type", type},
+		{"uri", std::string("spotify:") + type + ":" + id}
+	};
+}
+
+/**
+ * @brief A full track object shaped like the ones the Web API returns, with its simplified album and artists.
+ * Tracks share albums and artists the way a real library does: about 10 tracks per album and 20 per artist.
+ */
+inline nlohmann::json synthetic_track(size_t index)
+{
+	std::string album_id = synthetic_id(2, index / 10);
+	nlohmann::json artists = nlohmann::json::array();
+	for (size_t i = 0; i < 1 + index % 3; i++)
+	{
+		size_t artist = (index / 20 + i * 7919) % (index / 20 + 50);
+		artists.push_back(synthetic_object("artist", synthetic_id(3, artist), "Artist " + std::to_string(artist)));
+	}
+
+	nlohmann::json album = synthetic_object("album", album_id, "Album " + std::to_string(index / 10));
+	album["album_type"] = "album";
+	album["total_tracks"] = 10;
+	album["available_markets"] = {"CA", "DE", "FR", "GB", "JP", "SE", "US"};
+	album["images"] = {
+		{{"url", "https://i.scdn.co/image/" + album_id + "640"}, {"width", 640}, {"height", 640}},
+		{{"url", "https://i.scdn.co/image/" + album_id + "300"}, {"width", 300}, {"height", 300}},
+		{{"url", "https://i.scdn.co/image/" + album_id + "64"}, {"width", 64}, {"height", 64}}
+	};
+	album["release_date"] = "2001-05-14";
+	album["release_date_precision"] = "day";
+	album["artists"] = nlohmann::json::array({artists[0]});
+
+	nlohmann::json track = synthetic_object("track", synthetic_id(1, index), "Track " + std::to_string(index));
+	track["album"] = album;
+	track["artists"] = artists;
+	track["available_markets"] = {"CA", "DE", "FR", "GB", "JP", "SE", "US"};
+	track["disc_number"] = 1;
+	track["duration_ms"] = 180000 + static_cast<int>(index % 120000);
+	track["explicit"] = index % 5 == 0;
+	track["external_ids"] = {{"isrc", "USRC1" + std::to_string(1000000 + index)}};
+	track["is_playable"] = true;
+	track["is_local"] = false;
+	track["popularity"] = static_cast<int>(index % 100);
+	track["preview_url"] = "https://p.scdn.co/mp3-preview/" + synthetic_id(4, index);
+	track["track_number"] = static_cast<int>(1 + index % 10);
+	return track;
+}
+
+} // namespace bench
+
+#endif
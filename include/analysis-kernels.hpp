@@ -0,0 +1,111 @@
+#pragma once
+#ifndef _SPOTIFY_API_ANALYSIS_KERNELS_
+#define _SPOTIFY_API_ANALYSIS_KERNELS_
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "categories/analysis.hpp"
+
+namespace spotify_api
+{
+
+/**
+ * @brief Vectorized computations over a @ref columnar_analysis_t.
+ *
+ * On x86-64 the AVX2 versions are chosen at runtime when the CPU supports them, so the library
+ * itself does not have to be compiled with `-mavx2`. On ARM64 the NEON versions are always used.
+ * Everywhere else, and on x86-64 CPUs without AVX2, plain loops are used instead.
+ */
+namespace analysis_kernels
+{
+	using vector_row_t = columnar_analysis_t::vector_row_t;
+
+	/// @returns The instruction set the kernels run with: "avx2", "neon" or "scalar".
+	std::string_view instruction_set();
+
+	/**
+	 * @brief Switches the kernels to another instruction set, for example to compare them with the plain loops.
+	 * Must not be called while other threads use the kernels.
+	 * @param name "avx2", "neon" or "scalar"
+	 * @returns false if the instruction set is not available on this CPU, in which case nothing changes
+	 */
+	bool use_instruction_set(std::string_view name);
+
+	/**
+	 * @brief A run of consecutive segments, as indexes into the segment columns.
+	 */
+	struct segment_range_t
+	{
+		uint32_t first;
+		uint32_t count;
+	};
+
+	/**
+	 * @brief Finds the segments that belong to each interval (bar, beat, section or tatum).
+	 * A segment belongs to the interval its start falls in. An interval no segment starts in
+	 * gets the segment that is playing when it starts, so every range is non-empty as long as there are segments.
+	 * @param segment_starts The start times of the segments, in ascending order
+	 * @param interval_starts The start times of the intervals, in ascending order
+	 * @param interval_durations The durations of the intervals
+	 * @returns One range per interval
+	 */
+	std::vector<segment_range_t> segments_per_interval(std::span<const float> segment_starts, std::span<const float> interval_starts, std::span<const float> interval_durations);
+
+	std::vector<segment_range_t> segments_per_interval(const columnar_analysis_t::segment_columns_t &segments, const columnar_analysis_t::interval_columns_t &intervals);
+
+	std::vector<segment_range_t> segments_per_interval(const columnar_analysis_t::segment_columns_t &segments, const columnar_analysis_t::section_columns_t &sections);
+
+	/**
+	 * @brief Averages a segment column over each range, for example the maximum loudness per bar.
+	 * @returns One average per range; 0 for an empty range
+	 */
+	std::vector<float> mean_per_interval(std::span<const float> values, std::span<const segment_range_t> ranges);
+
+	/**
+	 * @brief Averages pitch or timbre rows over each range, for example the chroma of every bar.
+	 * @returns One averaged row per range; all zeros for an empty range
+	 */
+	std::vector<vector_row_t> mean_rows_per_interval(std::span<const vector_row_t> rows, std::span<const segment_range_t> ranges);
+
+	/**
+	 * @brief Samples the loudness of a track at evenly spaced times.
+	 * Inside each segment the loudness rises linearly from `loudness_start` to `loudness_max` at `loudness_max_time`,
+	 * then moves linearly towards the start loudness of the next segment (`loudness_end` for the last one).
+	 * Times before the first segment or after the last one take the nearest segment's edge value.
+	 * @param segments The segment columns of an analysis
+	 * @param start_time The time of the first sample, in seconds
+	 * @param step The time between samples, in seconds
+	 * @param count The number of samples
+	 * @returns The loudness at each sample time in dB, or an empty vector if there are no segments
+	 */
+	std::vector<float> loudness_curve(const columnar_analysis_t::segment_columns_t &segments, float start_time, float step, size_t count);
+
+	/**
+	 * @brief Computes the euclidean distance from one 12-dimensional vector to each of many.
+	 * Typically used to compare segment timbres with a query timbre.
+	 * @param output Receives one distance per row; must be at least as long as `rows`
+	 */
+	void distances(const vector_row_t &query, std::span<const vector_row_t> rows, std::span<float> output);
+
+	std::vector<float> distances(const vector_row_t &query, std::span<const vector_row_t> rows);
+
+	/**
+	 * @brief Checks many 12-dimensional vectors against per-dimension bounds and scores the ones inside.
+	 * Every row is handled the same way without branching on its values.
+	 * @param lower The smallest allowed value of each dimension
+	 * @param upper The largest allowed value of each dimension
+	 * @param target The values to measure the distance to
+	 * @param weights How much each dimension counts towards the distance; 0 leaves a dimension out
+	 * @param output Receives `sqrt(sum(weights * (row - target)^2))` for each row inside the bounds,
+	 * and infinity for each row outside them; must be at least as long as `rows`
+	 */
+	void bounded_distances(const vector_row_t &lower, const vector_row_t &upper, const vector_row_t &target, const vector_row_t &weights,
+		std::span<const vector_row_t> rows, std::span<float> output);
+} // namespace analysis_kernels
+
+} // namespace spotify_api
+
+#endif
@@ -0,0 +1,130 @@
+#pragma once
+#ifndef _SPOTIFY_API_BATCH_LOADER_
+#define _SPOTIFY_API_BATCH_LOADER_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "categories/ids.hpp"
+#include "categories/tracks.hpp"
+#include "categories/albums.hpp"
+#include "categories/artists.hpp"
+#include "endpoints/tracks.hpp"
+#include "endpoints/albums.hpp"
+#include "endpoints/artists.hpp"
+
+namespace spotify_api
+{
+
+/**
+ * @brief Turns lookups of single tracks, albums, artists or audio features into requests for many at once.
+ *
+ * Callers ask for one ID at a time, from any thread, and get a future. The loader collects the IDs asked for
+ * within @ref options_t::window of the first one, or until a batch is full, and fetches them with one request to
+ * the endpoint that takes many IDs. Each caller then gets its own item. An ID asked for several times while it is
+ * waiting is fetched once.
+ *
+ * The loaders made by @ref make_track_loader and the others go through the API object's multi-get function, so they use
+ * its cache, if it has one, and its current access token. The API object has to outlive the loader.
+ *
+ * @tparam T @ref track_t, @ref album_t, @ref artist_t or @ref audio_features_t
+ */
+template <class T>
+class batch_loader_t
+{
+	public:
+	/// Requests one batch. Returns one item per ID, in the same order, null for IDs that were not found.
+	using fetch_t = std::function<std::vector<std::unique_ptr<T>>(std::span<const spotify_id_t> ids)>;
+
+	struct options_t
+	{
+		/// The most IDs the endpoint takes per request.
+		size_t max_batch = 50;
+		/// How long to wait for more IDs after the first one, before sending a batch that is not full.
+		std::chrono::microseconds window = std::chrono::milliseconds(2);
+	};
+
+	struct stats_t
+	{
+		/// The number of IDs asked for.
+		size_t loads = 0;
+		/// The number of IDs that were already waiting for the same batch.
+		size_t duplicates = 0;
+		size_t requests = 0;
+	};
+
+	batch_loader_t(fetch_t fetch, options_t options);
+
+	/// Sends the IDs that are still waiting, then stops.
+	~batch_loader_t();
+
+	batch_loader_t(const batch_loader_t &) = delete;
+	batch_loader_t &operator=(const batch_loader_t &) = delete;
+
+	/**
+	 * @param id_or_uri The ID or URI of the item
+	 * @returns The item, or null if it was not found, the request failed or the ID is not valid
+	 */
+	std::shared_future<std::shared_ptr<const T>> load(const std::string &id_or_uri);
+
+	/// Asks for every ID at once, which fills the batches without waiting for the window.
+	std::vector<std::shared_future<std::shared_ptr<const T>>> load_many(const std::vector<std::string> &ids_or_uris);
+
+	/// Sends the IDs that are waiting now instead of at the end of the window.
+	void dispatch();
+
+	stats_t stats() const;
+
+	private:
+	using promise_t = std::promise<std::shared_ptr<const T>>;
+
+	struct batch_t
+	{
+		std::vector<spotify_id_t> ids;
+		std::vector<promise_t> promises;
+		std::unordered_map<spotify_id_t, std::shared_future<std::shared_ptr<const T>>> futures;
+		std::chrono::steady_clock::time_point deadline;
+	};
+
+	// Must be called with `_mutex` held
+	std::shared_future<std::shared_ptr<const T>> enqueue(const spotify_id_t &id);
+	void send_loop();
+	void send(batch_t &batch);
+
+	fetch_t _fetch;
+	options_t _options;
+
+	mutable std::mutex _mutex;
+	/// The batch collecting IDs
+	batch_t _open;
+	/// Full batches, and the open one when its window ended, waiting for the sending thread
+	std::vector<batch_t> _ready;
+	stats_t _stats;
+
+	std::condition_variable _signal;
+	bool _stopping = false;
+	std::thread _thread;
+};
+
+/// Loads tracks through Track_API::get_tracks, 50 per request.
+std::unique_ptr<batch_loader_t<track_t>> make_track_loader(Track_API *api, const std::string &market = "");
+/// Loads albums through Album_API::get_albums, 20 per request.
+std::unique_ptr<batch_loader_t<album_t>> make_album_loader(Album_API *api);
+/// Loads artists through Artist_API::get_artists, 50 per request.
+std::unique_ptr<batch_loader_t<artist_t>> make_artist_loader(Artist_API *api);
+/// Loads audio features through Track_API::get_audio_features_for_tracks, 100 per request.
+std::unique_ptr<batch_loader_t<audio_features_t>> make_audio_features_loader(Track_API *api);
+
+} // namespace spotify_api
+
+#endif
@@ -0,0 +1,566 @@
+#pragma once
+#ifndef _SPOTIFY_API_BINARY_LIBRARY_
+#define _SPOTIFY_API_BINARY_LIBRARY_
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "categories/markets.hpp"
+#include "categories/tracks.hpp"
+#include "categories/albums.hpp"
+#include "categories/artists.hpp"
+#include "categories/playlist.hpp"
+#include "categories/episodes.hpp"
+
+namespace spotify_api
+{
+
+/**
+ * @brief The on-disk layout of a @ref binary_library_t file.
+ *
+ * A file starts with a @ref header_t followed by sections. Each section is an array of fixed size records
+ * (or raw bytes for the string section), aligned to 8 bytes. Records never contain pointers: strings are
+ * (offset, length) pairs into the string section, lists are (offset, count) pairs into one of the list sections,
+ * and references to other entities are record indexes. A file can therefore be mapped anywhere in memory
+ * and read in place.
+ *
+ * Versioning: a reader accepts any file with the same major version, which is the upper 16 bits of `version`.
+ * Newer minor versions may add sections and append fields to the end of records; the header stores the size of
+ * each record, so older readers skip the parts they do not know.
+ *
+ * All integers are stored in the byte order of the machine that wrote the file; the byte order mark
+ * lets readers reject files written with a different one.
+ */
+namespace binary_format
+{
+	inline constexpr char magic[8] = {'S', 'P', 'A', 'P', 'I', 'L', 'I', 'B'};
+	inline constexpr uint32_t version = 0x00010000;
+	inline constexpr uint32_t byte_order_mark = 0x01020304;
+	/// Used in place of a record index for a missing reference, such as a track without an album.
+	inline constexpr uint32_t no_index = UINT32_MAX;
+
+	enum section_id_t : uint32_t
+	{
+		/// Raw characters, not null terminated
+		strings,
+		/// string_ref_t lists, such as genres
+		string_lists,
+		/// uint32_t record index lists, such as the artists of a track
+		index_lists,
+		/// pair_record_t lists, such as external IDs
+		pair_lists,
+		/// image_record_t lists
+		image_lists,
+		tracks,
+		albums,
+		artists,
+		playlists,
+		episodes,
+		audio_features,
+		section_count
+	};
+
+	struct section_t
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint32_t count;
+		uint32_t record_size;
+	};
+
+	struct header_t
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order_mark;
+		uint32_t header_size;
+		/// The number of entries in the section table
+		uint32_t section_entries;
+		section_t sections[section_count];
+	};
+
+	struct string_ref_t
+	{
+		uint32_t offset;
+		uint32_t length;
+	};
+
+	struct list_ref_t
+	{
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	struct pair_record_t
+	{
+		string_ref_t key;
+		string_ref_t value;
+	};
+
+	struct image_record_t
+	{
+		string_ref_t url;
+		int32_t width;
+		int32_t height;
+	};
+
+	enum track_flags_t : uint32_t { track_explicit = 1, track_playable = 2, track_local = 4 };
+
+	struct track_record_t
+	{
+		string_ref_t id;
+		string_ref_t name;
+		string_ref_t preview_url;
+		uint32_t album;
+		uint32_t flags;
+		list_ref_t artists;
+		list_ref_t external_ids;
+		uint64_t available_markets[market_set_t::word_count];
+		int32_t disc_number;
+		int32_t duration_ms;
+		int32_t track_number;
+		int32_t popularity;
+	};
+
+	struct album_record_t
+	{
+		string_ref_t id;
+		string_ref_t name;
+		string_ref_t album_type;
+		string_ref_t release_date;
+		string_ref_t release_date_precision;
+		string_ref_t label;
+		list_ref_t artists;
+		list_ref_t tracks;
+		list_ref_t images;
+		list_ref_t genres;
+		list_ref_t external_ids;
+		/// Pairs of copyright text and type
+		list_ref_t copyrights;
+		uint64_t available_markets[market_set_t::word_count];
+		uint32_t total_tracks;
+		int32_t popularity;
+	};
+
+	struct artist_record_t
+	{
+		string_ref_t id;
+		string_ref_t name;
+		list_ref_t genres;
+		list_ref_t images;
+		int32_t popularity;
+		int32_t followers;
+	};
+
+	enum playlist_flags_t : uint32_t { playlist_collaborative = 1, playlist_public = 2 };
+
+	struct playlist_record_t
+	{
+		string_ref_t id;
+		string_ref_t name;
+		string_ref_t description;
+		string_ref_t snapshot_id;
+		string_ref_t owner_id;
+		string_ref_t owner_display_name;
+		list_ref_t images;
+		list_ref_t tracks;
+		int32_t total_tracks;
+		int32_t followers;
+		uint32_t flags;
+		uint32_t reserved;
+	};
+
+	enum episode_flags_t : uint32_t { episode_explicit = 1, episode_externally_hosted = 2, episode_playable = 4, episode_fully_played = 8 };
+
+	struct episode_record_t
+	{
+		string_ref_t id;
+		string_ref_t name;
+		string_ref_t description;
+		string_ref_t html_description;
+		string_ref_t audio_preview_url;
+		string_ref_t release_date;
+		string_ref_t release_date_precision;
+		list_ref_t images;
+		list_ref_t languages;
+		int32_t duration_ms;
+		int32_t resume_position_ms;
+		uint32_t flags;
+		uint32_t reserved;
+	};
+
+	struct audio_features_record_t
+	{
+		string_ref_t id;
+		double acousticness;
+		double danceability;
+		double energy;
+		double instrumentalness;
+		double liveness;
+		double loudness;
+		double speechiness;
+		double tempo;
+		double valence;
+		uint32_t duration_ms;
+		int32_t key;
+		int32_t mode;
+		int32_t time_signature;
+	};
+} // namespace binary_format
+
+class binary_library_t;
+
+/**
+ * @brief A random access list of items stored in a @ref binary_library_t.
+ */
+template <class Item>
+class list_view_t
+{
+	public:
+	using getter_t = Item (*)(const binary_library_t *library, uint32_t position);
+
+	list_view_t(const binary_library_t *library, binary_format::list_ref_t list, getter_t get): _library(library), _list(list), _get(get) {}
+
+	class iterator
+	{
+		public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Item;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = Item;
+
+		iterator(const list_view_t *list, uint32_t position): _list(list), _position(position) {}
+
+		Item operator*() const { return (*this->_list)[this->_position]; }
+		iterator &operator++() { this->_position++; return *this; }
+		iterator operator++(int) { iterator previous = *this; this->_position++; return previous; }
+		bool operator==(const iterator &other) const { return this->_position == other._position; }
+
+		private:
+		const list_view_t *_list;
+		uint32_t _position;
+	};
+
+	size_t size() const { return this->_list.count; }
+	bool empty() const { return this->_list.count == 0; }
+	Item operator[](size_t index) const { return this->_get(this->_library, this->_list.offset + static_cast<uint32_t>(index)); }
+
+	iterator begin() const { return iterator(this, 0); }
+	iterator end() const { return iterator(this, this->_list.count); }
+
+	private:
+	const binary_library_t *_library;
+	binary_format::list_ref_t _list;
+	getter_t _get;
+};
+
+class image_view_t
+{
+	public:
+	image_view_t(const binary_library_t *library, const binary_format::image_record_t *record): _library(library), _record(record) {}
+
+	std::string_view url() const;
+	int width() const { return this->_record->width; }
+	int height() const { return this->_record->height; }
+
+	private:
+	const binary_library_t *_library;
+	const binary_format::image_record_t *_record;
+};
+
+using string_pair_t = std::pair<std::string_view, std::string_view>;
+
+class album_view_t;
+class artist_view_t;
+
+/**
+ * @brief Read-only access to a track stored in a @ref binary_library_t. Views are only valid while the library is open.
+ */
+class track_view_t
+{
+	public:
+	track_view_t(const binary_library_t *library, const binary_format::track_record_t *record): _library(library), _record(record) {}
+
+	std::string_view id() const;
+	std::string_view name() const;
+	std::string_view preview_url() const;
+	std::optional<album_view_t> album() const;
+	list_view_t<artist_view_t> artists() const;
+	list_view_t<string_pair_t> external_ids() const;
+	market_set_t available_markets() const;
+	int disc_number() const { return this->_record->disc_number; }
+	int duration_ms() const { return this->_record->duration_ms; }
+	int track_number() const { return this->_record->track_number; }
+	int popularity() const { return this->_record->popularity; }
+	bool is_explicit() const { return this->_record->flags & binary_format::track_explicit; }
+	bool is_playable() const { return this->_record->flags & binary_format::track_playable; }
+	bool is_local() const { return this->_record->flags & binary_format::track_local; }
+
+	private:
+	const binary_library_t *_library;
+	const binary_format::track_record_t *_record;
+};
+
+class album_view_t
+{
+	public:
+	album_view_t(const binary_library_t *library, const binary_format::album_record_t *record): _library(library), _record(record) {}
+
+	std::string_view id() const;
+	std::string_view name() const;
+	std::string_view album_type() const;
+	std::string_view release_date() const;
+	std::string_view release_date_precision() const;
+	std::string_view label() const;
+	list_view_t<artist_view_t> artists() const;
+	list_view_t<track_view_t> tracks() const;
+	list_view_t<image_view_t> images() const;
+	list_view_t<std::string_view> genres() const;
+	list_view_t<string_pair_t> external_ids() const;
+	/// Pairs of copyright text and type
+	list_view_t<string_pair_t> copyrights() const;
+	market_set_t available_markets() const;
+	unsigned int total_tracks() const { return this->_record->total_tracks; }
+	int popularity() const { return this->_record->popularity; }
+
+	private:
+	const binary_library_t *_library;
+	const binary_format::album_record_t *_record;
+};
+
+class artist_view_t
+{
+	public:
+	artist_view_t(const binary_library_t *library, const binary_format::artist_record_t *record): _library(library), _record(record) {}
+
+	std::string_view id() const;
+	std::string_view name() const;
+	list_view_t<std::string_view> genres() const;
+	list_view_t<image_view_t> images() const;
+	int popularity() const { return this->_record->popularity; }
+	int followers() const { return this->_record->followers; }
+
+	private:
+	const binary_library_t *_library;
+	const binary_format::artist_record_t *_record;
+};
+
+class playlist_view_t
+{
+	public:
+	playlist_view_t(const binary_library_t *library, const binary_format::playlist_record_t *record): _library(library), _record(record) {}
+
+	std::string_view id() const;
+	std::string_view name() const;
+	std::string_view description() const;
+	std::string_view snapshot_id() const;
+	std::string_view owner_id() const;
+	std::string_view owner_display_name() const;
+	list_view_t<image_view_t> images() const;
+	/// The tracks that were loaded when the playlist was saved; see @ref total_tracks for the full count.
+	list_view_t<track_view_t> tracks() const;
+	int total_tracks() const { return this->_record->total_tracks; }
+	int followers() const { return this->_record->followers; }
+	bool is_collaborative() const { return this->_record->flags & binary_format::playlist_collaborative; }
+	bool is_public() const { return this->_record->flags & binary_format::playlist_public; }
+
+	private:
+	const binary_library_t *_library;
+	const binary_format::playlist_record_t *_record;
+};
+
+class episode_view_t
+{
+	public:
+	episode_view_t(const binary_library_t *library, const binary_format::episode_record_t *record): _library(library), _record(record) {}
+
+	std::string_view id() const;
+	std::string_view name() const;
+	std::string_view description() const;
+	std::string_view html_description() const;
+	std::string_view audio_preview_url() const;
+	std::string_view release_date() const;
+	std::string_view release_date_precision() const;
+	list_view_t<image_view_t> images() const;
+	list_view_t<std::string_view> languages() const;
+	int duration_ms() const { return this->_record->duration_ms; }
+	int resume_position_ms() const { return this->_record->resume_position_ms; }
+	bool is_explicit() const { return this->_record->flags & binary_format::episode_explicit; }
+	bool is_externally_hosted() const { return this->_record->flags & binary_format::episode_externally_hosted; }
+	bool is_playable() const { return this->_record->flags & binary_format::episode_playable; }
+	bool fully_played() const { return this->_record->flags & binary_format::episode_fully_played; }
+
+	private:
+	const binary_library_t *_library;
+	const binary_format::episode_record_t *_record;
+};
+
+class audio_features_view_t
+{
+	public:
+	audio_features_view_t(const binary_library_t *library, const binary_format::audio_features_record_t *record): _library(library), _record(record) {}
+
+	std::string_view id() const;
+	double acousticness() const { return this->_record->acousticness; }
+	double danceability() const { return this->_record->danceability; }
+	unsigned int duration_ms() const { return this->_record->duration_ms; }
+	double energy() const { return this->_record->energy; }
+	double instrumentalness() const { return this->_record->instrumentalness; }
+	int key() const { return this->_record->key; }
+	double liveness() const { return this->_record->liveness; }
+	double loudness() const { return this->_record->loudness; }
+	int mode() const { return this->_record->mode; }
+	double speechiness() const { return this->_record->speechiness; }
+	double tempo() const { return this->_record->tempo; }
+	int time_signature() const { return this->_record->time_signature; }
+	double valence() const { return this->_record->valence; }
+
+	private:
+	const binary_library_t *_library;
+	const binary_format::audio_features_record_t *_record;
+};
+
+/**
+ * @brief A library file opened for reading in place.
+ *
+ * Opening a file maps it into memory and checks the header and section table; nothing else is read up front.
+ * Entities are read through view types that point straight into the mapping.
+ * References that point outside their section read as empty values instead of out of bounds memory,
+ * so a damaged file cannot cause invalid reads.
+ */
+class binary_library_t
+{
+	public:
+	binary_library_t(const binary_library_t &) = delete;
+	binary_library_t &operator=(const binary_library_t &) = delete;
+	~binary_library_t();
+
+	/**
+	 * @brief Maps a library file into memory.
+	 * @returns The library, or null if the file cannot be opened or is not a compatible library file
+	 */
+	static std::unique_ptr<binary_library_t> open(const std::string &path);
+
+	/// Reads a library from a buffer in memory, such as the output of @ref binary_library_writer_t::serialize.
+	static std::unique_ptr<binary_library_t> from_bytes(std::string bytes);
+
+	/// @returns The format version the file was written with.
+	uint32_t version() const { return this->header()->version; }
+
+	size_t track_count() const { return this->count(binary_format::tracks); }
+	size_t album_count() const { return this->count(binary_format::albums); }
+	size_t artist_count() const { return this->count(binary_format::artists); }
+	size_t playlist_count() const { return this->count(binary_format::playlists); }
+	size_t episode_count() const { return this->count(binary_format::episodes); }
+	size_t audio_features_count() const { return this->count(binary_format::audio_features); }
+
+	track_view_t track(size_t index) const { return track_view_t(this, this->record<binary_format::track_record_t>(binary_format::tracks, index)); }
+	album_view_t album(size_t index) const { return album_view_t(this, this->record<binary_format::album_record_t>(binary_format::albums, index)); }
+	artist_view_t artist(size_t index) const { return artist_view_t(this, this->record<binary_format::artist_record_t>(binary_format::artists, index)); }
+	playlist_view_t playlist(size_t index) const { return playlist_view_t(this, this->record<binary_format::playlist_record_t>(binary_format::playlists, index)); }
+	episode_view_t episode(size_t index) const { return episode_view_t(this, this->record<binary_format::episode_record_t>(binary_format::episodes, index)); }
+	audio_features_view_t audio_features(size_t index) const { return audio_features_view_t(this, this->record<binary_format::audio_features_record_t>(binary_format::audio_features, index)); }
+
+	/// @returns The characters a string reference points to, or an empty string if it is out of bounds.
+	std::string_view string(binary_format::string_ref_t ref) const;
+
+	/**
+	 * @brief Returns a record of a section.
+	 * An out of bounds index returns a record filled with zeros, which reads as empty strings and lists.
+	 */
+	template <class Record>
+	const Record *record(binary_format::section_id_t section, size_t index) const
+	{
+		static_assert(std::is_trivially_copyable_v<Record> && alignof(Record) <= 8);
+		static const Record empty{};
+
+		const binary_format::section_t &table = this->header()->sections[section];
+		if (index >= table.count) return &empty;
+		return reinterpret_cast<const Record *>(this->_data + table.offset + index * table.record_size);
+	}
+
+	/// @returns The record index stored at a position of the index list section, or @ref binary_format::no_index.
+	uint32_t index_at(uint32_t position) const;
+
+	private:
+	binary_library_t() = default;
+
+	static std::unique_ptr<binary_library_t> validate(std::unique_ptr<binary_library_t> library);
+
+	const binary_format::header_t *header() const { return reinterpret_cast<const binary_format::header_t *>(this->_data); }
+	size_t count(binary_format::section_id_t section) const { return this->header()->sections[section].count; }
+
+	const char *_data = nullptr;
+	size_t _size = 0;
+	// Set when the library owns a copy of the data instead of a mapping
+	std::string _buffer;
+	void *_mapping = nullptr;
+	void *_mapping_handle = nullptr;
+};
+
+/**
+ * @brief Collects entities and writes them as a @ref binary_library_t file.
+ *
+ * Entities are deduplicated by ID, and the albums and artists that tracks refer to are added with them.
+ * Identical strings are stored once.
+ */
+class binary_library_writer_t
+{
+	public:
+	/// Each `add` returns the record index of the entity, which is also its index in the written library.
+	uint32_t add(const track_t &track);
+	uint32_t add(const album_t &album);
+	uint32_t add(const artist_t &artist);
+	uint32_t add(const playlist_t &playlist);
+	uint32_t add(const episode_t &episode);
+	uint32_t add(const audio_features_t &features);
+
+	/// @returns The complete file contents.
+	std::string serialize() const;
+
+	/// Writes the file. @returns false if the file could not be written.
+	bool write(const std::string &path) const;
+
+	private:
+	binary_format::string_ref_t add_string(std::string_view value);
+	binary_format::list_ref_t add_images(const std::vector<image_t> &images);
+	template <class Strings>
+	binary_format::list_ref_t add_string_list(const Strings &values);
+	binary_format::list_ref_t add_pairs(const std::map<std::string, std::string> &values);
+	binary_format::list_ref_t add_indexes(const std::vector<uint32_t> &indexes);
+
+	std::string _strings;
+	std::unordered_map<std::string, binary_format::string_ref_t> _string_refs;
+	std::vector<binary_format::string_ref_t> _string_lists;
+	std::vector<uint32_t> _index_lists;
+	std::vector<binary_format::pair_record_t> _pair_lists;
+	std::vector<binary_format::image_record_t> _image_lists;
+
+	std::vector<binary_format::track_record_t> _tracks;
+	std::vector<binary_format::album_record_t> _albums;
+	std::vector<binary_format::artist_record_t> _artists;
+	std::vector<binary_format::playlist_record_t> _playlists;
+	std::vector<binary_format::episode_record_t> _episodes;
+	std::vector<binary_format::audio_features_record_t> _audio_features;
+
+	std::unordered_map<std::string, uint32_t> _track_ids;
+	std::unordered_map<std::string, uint32_t> _album_ids;
+	std::unordered_map<std::string, uint32_t> _artist_ids;
+	std::unordered_map<std::string, uint32_t> _playlist_ids;
+	std::unordered_map<std::string, uint32_t> _episode_ids;
+	std::unordered_map<std::string, uint32_t> _audio_features_ids;
+};
+
+} // namespace spotify_api
+
+#endif
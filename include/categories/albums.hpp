@@ -13,6 +13,8 @@
 #include <nlohmann/json.hpp>
 
 #include "./common.hpp"
+#include "./markets.hpp"
+#include "../string-pool.hpp"
 #include "./artists.hpp"
 #include "./tracks.hpp"
 
@@ -23,7 +25,7 @@ struct artist_t;
 
 struct copyright_t
 {
-	std::string text;
+	interned_string_t text;
 	std::string type;
 };
 
@@ -42,7 +44,8 @@ struct album_t
 	 * and is specified by its corresponding 2 letter country code.
 	 * @note An album is considered available in a market when at least one of its tracks is available in that market.
 	*/
-	std::vector<std::string> available_markets;
+	market_set_t available_markets;
+#ifndef SPOTIFY_API_COMPACT_LINKS
 	/**
 	 * @brief Any known external urls for the album.
 	 * @note This will always include the album's [Spotify URL](https://developer.spotify.com/documentation/web-api/concepts/spotify-uris-ids).
@@ -50,6 +53,7 @@ struct album_t
 	std::map<std::string, std::string> external_urls;
 	/// A Spotify API endpoint that provides the full details of an album.
 	std::string href;
+#endif
 	/// The [Spotify ID](https://developer.spotify.com/documentation/web-api/concepts/spotify-uris-ids) of the album.
 	std::string id;
 	/// Cover art for an album in various sizes.
@@ -66,18 +70,36 @@ struct album_t
 	/// Any copyrights associated with the album.
 	std::vector<copyright_t> copyrights;
 	static const std::string type;
+#ifndef SPOTIFY_API_COMPACT_LINKS
 	/// The [Spotify URI](https://developer.spotify.com/documentation/web-api/concepts/spotify-uris-ids) of the album.
 	std::string uri;
+#endif
 	/// Any known external IDs for a particular album, such as a UPC, an EAN, and/or an ISRC.
 	std::map<std::string, std::string> external_ids;
-	std::vector<std::string> genres;
+	std::vector<interned_string_t> genres;
 	/// A number from 0-100 describing how popular an album is.
 	uint8_t popularity;
-	std::string label;
+	interned_string_t label;
 	/// A list of artists who made the album.
 	std::vector<std::shared_ptr<artist_t>> artists;
 	/// A list of tracks in the album as a @ref page_t "page".
 	page_t<std::shared_ptr<track_t>> tracks;
+#ifdef SPOTIFY_API_COMPACT_LINKS
+	/// The href, uri and external urls of the album. Use @ref href(), @ref uri() and @ref external_urls() to read them.
+	entity_links_t links;
+
+	/// @returns A Spotify API endpoint that provides the full details of an album.
+	std::string href() const { return links.href(type, id); }
+
+	/// @returns The [Spotify URI](https://developer.spotify.com/documentation/web-api/concepts/spotify-uris-ids) of the album.
+	std::string uri() const { return links.uri(type, id); }
+
+	/**
+	 * @returns Any known external urls for the album.
+	 * @note This will always include the album's [Spotify URL](https://developer.spotify.com/documentation/web-api/concepts/spotify-uris-ids).
+	*/
+	std::map<std::string, std::string> external_urls() const { return links.external_urls(type, id); }
+#endif
 	
 	/**
 	 * @brief Converts a stringified JSON object to an album object.
@@ -99,6 +121,28 @@ struct album_t
 	 * @see from_json(const std::string &json_string)
 	 */
 	static std::unique_ptr<album_t> from_json(const nlohmann::json &json_object);
+
+	/**
+	 * @brief Converts a json object into an album allocated from a memory resource.
+	 * The album's artists and tracks are allocated from the same resource.
+	 * @param json_object The json object to convert
+	 * @param resource The memory resource to allocate from, or null for the heap. The album must not outlive it.
+	 * @returns A pointer to a newly created @ref album_t object
+	 */
+	static std::shared_ptr<album_t> from_json(const nlohmann::json &json_object, std::pmr::memory_resource *resource)
+	{
+		return from_json(json_object, decode_context_t{resource});
+	}
+
+	/**
+	 * @brief Converts a json object into an album using the given @ref decode_context_t "context".
+	 * If the context has an entity store, an album that is already stored in at least as much detail is returned
+	 * without decoding it again, and the album's artists and tracks are shared through the store.
+	 * @param json_object The json object to convert
+	 * @param context The allocation and sharing options to decode with
+	 * @returns A pointer to the decoded or shared @ref album_t object
+	 */
+	static std::shared_ptr<album_t> from_json(const nlohmann::json &json_object, const decode_context_t &context);
 };
 
 } // namespace spotify_api
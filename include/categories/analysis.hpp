@@ -0,0 +1,115 @@
+#pragma once
+#ifndef _SPOTIFY_API_ANALYSIS_T_
+#define _SPOTIFY_API_ANALYSIS_T_
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace spotify_api
+{
+
+/**
+ * @brief An audio analysis stored column by column.
+ *
+ * Where @ref audio_analysis_t allocates one object per bar, beat, section, segment and tatum,
+ * this type keeps every field in its own contiguous array, so an analysis with thousands of segments
+ * takes a few dozen allocations, and loops over a single field read consecutive memory.
+ * Row `i` of a table is made of element `i` of each of its columns.
+ *
+ * Every column stores `float`. This keeps columns of the same length directly comparable and
+ * suitable for vectorized loops; times keep sub-millisecond precision for tracks up to a few hours long.
+ * Fields missing from a row are 0.
+ */
+struct columnar_analysis_t
+{
+	/// The number of values in a segment's pitch and timbre vectors.
+	static constexpr size_t vector_size = 12;
+	using vector_row_t = std::array<float, vector_size>;
+
+	/// Bars, beats and tatums.
+	struct interval_columns_t
+	{
+		std::vector<float> start;
+		std::vector<float> duration;
+		std::vector<float> confidence;
+
+		size_t size() const { return start.size(); }
+		bool empty() const { return start.empty(); }
+	};
+
+	struct section_columns_t
+	{
+		std::vector<float> start;
+		std::vector<float> duration;
+		std::vector<float> confidence;
+		std::vector<float> loudness;
+		std::vector<float> tempo;
+		std::vector<float> tempo_confidence;
+		std::vector<float> key;
+		std::vector<float> key_confidence;
+		std::vector<float> mode;
+		std::vector<float> mode_confidence;
+		std::vector<float> time_signature;
+		std::vector<float> time_signature_confidence;
+
+		size_t size() const { return start.size(); }
+		bool empty() const { return start.empty(); }
+	};
+
+	struct segment_columns_t
+	{
+		std::vector<float> start;
+		std::vector<float> duration;
+		std::vector<float> confidence;
+		std::vector<float> loudness_start;
+		std::vector<float> loudness_max;
+		std::vector<float> loudness_max_time;
+		std::vector<float> loudness_end;
+		/// One row of 12 pitch classes (C, C#, ..., B) per segment, each in the range 0.0 - 1.0.
+		std::vector<vector_row_t> pitches;
+		/// One row of 12 timbre coefficients per segment.
+		std::vector<vector_row_t> timbre;
+
+		size_t size() const { return start.size(); }
+		bool empty() const { return start.empty(); }
+	};
+
+	/// The track-wide values from the analysis's "track" object.
+	double duration = 0;
+	double loudness = 0;
+	double tempo = 0;
+	double tempo_confidence = 0;
+	int key = -1;
+	double key_confidence = 0;
+	int mode = -1;
+	double mode_confidence = 0;
+	int time_signature = 0;
+	double time_signature_confidence = 0;
+
+	interval_columns_t bars;
+	interval_columns_t beats;
+	section_columns_t sections;
+	segment_columns_t segments;
+	interval_columns_t tatums;
+
+	/// @returns The approximate number of bytes used by the columns.
+	size_t memory_usage() const;
+
+	/**
+	 * @brief Decodes an audio analysis response without building a json document first.
+	 * The text is streamed through a SAX parser that writes each value straight into its column.
+	 * @returns The decoded analysis, or null if the text is not valid json
+	 */
+	static std::unique_ptr<columnar_analysis_t> from_json(const std::string &json_string);
+
+	static std::unique_ptr<columnar_analysis_t> from_json(const nlohmann::json &json_obj);
+};
+
+} // namespace spotify_api
+
+#endif
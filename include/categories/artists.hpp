@@ -13,6 +13,7 @@ namespace spotify_api {struct artist_t;}
 
 // #include "./albums.hpp"
 #include "./common.hpp"
+#include "../string-pool.hpp"
 #include "./tracks.hpp"
 
 namespace spotify_api
@@ -20,20 +21,49 @@ namespace spotify_api
 
 struct artist_t
 {
+#ifndef SPOTIFY_API_COMPACT_LINKS
 	std::map<std::string, std::string> external_urls;
+#endif
 	follower_t followers;
-	std::vector<std::string> genres;
+	std::vector<interned_string_t> genres;
+#ifndef SPOTIFY_API_COMPACT_LINKS
 	std::string href;
+#endif
 	std::string id;
 	std::vector<image_t> images;
-	std::string name;
+	interned_string_t name;
 	int popularity;
 	static const std::string type;
+#ifndef SPOTIFY_API_COMPACT_LINKS
 	std::string uri;
+#else
+	/// The href, uri and external urls of the artist. Use @ref href(), @ref uri() and @ref external_urls() to read them.
+	entity_links_t links;
+
+	std::string href() const { return links.href(type, id); }
+	std::string uri() const { return links.uri(type, id); }
+	std::map<std::string, std::string> external_urls() const { return links.external_urls(type, id); }
+#endif
 
 	static std::unique_ptr<artist_t> from_json(const std::string &json_string);
 
 	static std::unique_ptr<artist_t> from_json(const nlohmann::json &json_object);
+
+	/**
+	 * @brief Converts a json object into an artist allocated from a memory resource.
+	 * @param resource The memory resource to allocate from, or null for the heap. The artist must not outlive it.
+	 */
+	static std::shared_ptr<artist_t> from_json(const nlohmann::json &json_object, std::pmr::memory_resource *resource)
+	{
+		return from_json(json_object, decode_context_t{resource});
+	}
+
+	/**
+	 * @brief Converts a json object into an artist using the given @ref decode_context_t "context".
+	 * If the context has an entity store, an artist that is already stored in at least as much detail is returned
+	 * without decoding it again.
+	 */
+	static std::shared_ptr<artist_t> from_json(const nlohmann::json &json_object, const decode_context_t &context);
 };
 
 } // namespace spotify_api
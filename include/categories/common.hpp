@@ -5,10 +5,13 @@
 #define _SPOTIFY_API_CATEGORY_COMMON_INCLUDES_
 
 #include <string>
+#include <string_view>
+#include <optional>
 #include <map>
 #include <vector>
 #include <type_traits>
 #include <memory>
+#include <memory_resource>
 #include <concepts>
 
 #include <nlohmann/json.hpp>
@@ -54,6 +57,63 @@ struct image_t
 	static inline image_t from_json(const std::string &json_string) { return image_t::from_json(nlohmann::json::parse(json_string)); };
 };
 
+/**
+ * @brief The `href`, `uri` and `external_urls` of a Spotify object, stored compactly.
+ * 
+ * For almost every object these three values are fixed functions of the object's type and ID:
+ * - href: `https://api.spotify.com/v1/<type>s/<id>`
+ * - uri: `spotify:<type>:<id>`
+ * - external_urls: `{"spotify": "https://open.spotify.com/<type>/<id>"}`
+ * 
+ * Instead of storing them, they are rebuilt on demand. When decoding, each value is checked against
+ * its canonical form and only values that differ (such as local tracks) are kept, in a shared fallback.
+ *
+ * Entities only use it when the library is built with `SPOTIFY_API_COMPACT_LINKS` (the CMake option of the same name).
+ * Their `href`, `uri` and `external_urls` members are then replaced by a `links` member and accessor functions
+ * of the same names. By default the members are stored as plain strings and maps.
+ */
+class entity_links_t
+{
+	public:
+	entity_links_t() = default;
+
+	/// @returns The Web API endpoint for the object.
+	std::string href(std::string_view type, std::string_view id) const;
+
+	/// @returns The Spotify URI of the object.
+	std::string uri(std::string_view type, std::string_view id) const;
+
+	/// @returns The known external urls of the object.
+	std::map<std::string, std::string> external_urls(std::string_view type, std::string_view id) const;
+
+	/// @returns true if all three values are in their canonical form and nothing extra is stored.
+	bool is_canonical() const { return this->_fallback == nullptr; }
+
+	static std::string canonical_href(std::string_view type, std::string_view id);
+	static std::string canonical_uri(std::string_view type, std::string_view id);
+	static std::string canonical_spotify_url(std::string_view type, std::string_view id);
+
+	/**
+	 * @brief Reads the `href`, `uri` and `external_urls` members of a json object,
+	 * keeping only the ones that are not in their canonical form.
+	 * @param json_object The json object of the Spotify object.
+	 * @param type The object type, such as "track" or "album".
+	 * @param id The Spotify ID of the object. Must already be decoded.
+	 */
+	static entity_links_t from_json(const nlohmann::json &json_object, std::string_view type, std::string_view id);
+
+	private:
+	struct fallback_t
+	{
+		std::optional<std::string> href;
+		std::optional<std::string> uri;
+		std::optional<std::map<std::string, std::string>> external_urls;
+	};
+
+	// Shared so that entities stay cheap to copy. Never modified after decoding.
+	std::shared_ptr<const fallback_t> _fallback;
+};
+
 struct owner_t
 {
 	std::map<std::string, std::string> external_urls;
@@ -110,6 +170,34 @@ template<class T> struct RemovePointer<std::weak_ptr<T> const volatile> { typede
 template<class T>
 using RemovePointer_T = typename RemovePointer<T>::type;
 
+class entity_store_t;
+
+/**
+ * @brief Options that control how nested objects are allocated and shared while decoding.
+ */
+struct decode_context_t
+{
+	/// The memory resource to allocate entities from, or null to allocate them on the heap.
+	/// Entities must not outlive the resource.
+	std::pmr::memory_resource *resource = nullptr;
+	/// An optional @ref entity_store_t "entity store". When set, objects that are already in the store are
+	/// reused instead of decoded again, and newly decoded objects are added to it.
+	entity_store_t *store = nullptr;
+};
+
+/**
+ * @brief Allocates a new default constructed entity.
+ * @param resource The memory resource to allocate the entity and its reference count from.
+ * If null, the entity is allocated on the heap.
+ * @note Entities allocated from a memory resource must not outlive it.
+ */
+template<class T>
+std::shared_ptr<T> make_entity(std::pmr::memory_resource *resource)
+{
+	if (resource == nullptr) return std::make_shared<T>();
+	return std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(resource));
+}
+
 template<class T>
 concept HasFromJson = requires(T a) {
 	{ T::from_json(std::string()) } -> std::same_as<std::unique_ptr<T>>;
@@ -158,11 +246,34 @@ struct page_t
 	static page_t<Item_Type> from_json(const std::string &json_string);
 
 	static page_t<Item_Type> from_json(const nlohmann::json &json_obj);
+
+	/**
+	 * @brief Converts a json object into a page, allocating every item from a memory resource.
+	 * 
+	 * Intended for use with a `std::pmr::monotonic_buffer_resource`, so that a whole response is decoded into
+	 * one arena and released at once when the resource is destroyed, instead of one allocation per object.
+	 * Only available for pages of `std::shared_ptr` to types that have a matching `from_json` overload.
+	 * @param json_obj The json object to convert.
+	 * @param resource The memory resource to allocate the items from. The items must not outlive it.
+	 */
+	static page_t<Item_Type> from_json(const nlohmann::json &json_obj, std::pmr::memory_resource *resource)
+		requires std::same_as<Item_Type, std::shared_ptr<RemovePointer_T<Item_Type>>>
+	{
+		return from_json(json_obj, decode_context_t{resource});
+	}
+
+	/**
+	 * @brief Converts a json object into a page, decoding every item with the given @ref decode_context_t "context".
+	 * Only available for pages of `std::shared_ptr` to types that have a matching `from_json` overload.
+	 */
+	static page_t<Item_Type> from_json(const nlohmann::json &json_obj, const decode_context_t &context)
+		requires std::same_as<Item_Type, std::shared_ptr<RemovePointer_T<Item_Type>>>;
 };
 
 /**
  * @brief Truncates a Spotify URI to just the Spotify ID of the resource at the end of the URI.
  * Example: "spotify:track:6rqhFgbbKwnb9MLmUQDhG6" gets truncated to "6rqhFgbbKwnb9MLmUQDhG6"
+ * @note Use @ref extract_spotify_id to get the ID without copying it.
  * @param full_id 
  * @note Docs: https://developer.spotify.com/documentation/web-api/concepts/spotify-uris-ids
  */
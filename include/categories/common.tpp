@@ -28,6 +28,7 @@ page_t<Item_Type> page_t<Item_Type>::from_json(const nlohmann::json &json_obj)
 	new_page.next = json_get_nullable(json_obj["next"], "");
 	new_page.previous = json_get_nullable(json_obj["previous"], "");
 	
+	new_page.items.reserve(json_obj["items"].size());
 	for (auto item = json_obj["items"].begin(); item != json_obj["items"].end(); ++item)
 	{
 		new_page.items.push_back(RemovePointer_T<Item_Type>::from_json(item.value()));
@@ -36,4 +37,26 @@ page_t<Item_Type> page_t<Item_Type>::from_json(const nlohmann::json &json_obj)
 	return new_page;
 }
 
+template <JsonOrJsonPointer Item_Type>
+page_t<Item_Type> page_t<Item_Type>::from_json(const nlohmann::json &json_obj, const decode_context_t &context)
+	requires std::same_as<Item_Type, std::shared_ptr<RemovePointer_T<Item_Type>>>
+{
+	page_t<Item_Type> new_page;
+	
+	new_page.href = json_obj["href"];
+	new_page.limit = json_obj["limit"];
+	new_page.offset = json_obj["offset"];
+	new_page.total = json_obj["total"];
+	new_page.next = json_get_nullable(json_obj["next"], "");
+	new_page.previous = json_get_nullable(json_obj["previous"], "");
+	
+	new_page.items.reserve(json_obj["items"].size());
+	for (auto item = json_obj["items"].begin(); item != json_obj["items"].end(); ++item)
+	{
+		new_page.items.push_back(RemovePointer_T<Item_Type>::from_json(item.value(), context));
+	}
+	
+	return new_page;
+}
+
 }; // namespace spotify_api
\ No newline at end of file
@@ -34,10 +34,12 @@ struct episode_t {
 	int duration_ms;
 	// Whether or not the episode has explicit content (true = yes it does; false = no it does not OR unknown)
 	bool is_explicit;
+#ifndef SPOTIFY_API_COMPACT_LINKS
 	// External urls for this episode
 	std::map<std::string, std::string> external_urls;
 	// A link to the Web API endpoint providing full details of the episode
 	std::string href;
+#endif
 	// The spotify ID for this episode
 	std::string id;
 	// The cover art for the episode in various sizes, widest first.
@@ -58,12 +60,25 @@ struct episode_t {
 	resume_point_t resume_point;
 	// The object type
 	static const std::string type;
+#ifndef SPOTIFY_API_COMPACT_LINKS
 	// The spotify URI for this episode
 	std::string uri;
+#endif
 	// Included in the response when a content restriction is applied
 	std::string restrictions;
 	// The show that the episode belongs to
 	std::shared_ptr<show_t> show;
+#ifdef SPOTIFY_API_COMPACT_LINKS
+	// The href, uri and external urls of the episode. Use href(), uri() and external_urls() to read them.
+	entity_links_t links;
+
+	// A link to the Web API endpoint providing full details of the episode
+	std::string href() const { return links.href(type, id); }
+	// The spotify URI for this episode
+	std::string uri() const { return links.uri(type, id); }
+	// External urls for this episode
+	std::map<std::string, std::string> external_urls() const { return links.external_urls(type, id); }
+#endif
 	
 	static std::unique_ptr<episode_t> from_json(const std::string &json_string);
 
@@ -0,0 +1,129 @@
+#pragma once
+#ifndef _SPOTIFY_API_SPOTIFY_ID_T_
+#define _SPOTIFY_API_SPOTIFY_ID_T_
+
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace spotify_api
+{
+
+/**
+ * @brief A [Spotify ID](https://developer.spotify.com/documentation/web-api/concepts/spotify-uris-ids)
+ * stored as the 128-bit number that its 22 base62 characters encode.
+ * 
+ * At 16 bytes with no heap allocation it is much cheaper to hash, compare and store than the
+ * equivalent `std::string`, which makes it a better key for id-keyed maps and sets.
+ * IDs are ordered by their numeric value.
+ */
+class spotify_id_t
+{
+	public:
+	/// The number of characters in a base62 encoded Spotify ID.
+	static constexpr size_t encoded_length = 22;
+
+	/// The base62 alphabet used by Spotify IDs.
+	static constexpr std::string_view alphabet = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+	constexpr spotify_id_t() = default;
+	constexpr spotify_id_t(uint64_t high, uint64_t low): _high(high), _low(low) {}
+
+	/**
+	 * @brief Decodes a bare 22 character base62 ID.
+	 * @returns The decoded ID, or `std::nullopt` if `id` is not a valid Spotify ID.
+	 */
+	static std::optional<spotify_id_t> from_base62(std::string_view id);
+
+	/**
+	 * @brief Decodes a Spotify ID, URI or open.spotify.com URL.
+	 * Example: "spotify:track:6rqhFgbbKwnb9MLmUQDhG6", "https://open.spotify.com/track/6rqhFgbbKwnb9MLmUQDhG6?si=abc"
+	 * and "6rqhFgbbKwnb9MLmUQDhG6" all decode to the same ID.
+	 * @returns The decoded ID, or `std::nullopt` if no valid ID could be found.
+	 */
+	static std::optional<spotify_id_t> parse(std::string_view id_or_uri);
+
+	/**
+	 * @brief Writes the 22 character base62 form of the ID to `first`. No null terminator is written.
+	 * @returns A pointer one past the last character written.
+	 */
+	char *to_chars(char *first) const;
+
+	/// @returns The 22 character base62 form of the ID.
+	std::string to_string() const;
+
+	constexpr uint64_t high() const { return this->_high; }
+	constexpr uint64_t low() const { return this->_low; }
+
+	constexpr size_t hash() const
+	{
+		// IDs are random numbers, so a cheap mix of both halves is already well distributed.
+		return static_cast<size_t>((this->_high * 0x9E3779B97F4A7C15ULL) ^ this->_low);
+	}
+
+	friend constexpr bool operator==(const spotify_id_t &lhs, const spotify_id_t &rhs) = default;
+	friend constexpr std::strong_ordering operator<=>(const spotify_id_t &lhs, const spotify_id_t &rhs) = default;
+
+	private:
+	uint64_t _high = 0;
+	uint64_t _low = 0;
+};
+
+/**
+ * @brief Finds the ID part of a Spotify ID, URI or URL without copying it.
+ * Query strings and fragments ("?si=...") are stripped from URLs.
+ * @param id_or_uri The ID, URI or URL. The returned view points into this string.
+ */
+std::string_view extract_spotify_id(std::string_view id_or_uri);
+
+/**
+ * @brief The output of @ref normalize_spotify_ids.
+ */
+struct normalized_ids_t
+{
+	/// The valid IDs in the order they first appeared in the input.
+	std::vector<spotify_id_t> ids;
+	/// For every input, the position of its ID in @ref ids, or -1 if the input was not a valid ID.
+	std::vector<int64_t> positions;
+	/// The number of inputs that were not valid IDs.
+	size_t invalid_count = 0;
+	/// The number of valid inputs that repeated an earlier ID. Always 0 when deduplication is turned off.
+	size_t duplicate_count = 0;
+};
+
+/**
+ * @brief Converts a batch of Spotify IDs, URIs and URLs to @ref spotify_id_t in a single pass.
+ * @param ids_or_uris The IDs to convert. Any form accepted by @ref spotify_id_t::parse is allowed.
+ * @param dedup If true, repeated IDs are only stored once.
+ * @returns The converted IDs together with a mapping from every input to its ID.
+ */
+normalized_ids_t normalize_spotify_ids(const std::vector<std::string> &ids_or_uris, bool dedup = true);
+
+/// @overload
+normalized_ids_t normalize_spotify_ids(std::span<const std::string_view> ids_or_uris, bool dedup = true);
+
+/**
+ * @brief Joins the base62 forms of a range of IDs with a separator, such as for the `ids` query parameter.
+ * @param ids The IDs to join.
+ * @param separator The text to put between IDs. Defaults to a url-encoded comma.
+ * @param first The index of the first ID to join.
+ * @param count The maximum number of IDs to join.
+ */
+std::string join_spotify_ids(const std::vector<spotify_id_t> &ids, std::string_view separator = "%2C", size_t first = 0, size_t count = SIZE_MAX);
+
+} // namespace spotify_api
+
+template <>
+struct std::hash<spotify_api::spotify_id_t>
+{
+	constexpr size_t operator()(const spotify_api::spotify_id_t &id) const noexcept { return id.hash(); }
+};
+
+#endif
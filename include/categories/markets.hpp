@@ -0,0 +1,198 @@
+#pragma once
+#ifndef _SPOTIFY_API_MARKET_SET_T_
+#define _SPOTIFY_API_MARKET_SET_T_
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace spotify_api
+{
+
+namespace markets
+{
+	/**
+	 * @brief Every ISO 3166-1 alpha-2 country code that Spotify may report as a market, in alphabetical order.
+	 * Also includes "XK" (Kosovo), which is not officially assigned but is used by Spotify.
+	 * The position of a code in this table is its bit index inside a @ref market_set_t.
+	 */
+	inline constexpr std::array<std::string_view, 250> codes = {
+		"AD", "AE", "AF", "AG", "AI", "AL", "AM", "AO", "AQ", "AR", "AS", "AT", "AU", "AW", "AX", "AZ",
+		"BA", "BB", "BD", "BE", "BF", "BG", "BH", "BI", "BJ", "BL", "BM", "BN", "BO", "BQ", "BR", "BS", "BT", "BV", "BW", "BY", "BZ",
+		"CA", "CC", "CD", "CF", "CG", "CH", "CI", "CK", "CL", "CM", "CN", "CO", "CR", "CU", "CV", "CW", "CX", "CY", "CZ",
+		"DE", "DJ", "DK", "DM", "DO", "DZ",
+		"EC", "EE", "EG", "EH", "ER", "ES", "ET",
+		"FI", "FJ", "FK", "FM", "FO", "FR",
+		"GA", "GB", "GD", "GE", "GF", "GG", "GH", "GI", "GL", "GM", "GN", "GP", "GQ", "GR", "GS", "GT", "GU", "GW", "GY",
+		"HK", "HM", "HN", "HR", "HT", "HU",
+		"ID", "IE", "IL", "IM", "IN", "IO", "IQ", "IR", "IS", "IT",
+		"JE", "JM", "JO", "JP",
+		"KE", "KG", "KH", "KI", "KM", "KN", "KP", "KR", "KW", "KY", "KZ",
+		"LA", "LB", "LC", "LI", "LK", "LR", "LS", "LT", "LU", "LV", "LY",
+		"MA", "MC", "MD", "ME", "MF", "MG", "MH", "MK", "ML", "MM", "MN", "MO", "MP", "MQ", "MR", "MS", "MT", "MU", "MV", "MW", "MX", "MY", "MZ",
+		"NA", "NC", "NE", "NF", "NG", "NI", "NL", "NO", "NP", "NR", "NU", "NZ",
+		"OM",
+		"PA", "PE", "PF", "PG", "PH", "PK", "PL", "PM", "PN", "PR", "PS", "PT", "PW", "PY",
+		"QA",
+		"RE", "RO", "RS", "RU", "RW",
+		"SA", "SB", "SC", "SD", "SE", "SG", "SH", "SI", "SJ", "SK", "SL", "SM", "SN", "SO", "SR", "SS", "ST", "SV", "SX", "SY", "SZ",
+		"TC", "TD", "TF", "TG", "TH", "TJ", "TK", "TL", "TM", "TN", "TO", "TR", "TT", "TV", "TW", "TZ",
+		"UA", "UG", "UM", "US", "UY", "UZ",
+		"VA", "VC", "VE", "VG", "VI", "VN", "VU",
+		"WF", "WS",
+		"XK",
+		"YE", "YT",
+		"ZA", "ZM", "ZW",
+	};
+
+	/// Maps every possible pair of letters ("AA" - "ZZ") to its index in @ref codes, or -1 if the pair is not a known market.
+	inline constexpr std::array<int16_t, 26 * 26> lookup_table = [] {
+		std::array<int16_t, 26 * 26> table{};
+		for (auto &entry : table) entry = -1;
+		for (size_t i = 0; i < codes.size(); i++)
+		{
+			table[(codes[i][0] - 'A') * 26 + (codes[i][1] - 'A')] = static_cast<int16_t>(i);
+		}
+		return table;
+	}();
+
+	/**
+	 * @brief Finds the bit index of a market code. Lowercase codes are accepted as well.
+	 * @returns The index of the code in @ref codes, or -1 if `market` is not a known market.
+	 */
+	constexpr int index_of(std::string_view market)
+	{
+		if (market.size() != 2) return -1;
+		// Folding to uppercase before the range check keeps this to two comparisons per letter.
+		unsigned int first = static_cast<unsigned char>(market[0] & ~0x20) - 'A';
+		unsigned int second = static_cast<unsigned char>(market[1] & ~0x20) - 'A';
+		if (first >= 26 || second >= 26) return -1;
+		return lookup_table[first * 26 + second];
+	}
+} // namespace markets
+
+/**
+ * @brief A compact set of Spotify markets, stored as one bit per known ISO 3166-1 alpha-2 country code.
+ * 
+ * Replaces a `std::vector<std::string>` of country codes (one heap string per market) with a fixed
+ * 32 byte bitset. Lookups are O(1) and set operations work a word at a time.
+ */
+class market_set_t
+{
+	public:
+	static constexpr size_t word_count = (markets::codes.size() + 63) / 64;
+
+	constexpr market_set_t() = default;
+
+	/// Creates a set from the raw bitset returned by @ref bits().
+	constexpr explicit market_set_t(const std::array<uint64_t, word_count> &bits): _bits(bits) {}
+
+	/**
+	 * @brief Adds a market to the set.
+	 * @returns false if `market` is not a known country code, in which case the set is unchanged.
+	 */
+	constexpr bool insert(std::string_view market)
+	{
+		int index = markets::index_of(market);
+		if (index < 0) return false;
+		_bits[index >> 6] |= uint64_t(1) << (index & 63);
+		return true;
+	}
+
+	/// Removes a market from the set if it is present.
+	constexpr void erase(std::string_view market)
+	{
+		int index = markets::index_of(market);
+		if (index < 0) return;
+		_bits[index >> 6] &= ~(uint64_t(1) << (index & 63));
+	}
+
+	/// @returns true if the set contains the given market.
+	constexpr bool contains(std::string_view market) const
+	{
+		int index = markets::index_of(market);
+		return index >= 0 && (_bits[index >> 6] >> (index & 63)) & 1;
+	}
+
+	/// @returns The number of markets in the set.
+	constexpr size_t size() const
+	{
+		size_t count = 0;
+		for (uint64_t word : _bits) count += std::popcount(word);
+		return count;
+	}
+
+	constexpr bool empty() const
+	{
+		for (uint64_t word : _bits) if (word) return false;
+		return true;
+	}
+
+	constexpr void clear() { _bits = {}; }
+
+	/// @returns true if at least one market is in both sets.
+	constexpr bool intersects(const market_set_t &other) const
+	{
+		uint64_t any = 0;
+		for (size_t i = 0; i < word_count; i++) any |= _bits[i] & other._bits[i];
+		return any != 0;
+	}
+
+	constexpr market_set_t &operator&=(const market_set_t &other)
+	{
+		for (size_t i = 0; i < word_count; i++) _bits[i] &= other._bits[i];
+		return *this;
+	}
+
+	constexpr market_set_t &operator|=(const market_set_t &other)
+	{
+		for (size_t i = 0; i < word_count; i++) _bits[i] |= other._bits[i];
+		return *this;
+	}
+
+	friend constexpr market_set_t operator&(market_set_t lhs, const market_set_t &rhs) { return lhs &= rhs; }
+
+	friend constexpr market_set_t operator|(market_set_t lhs, const market_set_t &rhs) { return lhs |= rhs; }
+
+	friend constexpr bool operator==(const market_set_t &lhs, const market_set_t &rhs) = default;
+
+	/**
+	 * @brief Calls `func` with the country code of every market in the set, in alphabetical order.
+	 */
+	template <typename Func>
+	constexpr void for_each(Func &&func) const
+	{
+		for (size_t word = 0; word < word_count; word++)
+		{
+			for (uint64_t bits = _bits[word]; bits; bits &= bits - 1)
+			{
+				func(markets::codes[word * 64 + std::countr_zero(bits)]);
+			}
+		}
+	}
+
+	/// @returns The raw bitset, where bit `i` corresponds to `markets::codes[i]`.
+	constexpr const std::array<uint64_t, word_count> &bits() const { return _bits; }
+
+	/// @returns The country codes in the set as a list of strings, in alphabetical order.
+	std::vector<std::string> to_vector() const;
+
+	/**
+	 * @brief Builds a market set directly from a json array of country codes.
+	 * Unknown country codes are ignored.
+	 * @param json_array The json array to convert. A null or missing value results in an empty set.
+	 */
+	static market_set_t from_json(const nlohmann::json &json_array);
+
+	private:
+	std::array<uint64_t, word_count> _bits{};
+};
+
+} // namespace spotify_api
+
+#endif
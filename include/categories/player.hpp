@@ -10,6 +10,7 @@
 
 #include "./tracks.hpp"
 #include "./episodes.hpp"
+#include "../string-pool.hpp"
 #include "../curl-util.hpp"
 
 #include <nlohmann/json.hpp>
@@ -30,7 +31,8 @@ struct playback_device_t
 	// Whether controlling this device is restricted. At present if this is "true" then no Web API commands will be accepted by this device.
 	bool is_restricted;
 	std::string name;
-	std::string type;
+	// The device type, such as "computer" or "smartphone"
+	interned_string_t type;
 	int volume_percent;
 	
 	static std::unique_ptr<playback_device_t> from_json(const std::string &json_string);
@@ -122,15 +124,16 @@ struct track_history_t
 
 struct recent_tracks_t
 {
+	/// Unix times in milliseconds to pass as `before` or `after` to get the neighbouring items, or -1 if there are none.
 	struct cursor_t
 	{
-		int before;
-		int after;
+		int64_t before = -1;
+		int64_t after = -1;
 	};
 	
 	std::string href;
 	int limit;
-	int total;
+	int total = 0;
 	std::string next;
 	std::vector<std::shared_ptr<track_history_t>> items;
 	
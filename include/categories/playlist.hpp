@@ -17,18 +17,33 @@ namespace spotify_api
 	{
 		bool collaborative;
 		std::string description = "";
+#ifndef SPOTIFY_API_COMPACT_LINKS
 		std::map<std::string, std::string> external_urls;
+#endif
 		follower_t followers;
+#ifndef SPOTIFY_API_COMPACT_LINKS
 		std::string href = "";
+#endif
 		std::string id = "";
 		std::vector<image_t> images;
 		std::string name = "";
 		owner_t owner;
 		bool is_public;
+		/// The version of the playlist. It changes whenever the playlist's tracks or details change.
 		std::string snapshot_id = "";
+		/// The tracks of the playlist. Simplified playlists only have the `href` and `total` of this page, without items.
 		spotify_api::page_t<std::shared_ptr<track_t>> tracks;
 		static const std::string type;
+#ifndef SPOTIFY_API_COMPACT_LINKS
 		std::string uri = "";
+#else
+		/// The href, uri and external urls of the playlist. Use @ref href(), @ref uri() and @ref external_urls() to read them.
+		entity_links_t links;
+
+		std::string href() const { return links.href(type, id); }
+		std::string uri() const { return links.uri(type, id); }
+		std::map<std::string, std::string> external_urls() const { return links.external_urls(type, id); }
+#endif
 
 		static std::unique_ptr<playlist_t> from_json(const std::string &json_string);
 
@@ -11,6 +11,7 @@
 #include <nlohmann/json.hpp>
 
 #include "./common.hpp"
+#include "./markets.hpp"
 
 namespace spotify_api
 {
@@ -22,13 +23,15 @@ struct track_t
 {
 	std::shared_ptr<album_t> album;
 	std::vector<std::shared_ptr<artist_t>> artists;
-	std::vector<std::string> available_markets;
+	market_set_t available_markets;
 	int disc_number;
 	int duration_ms;
 	bool is_explicit;
 	std::map<std::string, std::string> external_ids;
+#ifndef SPOTIFY_API_COMPACT_LINKS
 	std::map<std::string, std::string> external_urls;
 	std::string href;
+#endif
 	std::string id;
 	bool is_playable;
 	std::optional<std::shared_ptr<track_t>> linked_from;
@@ -38,12 +41,39 @@ struct track_t
 	std::string preview_url;
 	int track_number;
 	static const std::string type;
+#ifndef SPOTIFY_API_COMPACT_LINKS
 	std::string uri;
+#endif
 	bool is_local;
+#ifdef SPOTIFY_API_COMPACT_LINKS
+	/// The href, uri and external urls of the track. Use @ref href(), @ref uri() and @ref external_urls() to read them.
+	entity_links_t links;
+
+	std::string href() const { return links.href(type, id); }
+	std::string uri() const { return links.uri(type, id); }
+	std::map<std::string, std::string> external_urls() const { return links.external_urls(type, id); }
+#endif
 
 	static std::unique_ptr<track_t> from_json(const std::string &json_string, bool parse_linked_from = true);
 
 	static std::unique_ptr<track_t> from_json(const nlohmann::json &json_object, bool parse_linked_from = true);
+
+	/**
+	 * @brief Converts a json object into a track allocated from a memory resource.
+	 * The embedded album and artists are allocated from the same resource.
+	 * @param resource The memory resource to allocate from, or null for the heap. The track must not outlive it.
+	 */
+	static std::shared_ptr<track_t> from_json(const nlohmann::json &json_object, std::pmr::memory_resource *resource, bool parse_linked_from = true)
+	{
+		return from_json(json_object, decode_context_t{resource}, parse_linked_from);
+	}
+
+	/**
+	 * @brief Converts a json object into a track using the given @ref decode_context_t "context".
+	 * If the context has an entity store, a track that is already stored in at least as much detail is returned
+	 * without decoding it again, and the embedded album and artists are shared through the store.
+	 */
+	static std::shared_ptr<track_t> from_json(const nlohmann::json &json_object, const decode_context_t &context, bool parse_linked_from = true);
 };
 
 struct audio_features_t
@@ -110,13 +140,13 @@ struct audio_analysis_t
 		int mode;
 		double mode_confidence;
 		std::string codestring;
-		std::string code_version;
+		double code_version;
 		std::string echoprintstring;
-		std::string echoprint_version;
+		double echoprint_version;
 		std::string synchstring;
-		std::string synch_version;
+		double synch_version;
 		std::string rhythmstring;
-		std::string rhythm_version;
+		double rhythm_version;
 		
 		static std::unique_ptr<track_t> from_json(const std::string &json_string);
 
@@ -174,8 +204,8 @@ struct audio_analysis_t
 		double loudness_max;
 		double loudness_max_time;
 		double loudness_end;
-		std::vector<int> pitches;
-		std::vector<int> timbre;
+		std::vector<double> pitches;
+		std::vector<double> timbre;
 		
 		static std::unique_ptr<segment_t> from_json(const std::string &json_string);
 
@@ -227,7 +257,8 @@ struct recommendation_seed_t
 
 struct recommendation_filter_t
 {
-	unsigned int limit;
+	// 0 uses the default: 20 tracks for /recommendations, every match for a feature_filter_t
+	unsigned int limit = 0;
 	std::string market;
 	std::vector<std::string> seed_artists;
 	std::vector<std::string> seed_genres;
@@ -2,6 +2,7 @@
 #define _CURL_UTIL_FILE_
 
 #include <curl/curl.h>
+#include <memory>
 #include <string>
 #include <iomanip>
 #include <cstring>
@@ -28,8 +29,17 @@ namespace http
 		METHOD_HEAD
 	};
 
+	class response_cache_t;
+
 	std::string url_encode(const std::string &to_encode);
 
+	/**
+	 * @brief Sets the disk cache that @ref get reads from and writes to, or removes it when passed nullptr.
+	 * Only successful responses from endpoints with a time to live in the cache's options are stored, and never the ones that
+	 * depend on the user, see @ref response_cache_t::is_user_specific.
+	 */
+	void set_response_cache(std::shared_ptr<response_cache_t> cache);
+
 	api_response get(const char *url, const std::string &query_data, const std::string &auth_token);
 	api_response post(const char *url, const std::string &post_data, const std::string &auth_header_value, bool is_token);
 	api_response request(const char *url, REQUEST_METHOD method, const std::string &body_data, const std::string &auth_header_value, bool is_token);
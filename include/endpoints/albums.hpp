@@ -15,6 +15,8 @@
 #include "../categories/common.hpp"
 #include "../categories/albums.hpp"
 #include "../categories/tracks.hpp"
+#include "../entity-cache.hpp"
+#include "../paging.hpp"
 
 namespace spotify_api
 {
@@ -26,6 +28,8 @@ class Album_API
 {
 	public:
 	std::string access_token;
+	/// Serves @ref get_album and @ref get_albums from memory when set. Null (no caching) by default.
+	std::shared_ptr<entity_cache_t<album_t>> cache;
 
 	Album_API(std::string access_token): access_token(access_token) {}
 
@@ -40,10 +44,11 @@ class Album_API
 	
 	/**
 	 * @brief Retrieves info on multiple albums from Spotify using their IDs.
+	 * Cached albums are served from @ref cache and only the others are requested, 20 per request, several requests at a time.
 	 * @param album_ids The [Spotify IDs](https://developer.spotify.com/documentation/web-api/concepts/spotify-uris-ids) of the albums to retrieve
 	 * @note Endpoint: /albums
 	 * @note Docs: https://developer.spotify.com/documentation/web-api/reference/get-multiple-albums
-	 * @returns A list of @ref album_t "albums".
+	 * @returns One @ref album_t "album" per ID, in the same order, null for invalid IDs and albums that were not found.
 	*/
 	std::vector<std::unique_ptr<album_t>> get_albums(const std::vector<std::string> &album_ids);
 
@@ -60,6 +65,15 @@ class Album_API
 	 */
 	page_t<std::unique_ptr<track_t>> get_album_tracks(const std::string &album_id, uint32_t limit = 20, uint32_t offset = 0, const std::string &market = "");
 
+	/**
+	 * @brief Gets every track of an album. The first page gives the total, then the other pages are requested several at a time.
+	 * @param album_id The [Spotify ID](https://developer.spotify.com/documentation/web-api/concepts/spotify-uris-ids) of the album
+	 * @param market An ISO 3166-1 alpha-2 country code, or an empty string
+	 * @note Endpoint: /albums/{album_id}/tracks
+	 * @returns The @ref track_t "tracks" of the album, in order.
+	 */
+	all_pages_t<std::unique_ptr<track_t>> get_all_album_tracks(const std::string &album_id, const std::string &market = "");
+
 	/**
 	 * @brief Retrieves a list of albums that a user has saved in their "Your Music" library.
 	 * @param limit The maximum number of items to return. Range: 0 - 50
@@ -72,6 +86,24 @@ class Album_API
 	*/
 	page_t<std::unique_ptr<album_t>> get_users_albums(uint32_t limit = 20, uint32_t offset = 0, const std::string &market = "");
 
+	/**
+	 * @brief Retrieves every album that the user has saved. The first page gives the total, then the other pages are requested several at a time.
+	 * @param market An ISO 3166-1 alpha-2 country code, or an empty string
+	 * @param max_items Stop after this many albums
+	 * @note Endpoint: /me/albums
+	 * @returns The @ref album_t "albums" that the user has saved, most recently saved first.
+	*/
+	all_pages_t<std::unique_ptr<album_t>> get_all_users_albums(const std::string &market = "", size_t max_items = SIZE_MAX);
+
+	/**
+	 * @brief Passes every album that the user has saved to `visit`, one at a time. Albums are released once visited,
+	 * so memory use does not grow with the size of the library, unlike @ref get_all_users_albums.
+	 * @param visit Called with each album, most recently saved first. Returns false to stop.
+	 * @param market An ISO 3166-1 alpha-2 country code, or an empty string
+	 * @note Endpoint: /me/albums
+	*/
+	visit_result_t for_each_users_album(const std::function<bool(std::unique_ptr<album_t> album)> &visit, const std::string &market = "");
+
 	/**
 	 * @brief Saves a list of albums to the user's library by their IDs.
 	 * @param album_ids The [Spotify IDs](https://developer.spotify.com/documentation/web-api/concepts/spotify-uris-ids)
@@ -111,6 +143,14 @@ class Album_API
 	 * @returns A list containing information about the new albums.
 	 */
 	page_t<std::unique_ptr<album_t>> get_new_releases(uint32_t limit = 20, uint32_t offset = 0, const std::string &country = "");
+
+	/**
+	 * @brief Gets every new album release. The first page gives the total, then the other pages are requested several at a time.
+	 * @param country An ISO 3166-1 alpha-2 country code, or an empty string
+	 * @param max_items Stop after this many albums
+	 * @note Endpoint: /browse/new-releases
+	 */
+	all_pages_t<std::unique_ptr<album_t>> get_all_new_releases(const std::string &country = "", size_t max_items = SIZE_MAX);
 };
 
 } // namespace spotify_api
@@ -12,6 +12,8 @@
 #include "../categories/common.hpp"
 #include "../categories/tracks.hpp"
 #include "../categories/albums.hpp"
+#include "../entity-cache.hpp"
+#include "../paging.hpp"
 
 namespace spotify_api
 {
@@ -19,15 +21,23 @@ namespace spotify_api
 	{
 	public:
 		std::string access_token;
+		/// Serves @ref get_artist and @ref get_artists from memory when set. Null (no caching) by default.
+		std::shared_ptr<entity_cache_t<artist_t>> cache;
 
 		Artist_API(std::string access_token): access_token(access_token) {}
 
 		std::unique_ptr<artist_t> get_artist(const std::string &artist_id);
 
+		/// @returns One artist per ID, in the same order, null for invalid IDs and artists that were not found. Cached artists are not requested again,
+		/// the others are requested 50 per request, several requests at a time.
 		std::vector<std::unique_ptr<artist_t>> get_artists(const std::vector<std::string> &artist_ids);
 
 		page_t<std::unique_ptr<album_t>> get_albums_from_artist(const std::string &artist_id, std::vector<std::string> &include_groups, std::string &market, uint8_t limit, uint32_t offset);
 
+		/// @returns Every album of the artist in the given groups (all groups when empty). The first page gives the total,
+		/// then the other pages are requested several at a time.
+		all_pages_t<std::unique_ptr<album_t>> get_all_albums_from_artist(const std::string &artist_id, const std::vector<std::string> &include_groups = {}, const std::string &market = "");
+
 		std::vector<std::unique_ptr<track_t>> get_artist_top_tracks(const std::string &artist_id, const std::string &market);
 
 		std::vector<std::unique_ptr<artist_t>> get_related_artists(const std::string &artist_id);
@@ -62,65 +62,54 @@ public:
 	* --  uris: A JSON array of the Spotify track URIs to play.
 	* --  offset: A zero-based index that indicates from where in the context playback should start. Only available when context_uri corresponds to an album or playlist object
 	* --  position_ms: Specifies where in the track to start playback
+	* --  device_id: (Optional) The device to target. Default: the active device
+	* Returns: true if successful, false otherwise
 	* Documentation: https://developer.spotify.com/documentation/web-api/reference/start-a-users-playback
 	*/
-	void start_or_resume_playback(const std::string &context_uri, const std::vector<std::string> &uris, int offset, int position_ms);
+	bool start_or_resume_playback(const std::string &context_uri, const std::vector<std::string> &uris, int offset, int position_ms, const std::string &device_id = "");
 
 	//TODO: create wrapper functions to automatically play specific stuff
 
 	/*
 	* Usage: Pause playback on the user's active device.
 	* Endpoint: /me/player/pause
-	* Parameters: none
+	* Parameters:
+	* --  device_id: (Optional) The device to target. Default: the active device
+	* Returns: true if successful, false otherwise
 	* Documentation: https://developer.spotify.com/documentation/web-api/reference/#/operations/pause-a-users-playback
 	*/
-	void pause_playback();
+	bool pause_playback(const std::string &device_id = "");
 
 	/*
 	* Usage: Skip playback to the previous song in the queue
 	* Endpoint: /me/player/previous
-	* Parameters: none
+	* Parameters:
+	* --  device_id: (Optional) The device to target. Default: the active device
 	* Returns: true if successful, false otherwise
 	* Documentation: https://developer.spotify.com/documentation/web-api/reference/#/operations/skip-users-playback-to-previous-track
 	*/
-	bool inline skip_to_previous(const std::string &access_token)
-	{
-		http::api_response response = http::post(API_PREFIX "/me/player/previous", std::string(""), access_token, true);
-		if (response.code == 204)
-		{
-			return true;
-		}
-		else
-		{
-			return false;
-		}
-	}
+	bool skip_to_previous(const std::string &device_id = "");
 
 	/*
 	* Usage: Skip playback to the next song in the queue
-	* Endpoint: /me/player/previous
-	* Parameters: none
+	* Endpoint: /me/player/next
+	* Parameters:
+	* --  device_id: (Optional) The device to target. Default: the active device
 	* Returns: true if successful, false otherwise
 	* Documentation: https://developer.spotify.com/documentation/web-api/reference/#/operations/skip-users-playback-to-next-track
 	*/
-	bool inline skip_to_next(const std::string &access_token)
-	{
-		http::api_response response = http::post(API_PREFIX "/me/player/next", std::string(""), access_token, true);
-		if (response.code == 204)
-			return true;
-		else
-			return false;
-	}
+	bool skip_to_next(const std::string &device_id = "");
 
 	/*
 		* Usage: Seeks to the given position in the user’s currently playing track.
 		* Endpoint: /me/player/seek
 		* Parameters:
 		* -- position_ms: The position in milliseconds to seek to. Must be a positive number. Passing in a position that is greater than the length of the track will cause the player to start playing the next song.
-		* Returns: void
+		* -- device_id: (Optional) The device to target. Default: the active device
+		* Returns: true if successful, false otherwise
 		* Documentation: https://developer.spotify.com/documentation/web-api/reference/seek-to-position-in-currently-playing-track
 	*/
-	void seek_to_position(int position_ms);
+	bool seek_to_position(int position_ms, const std::string &device_id = "");
 	
 	enum class REPEAT_MODE
 	{
@@ -134,41 +123,47 @@ public:
 		* Endpoint: /me/player/repeat
 		* Parameters:
 		* -- state: Can be either track, context or off. "track" will repeat the current track. "context" will repeat the current context. "off" will turn repeat off.
-		* Returns: void
+		* -- device_id: (Optional) The device to target. Default: the active device
+		* Returns: true if successful, false otherwise
 		* Documentation: https://developer.spotify.com/documentation/web-api/reference/seek-to-position-in-currently-playing-track
 	*/
-	void set_repeat_mode(REPEAT_MODE state);
+	bool set_repeat_mode(REPEAT_MODE state, const std::string &device_id = "");
 
 	/*
 		* Usage: Set the volume for the user’s current playback device.
 		* Endpoint: /me/player/volume
 		* Parameters:
 		* -- volume_percent: The volume to set. Must be a value from 0 to 100 inclusive.
-		* Returns: void
+		* -- device_id: (Optional) The device to target. Default: the active device
+		* Returns: true if successful, false otherwise
+		* Note: This blocks for a whole request. Send the values of sliders through a player_command_coalescer_t instead.
 		* Documentation: https://developer.spotify.com/documentation/web-api/reference/set-volume-for-users-playback
 	*/
-	void set_volume(int volume_percent);
+	bool set_volume(int volume_percent, const std::string &device_id = "");
 
 	/**
 	 * @brief Toggle shuffle on or off for user’s playback.
 	 * @param state the new shuffle state. true to shuffle, and false to not shuffle
+	 * @param device_id (Optional) The device to target. Default: the active device
+	 * @returns true if successful, false otherwise
 	 * @note Endpoint: /me/player/suffle
 	 * @note Documentation: https://developer.spotify.com/documentation/web-api/reference/toggle-shuffle-for-users-playback
 	*/
-	void set_shuffle(bool state);
+	bool set_shuffle(bool state, const std::string &device_id = "");
 
 
 
 	/**
 	 * @brief Get tracks from the current user's recently played tracks. Note: Currently doesn't support podcast episodes.
 	 * @param limit (Optional) The maximum number of items to return. Default: 20. Minimum: 1. Maximum: 50.
-	 * @param timestamp (Optional) A unix timestamp. This will return all items before or after (but not including) this timestamp.
+	 * @param timestamp (Optional) A unix timestamp in milliseconds. This will return all items before or after (but not including) this timestamp.
 	 * @param after (Optional) If true, will return all items after the specified timestamp. If false, will return all items before the timestamp.
 	 * @returns A list of tracks the user has recently played
 	 * @note Endpoint: /me/player/recently-player
 	 * @note Docs: https://developer.spotify.com/documentation/web-api/reference/get-recently-played
+	 * @note Use a @ref recently_played_poller_t to follow the history continuously.
 	*/
-	std::unique_ptr<recent_tracks_t> get_recently_played_tracks(int limit, unsigned int timestamp, bool after);
+	std::unique_ptr<recent_tracks_t> get_recently_played_tracks(int limit = 20, int64_t timestamp = 0, bool after = false);
 
 	/**
 	 * @brief Get all items currently in the user's queue
@@ -182,8 +177,10 @@ public:
 	 * @brief Adds the specified item to the user's playback queue
 	 * @note Endpoint: /me/player/queue
 	 * @param item_uri The Spotify URI of the item to add. Track and episode URIs allowed only.
+	 * @param device_id (Optional) The device to target. Default: the active device
+	 * @returns true if successful, false otherwise
 	*/
-	void add_item_to_playback_queue(const std::string &item_uri);
+	bool add_item_to_playback_queue(const std::string &item_uri, const std::string &device_id = "");
 };
 
 } // namespace spotify_api
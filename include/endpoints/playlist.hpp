@@ -10,6 +10,8 @@
 #include "../categories/common.hpp"
 #include "../categories/tracks.hpp"
 #include "../categories/playlist.hpp"
+#include "../playlist-cache.hpp"
+#include "../paging.hpp"
 
 #include <nlohmann/json.hpp>
 
@@ -20,10 +22,69 @@ class Playlist_API
 {
 public:
 	std::string access_token;
+	/// Keeps the playlists returned by @ref get_playlist when set. Null (no caching) by default.
+	std::shared_ptr<playlist_cache_t> cache;
+
 	Playlist_API(std::string access_token): access_token(access_token) {}
 
-	std::unique_ptr<playlist_t> get_playlist();
+	/**
+	 * @brief Get a playlist with every one of its tracks.
+	 * If the playlist is in @ref cache for the same market, only its snapshot ID is requested, and the tracks are downloaded
+	 * again only if it changed. The returned playlist is a copy that does not share its tracks with the cache.
+	 * @note Endpoint: /playlists/{playlist_id}
+	 * @param playlist_id The ID or URI of the playlist
+	 * @param market A country code, or an empty string
+	 * @returns The playlist, or null if the request failed. Items that are not tracks, such as episodes, are null.
+	 */
+	std::unique_ptr<playlist_t> get_playlist(const std::string &playlist_id, const std::string &market = "");
+
+	/**
+	 * @brief Get the playlists the user owns or follows, without their tracks.
+	 * The first page gives the total, then the other pages are requested several at a time.
+	 * @note Endpoint: /me/playlists
+	 * @param limit The most playlists to return, or 0 for all of them
+	 * @note Use @ref for_each_my_playlist to go through them without holding all of them at once.
+	 */
 	std::vector<std::shared_ptr<playlist_t>> get_my_playlists(int limit = 0);
+
+	/**
+	 * @brief Passes the playlists the user owns or follows to `visit`, one at a time, without their tracks.
+	 * Playlists are released once visited, so memory use does not grow with their number.
+	 * @note Endpoint: /me/playlists
+	 * @param visit Called with each playlist. Returns false to stop.
+	 */
+	visit_result_t for_each_my_playlist(const std::function<bool(std::unique_ptr<playlist_t> playlist)> &visit);
+
+	/**
+	 * @brief Go through the tracks of a playlist one by one, while the next pages download in the background.
+	 * Only the pages that are read, and up to `prefetch_pages` after them, are requested. The cache is not used.
+	 * @note Endpoint: /playlists/{playlist_id}/tracks
+	 * @param playlist_id The ID or URI of the playlist
+	 * @param market A country code, or an empty string
+	 * @param prefetch_pages The most pages downloaded ahead of the track being read
+	 * @returns The tracks, with null for items that are not tracks, as in @ref get_playlist
+	 */
+	paged_range_t<std::shared_ptr<track_t>> iterate_playlist_tracks(const std::string &playlist_id, const std::string &market = "", size_t prefetch_pages = 2);
+
+	/**
+	 * @brief Passes the tracks of a playlist to `visit`, one at a time. Tracks are released once visited, so memory
+	 * use does not grow with the length of the playlist, unlike @ref get_playlist. The cache is not used.
+	 * @note Endpoint: /playlists/{playlist_id}/tracks
+	 * @param visit Called with each track, null for items that are not tracks. Returns false to stop.
+	 */
+	visit_result_t for_each_playlist_track(const std::string &playlist_id, const std::function<bool(std::shared_ptr<track_t> track)> &visit, const std::string &market = "");
+
+	/**
+	 * @brief Brings every playlist in @ref cache that is stored for `market` up to date.
+	 * The snapshot IDs of the user's playlists are read from /me/playlists, 50 at a time, and only the playlists whose
+	 * snapshot changed are downloaded again. Cached playlists the user does not follow are checked one by one.
+	 * @returns The IDs of the playlists that changed
+	 */
+	std::vector<std::string> refresh_cached_playlists(const std::string &market = "");
+
+	private:
+	// Downloads a playlist and the rest of its track pages, without looking at the cache
+	std::unique_ptr<playlist_t> fetch_playlist(const std::string &playlist_id, const std::string &market_query);
 };
 
 } // namespace spotify_api
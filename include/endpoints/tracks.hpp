@@ -12,6 +12,10 @@
 
 #include "../categories/common.hpp"
 #include "../categories/tracks.hpp"
+#include "../categories/analysis.hpp"
+#include "../entity-cache.hpp"
+#include "../multi-get.hpp"
+#include "../paging.hpp"
 
 namespace spotify_api
 {
@@ -19,14 +23,52 @@ class Track_API
 {
 	public:
 	std::string access_token;
+	/// Serves @ref get_track and @ref get_tracks from memory when set. Null (no caching) by default.
+	std::shared_ptr<entity_cache_t<track_t>> cache;
+
 	Track_API(std::string access_token): access_token(access_token) {}
 	
 	std::unique_ptr<track_t> get_track(const std::string &track_id, const std::string &market);
 
+	/**
+	 * @brief Get any number of tracks. Cached tracks are served from @ref cache and only the others are requested,
+	 * 50 per request, several requests at a time.
+	 * @note Endpoint: /tracks
+	 * @param track_ids The IDs or URIs of the tracks
+	 * @param market A country code, or an empty string
+	 * @returns One track per ID, in the same order, null for invalid IDs and tracks that were not found
+	 */
 	std::vector<std::unique_ptr<track_t>> get_tracks(const std::vector<std::string> &track_ids, const std::string &market);
 
 	page_t<std::unique_ptr<track_t>> get_saved_tracks(const std::string &market, uint8_t limit, unsigned int offset);
 
+	/**
+	 * @brief Get every track in the user's library. The first page gives the total, then the other pages are requested several at a time.
+	 * @note Endpoint: /me/tracks
+	 * @param market A country code, or an empty string
+	 * @param max_items Stop after this many tracks
+	 * @returns The tracks, most recently saved first
+	 */
+	all_pages_t<std::unique_ptr<track_t>> get_all_saved_tracks(const std::string &market = "", size_t max_items = SIZE_MAX);
+
+	/**
+	 * @brief Go through the tracks in the user's library one by one, while the next pages download in the background.
+	 * Only the pages that are read, and up to `prefetch_pages` after them, are requested.
+	 * @note Endpoint: /me/tracks
+	 * @param market A country code, or an empty string
+	 * @param prefetch_pages The most pages downloaded ahead of the track being read
+	 */
+	paged_range_t<std::unique_ptr<track_t>> iterate_saved_tracks(const std::string &market = "", size_t prefetch_pages = 2);
+
+	/**
+	 * @brief Pass every track in the user's library to `visit`, one at a time. Tracks are released once visited,
+	 * so memory use does not grow with the size of the library, unlike @ref get_all_saved_tracks.
+	 * @note Endpoint: /me/tracks
+	 * @param visit Called with each track, null for tracks that are no longer available. Returns false to stop.
+	 * @param market A country code, or an empty string
+	 */
+	visit_result_t for_each_saved_track(const std::function<bool(std::unique_ptr<track_t> track)> &visit, const std::string &market = "");
+
 	void save_tracks(const std::vector<std::string> &track_ids);
 
 	void remove_saved_tracks(const std::vector<std::string> &track_ids);
@@ -35,9 +77,23 @@ class Track_API
 
 	std::unique_ptr<audio_features_t> get_audio_features_for_track(const std::string &track_id);
 
+	/**
+	 * @brief Get the audio features of any number of tracks, 100 per request, several requests at a time.
+	 * @note Endpoint: /audio-features
+	 * @param track_ids The IDs or URIs of the tracks
+	 * @returns One entry per ID, in the same order, null for invalid IDs, tracks without features, or when the request for their batch failed
+	 */
 	std::vector<std::unique_ptr<audio_features_t>> get_audio_features_for_tracks(const std::vector<std::string> &track_ids);
 
 	std::unique_ptr<audio_analysis_t> get_audio_analysis_for_track(const std::string &track_id);
+
+	/**
+	 * @brief Get the audio analysis for a track, stored column by column.
+	 * @note Endpoint: /audio-analysis/{id}
+	 * @param track_id The ID or URI of the track
+	 * @returns The analysis, or null if the request failed
+	 */
+	std::unique_ptr<columnar_analysis_t> get_columnar_audio_analysis_for_track(const std::string &track_id);
 	
 	
 	// I wish this type could be shorter. :(
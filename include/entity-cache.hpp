@@ -0,0 +1,160 @@
+#pragma once
+#ifndef _SPOTIFY_API_ENTITY_CACHE_
+#define _SPOTIFY_API_ENTITY_CACHE_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "categories/ids.hpp"
+#include "categories/markets.hpp"
+#include "categories/tracks.hpp"
+#include "categories/albums.hpp"
+#include "categories/artists.hpp"
+#include "multi-get.hpp"
+
+namespace spotify_api
+{
+
+/**
+ * @brief A bounded in-memory cache of tracks, albums or artists by ID, shared between threads.
+ *
+ * The cache is split into shards by ID, each with its own lock, so lookups of different IDs rarely wait on each other.
+ * Each shard uses segmented LRU eviction: new entries start in a probation segment and only move to the
+ * protected segment when they are requested again. A scan over many IDs that are each requested once
+ * can then only push out other entries on probation, never the popular ones.
+ *
+ * Entries are immutable and shared, so a hit costs a copy of the entity, not a request or a json decode.
+ * Responses that depend on the market are cached per market.
+ */
+template <class T>
+class entity_cache_t
+{
+	public:
+	struct key_t
+	{
+		spotify_id_t id;
+		/// The market index from @ref markets::index_of, or -1 for requests without a market.
+		int16_t market = -1;
+
+		friend bool operator==(const key_t &lhs, const key_t &rhs) = default;
+	};
+
+	/**
+	 * @param capacity The maximum number of entries
+	 * @param shard_count The number of independently locked shards
+	 */
+	explicit entity_cache_t(size_t capacity = 4096, size_t shard_count = 16);
+
+	entity_cache_t(const entity_cache_t &) = delete;
+	entity_cache_t &operator=(const entity_cache_t &) = delete;
+
+	/**
+	 * @brief Builds the key of a request.
+	 * @returns false if the request can not be cached, because the ID is not valid or the market is not a
+	 * country code (such as "from_token", which depends on the user)
+	 */
+	static bool make_key(std::string_view id_or_uri, std::string_view market, key_t &key);
+
+	/// @returns The cached entity, or null on a miss.
+	std::shared_ptr<const T> find(const key_t &key);
+
+	/// Adds an entity, or replaces the cached one with the same key.
+	void insert(const key_t &key, std::shared_ptr<const T> entity);
+
+	void erase(const key_t &key);
+	void clear();
+
+	size_t size() const;
+	size_t capacity() const { return this->_shard_capacity * this->_shards.size(); }
+
+	/**
+	 * @brief Gets many entities at once, serving the cached ones locally and fetching only the rest.
+	 * The missing IDs are deduplicated and passed to `fetch` in batches of at most `batch_size`, several batches
+	 * at a time (see @ref fetch_in_batches).
+	 * Works without a cache too, in which case every ID is fetched.
+	 * @param cache The cache to use, or null
+	 * @param ids The IDs to get. Duplicates are allowed.
+	 * @param market The market index of the request, or -1
+	 * @param batch_size The maximum number of IDs the endpoint accepts per request
+	 * @param fetch Requests one batch. Returns one entity per ID in the batch, in the same order, null for IDs that were not found.
+	 * Called from several threads at once.
+	 * @returns One entity per ID in `ids`, null for IDs that were not found
+	 */
+	template <class Fetch>
+	static std::vector<std::unique_ptr<T>> get_many(entity_cache_t *cache, const std::vector<spotify_id_t> &ids, int16_t market, size_t batch_size, Fetch &&fetch)
+	{
+		std::vector<std::shared_ptr<const T>> found(ids.size());
+		std::vector<spotify_id_t> missing;
+		std::unordered_map<spotify_id_t, size_t> missing_positions;
+
+		for (size_t i = 0; i < ids.size(); i++)
+		{
+			if (cache && (found[i] = cache->find(key_t{ids[i], market}))) continue;
+			if (missing_positions.try_emplace(ids[i], missing.size()).second) missing.push_back(ids[i]);
+		}
+
+		std::vector<std::unique_ptr<T>> entities = fetch_in_batches<T>(std::span<const spotify_id_t>(missing), batch_size, fetch);
+		std::vector<std::shared_ptr<const T>> fetched(missing.size());
+		for (size_t i = 0; i < missing.size(); i++)
+		{
+			if (!entities[i]) continue;
+			fetched[i] = std::shared_ptr<const T>(std::move(entities[i]));
+			if (cache) cache->insert(key_t{missing[i], market}, fetched[i]);
+		}
+
+		std::vector<std::unique_ptr<T>> output;
+		output.reserve(ids.size());
+		for (size_t i = 0; i < ids.size(); i++)
+		{
+			const std::shared_ptr<const T> &entity = found[i] ? found[i] : fetched[missing_positions[ids[i]]];
+			output.push_back(entity ? std::make_unique<T>(*entity) : std::unique_ptr<T>(nullptr));
+		}
+		return output;
+	}
+
+	private:
+	struct node_t
+	{
+		key_t key;
+		std::shared_ptr<const T> entity;
+		bool is_protected;
+	};
+
+	struct key_hash_t
+	{
+		size_t operator()(const key_t &key) const noexcept { return key.id.hash() ^ static_cast<size_t>(key.market + 1); }
+	};
+
+	struct shard_t
+	{
+		std::mutex mutex;
+		/// Entries that were requested once, most recent first
+		std::list<node_t> probation;
+		/// Entries that were requested again while on probation, most recent first
+		std::list<node_t> protected_entries;
+		std::unordered_map<key_t, typename std::list<node_t>::iterator, key_hash_t> positions;
+	};
+
+	shard_t &shard_of(const key_t &key) { return *this->_shards[key.id.high() % this->_shards.size()]; }
+
+	// Must be called with the shard's lock held
+	void promote(shard_t &shard, typename std::list<node_t>::iterator node);
+	void trim(shard_t &shard);
+
+	std::vector<std::unique_ptr<shard_t>> _shards;
+	size_t _shard_capacity;
+	size_t _protected_capacity;
+};
+
+} // namespace spotify_api
+
+#endif
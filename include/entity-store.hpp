@@ -0,0 +1,95 @@
+#pragma once
+#ifndef _SPOTIFY_API_ENTITY_STORE_
+#define _SPOTIFY_API_ENTITY_STORE_
+
+#include <cstddef>
+#include <memory>
+#include <shared_mutex>
+#include <tuple>
+#include <unordered_map>
+
+#include <nlohmann/json.hpp>
+
+#include "categories/ids.hpp"
+#include "categories/tracks.hpp"
+#include "categories/albums.hpp"
+#include "categories/artists.hpp"
+
+namespace spotify_api
+{
+
+/**
+ * @brief An identity map that keeps a single shared instance of every track, album and artist by ID.
+ * 
+ * Pass a store to `from_json` through a @ref decode_context_t and every occurrence of the same entity
+ * in a response, or across responses, resolves to the same object. Embedded objects that the store already
+ * holds in at least as much detail are not decoded again.
+ * 
+ * Objects come in two levels of detail: the simplified form embedded in other objects, and the full form
+ * returned when requesting the object itself. When a full object arrives for an ID that only has a simplified
+ * one stored, the full object replaces it in the store. Stored instances are never modified, so pointers handed
+ * out before keep the simplified object, and stored entities can be read while another thread decodes into the
+ * same store. The store's own tables are guarded by a reader/writer lock.
+ * 
+ * Entities allocated from a memory resource must not outlive it, so a store used with a resource
+ * should be cleared or destroyed before the resource is released.
+ * Objects without a valid ID (local tracks for example) are never stored.
+ */
+class entity_store_t
+{
+	public:
+	entity_store_t() = default;
+	entity_store_t(const entity_store_t &) = delete;
+	entity_store_t &operator=(const entity_store_t &) = delete;
+
+	/**
+	 * @brief Finds the stored entity for a json object, if it is stored in at least as much detail.
+	 * @returns The stored entity, or null if it has to be decoded.
+	 */
+	template <class T>
+	std::shared_ptr<T> lookup(const nlohmann::json &json_object) const;
+
+	/**
+	 * @brief Adds a freshly decoded entity to the store.
+	 * @param entity The decoded entity
+	 * @param json_object The json object `entity` was decoded from, used to tell how detailed it is
+	 * @returns The stored instance for the entity's ID. This is `entity` itself unless the ID was already stored
+	 * in at least as much detail.
+	 */
+	template <class T>
+	std::shared_ptr<T> insert(std::shared_ptr<T> entity, const nlohmann::json &json_object);
+
+	/// @returns The stored entity with the given ID, or null if there is none.
+	template <class T>
+	std::shared_ptr<T> find(const spotify_id_t &id) const;
+
+	/// @returns The total number of stored entities.
+	size_t size() const;
+
+	/// Removes every entity. Pointers handed out before stay valid.
+	void clear();
+
+	private:
+	template <class T>
+	struct entry_t
+	{
+		std::shared_ptr<T> entity;
+		int detail;
+	};
+
+	template <class T>
+	using table_t = std::unordered_map<spotify_id_t, entry_t<T>>;
+
+	template <class T>
+	table_t<T> &table() { return std::get<table_t<T>>(this->_tables); }
+
+	template <class T>
+	const table_t<T> &table() const { return std::get<table_t<T>>(this->_tables); }
+
+	mutable std::shared_mutex _mutex;
+	std::tuple<table_t<track_t>, table_t<album_t>, table_t<artist_t>> _tables;
+};
+
+} // namespace spotify_api
+
+#endif
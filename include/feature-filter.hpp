@@ -0,0 +1,87 @@
+#pragma once
+#ifndef _SPOTIFY_API_FEATURE_FILTER_
+#define _SPOTIFY_API_FEATURE_FILTER_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "categories/tracks.hpp"
+#include "feature-index.hpp"
+
+namespace spotify_api
+{
+
+/**
+ * @brief A @ref recommendation_filter_t compiled to run over a @ref feature_matrix_t, without calling /recommendations.
+ *
+ * Every min and max value becomes a bound on the matching column of the matrix, in the matrix's normalized units,
+ * and every target value becomes part of a distance. The key, loudness and tempo bounds are checked against the raw
+ * values instead, since their normalized values saturate. Unused values become open bounds and zero weights,
+ * so every row is checked with the same vectorized code no matter which values are set.
+ *
+ * The seeds, the market, the popularity values and the duration and time signature targets are ignored:
+ * they depend on data the matrix does not have or has only as bounds.
+ * Use a @ref feature_index_t to find tracks similar to a seed track.
+ */
+class feature_filter_t
+{
+	public:
+	struct candidate_t
+	{
+		/// The row index in the matrix.
+		size_t index;
+		/// The distance to the filter's targets, or 0 if the filter has no targets.
+		float score;
+	};
+
+	/// Compiles a filter. The filter's `limit` becomes the default number of results; 0 means no limit.
+	explicit feature_filter_t(const recommendation_filter_t &filter);
+
+	/// @returns Whether a single row passes the filter.
+	bool matches(const feature_matrix_t &matrix, size_t index) const;
+
+	/**
+	 * @brief Finds the rows that pass the filter, closest to the targets first.
+	 * Returns at most as many rows as the compiled filter's limit.
+	 */
+	std::vector<candidate_t> apply(const feature_matrix_t &matrix) const { return this->apply(matrix, this->_limit); }
+
+	/**
+	 * @brief Finds the rows that pass the filter, closest to the targets first.
+	 * @param matrix The rows to filter
+	 * @param limit The maximum number of results, or 0 for all of them
+	 */
+	std::vector<candidate_t> apply(const feature_matrix_t &matrix, size_t limit) const;
+
+	/// @returns Whether the filter has any target values, so results are ranked.
+	bool has_targets() const { return this->_has_targets; }
+
+	private:
+	// Applies the checks on the columns outside the rows, turning failing scores into infinity
+	void apply_extra_bounds(const feature_matrix_t &matrix, size_t first, std::vector<float> &scores) const;
+
+	feature_matrix_t::row_t _lower;
+	feature_matrix_t::row_t _upper;
+	feature_matrix_t::row_t _target;
+	feature_matrix_t::row_t _weights;
+
+	uint32_t _min_duration_ms = 0;
+	uint32_t _max_duration_ms = UINT32_MAX;
+	uint8_t _min_time_signature = 0;
+	uint8_t _max_time_signature = UINT8_MAX;
+	int8_t _min_key = INT8_MIN;
+	int8_t _max_key = INT8_MAX;
+	float _min_loudness = -std::numeric_limits<float>::infinity();
+	float _max_loudness = std::numeric_limits<float>::infinity();
+	float _min_tempo = -std::numeric_limits<float>::infinity();
+	float _max_tempo = std::numeric_limits<float>::infinity();
+
+	size_t _limit = 0;
+	bool _has_targets = false;
+};
+
+} // namespace spotify_api
+
+#endif
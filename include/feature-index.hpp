@@ -0,0 +1,145 @@
+#pragma once
+#ifndef _SPOTIFY_API_FEATURE_INDEX_
+#define _SPOTIFY_API_FEATURE_INDEX_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "categories/ids.hpp"
+#include "categories/tracks.hpp"
+#include "analysis-kernels.hpp"
+
+namespace spotify_api
+{
+
+/**
+ * @brief The audio features of many tracks, one normalized row per track.
+ *
+ * Each row holds 11 features scaled to roughly 0.0 - 1.0, so that no feature dominates distances:
+ * acousticness, danceability, energy, instrumentalness, key, liveness, loudness, mode, speechiness, tempo and valence.
+ * Rows are padded to 12 floats so they can be passed straight to the @ref analysis_kernels functions.
+ */
+class feature_matrix_t
+{
+	public:
+	using row_t = analysis_kernels::vector_row_t;
+
+	/// The number of features in a row. The last value of every row is padding and always 0.
+	static constexpr size_t feature_count = 11;
+
+	/// The position of each feature in a row.
+	enum feature_t : size_t
+	{
+		acousticness, danceability, energy, instrumentalness, key, liveness,
+		loudness, mode, speechiness, tempo, valence
+	};
+
+	/// @returns The normalized row for one track's features.
+	static row_t normalize(const audio_features_t &features);
+
+	/// @returns The value of one feature scaled the same way as in @ref normalize.
+	static float normalize(feature_t feature, double value);
+
+	/// @returns The value of one feature scaled like in @ref normalize, but not clamped to 0.0 - 1.0.
+	static float scale(feature_t feature, double value);
+
+	/**
+	 * @brief Adds a track, or replaces its row if it is already in the matrix.
+	 * @returns false if the features do not have a valid track ID
+	 */
+	bool add(const audio_features_t &features);
+
+	/// Adds every non-null entry, for example the result of @ref Track_API::get_audio_features_for_tracks.
+	void add(const std::vector<std::unique_ptr<audio_features_t>> &features);
+
+	/// @returns The row index of a track, if it is in the matrix.
+	std::optional<size_t> find(const spotify_id_t &id) const;
+
+	size_t size() const { return this->_rows.size(); }
+	bool empty() const { return this->_rows.empty(); }
+
+	std::span<const row_t> rows() const { return this->_rows; }
+	const row_t &row(size_t index) const { return this->_rows[index]; }
+	const spotify_id_t &id(size_t index) const { return this->_ids[index]; }
+
+	/// The features that are not part of the rows, one value per row.
+	std::span<const uint32_t> durations_ms() const { return this->_durations_ms; }
+	std::span<const uint8_t> time_signatures() const { return this->_time_signatures; }
+
+	/// The raw values of the features whose normalized values saturate: a key of -1, loudness above 0 dB, tempo above 250 BPM.
+	std::span<const int8_t> keys() const { return this->_keys; }
+	std::span<const float> loudness_db() const { return this->_loudness_db; }
+	std::span<const float> tempos() const { return this->_tempos; }
+
+	private:
+	std::vector<row_t> _rows;
+	std::vector<spotify_id_t> _ids;
+	std::vector<uint32_t> _durations_ms;
+	std::vector<uint8_t> _time_signatures;
+	std::vector<int8_t> _keys;
+	std::vector<float> _loudness_db;
+	std::vector<float> _tempos;
+	std::unordered_map<spotify_id_t, size_t> _positions;
+};
+
+/**
+ * @brief An approximate nearest neighbour index over a @ref feature_matrix_t.
+ *
+ * The index uses an inverted file (IVF): k-means splits the rows into lists around centroids,
+ * and a search only scans the lists whose centroids are closest to the query.
+ * Each list stores a copy of its rows back to back, so every scan reads contiguous memory.
+ *
+ * The index does not reference the matrix after it is built, but results are row indexes into it,
+ * so rebuild the index after changing the matrix.
+ */
+class feature_index_t
+{
+	public:
+	struct neighbor_t
+	{
+		/// The row index in the matrix the index was built from.
+		size_t index;
+		float distance;
+	};
+
+	feature_index_t() = default;
+
+	/**
+	 * @brief Builds the index.
+	 * @param matrix The rows to index
+	 * @param list_count The number of lists, or 0 to use about the square root of the number of rows
+	 * @param iterations The number of k-means iterations
+	 */
+	explicit feature_index_t(const feature_matrix_t &matrix, size_t list_count = 0, unsigned int iterations = 8);
+
+	/**
+	 * @brief Finds the rows closest to a query.
+	 * @param query A normalized row, see @ref feature_matrix_t::normalize
+	 * @param count The number of neighbors to return
+	 * @param probe_count The number of lists to scan. More lists give better results at the cost of speed.
+	 * @param exclude A row index to leave out of the results, such as the query's own row
+	 * @returns Up to `count` neighbors, closest first
+	 */
+	std::vector<neighbor_t> search(const feature_matrix_t::row_t &query, size_t count, size_t probe_count = 4, size_t exclude = SIZE_MAX) const;
+
+	size_t size() const { return this->_indexes.size(); }
+	size_t list_count() const { return this->_centroids.size(); }
+
+	private:
+	std::vector<feature_matrix_t::row_t> _centroids;
+	/// The rows of all lists, grouped by list
+	std::vector<feature_matrix_t::row_t> _rows;
+	/// The matrix row index of each entry in `_rows`
+	std::vector<size_t> _indexes;
+	/// List `i` is `_rows[_offsets[i]]` up to `_rows[_offsets[i + 1]]`
+	std::vector<size_t> _offsets;
+};
+
+} // namespace spotify_api
+
+#endif
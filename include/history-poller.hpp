@@ -0,0 +1,108 @@
+#pragma once
+#ifndef _SPOTIFY_API_HISTORY_POLLER_
+#define _SPOTIFY_API_HISTORY_POLLER_
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "categories/tracks.hpp"
+
+namespace spotify_api
+{
+
+/**
+ * @brief Follows a user's recently played tracks without gaps or overlap, and appends every new play to a log.
+ *
+ * Each poll asks /me/player/recently-played for the plays after the newest one already seen, and keeps paging
+ * forward with the `after` cursor while full pages come back. A user who played fewer than 50 tracks since the
+ * last poll costs exactly one request. Plays are deduplicated on their `played_at` time and track URI, so plays
+ * on the boundary between two polls are only logged once.
+ *
+ * The log is a text file with one json object per play, oldest first. Opening a poller with an existing log
+ * resumes after the newest play in it. Spotify only returns the last 50 plays, so polls have to be frequent
+ * enough that no more than 50 tracks (about 2.5 hours of music) are played in between.
+ *
+ * A poller follows a single user. Use one poller, and one log, per user.
+ */
+class recently_played_poller_t
+{
+	public:
+	struct play_t
+	{
+		/// When the play started, as an ISO 8601 timestamp.
+		std::string played_at;
+		/// @ref played_at as a unix time in milliseconds.
+		int64_t played_at_ms = 0;
+		std::string track_uri;
+		/// The album, artist or playlist the track was played from, or empty.
+		std::string context_uri;
+		/// The decoded track. Null for plays read back from a log.
+		std::shared_ptr<track_t> track;
+	};
+
+	struct result_t
+	{
+		/// The new plays, oldest first.
+		std::vector<play_t> plays;
+		size_t requests = 0;
+		/// Whether every request succeeded. Plays from the pages read before a failure are still returned and logged.
+		bool succeeded = true;
+	};
+
+	/// Creates a poller that keeps its position in memory only.
+	recently_played_poller_t() = default;
+
+	/**
+	 * @brief Creates a poller that appends to a log file, resuming after the newest play already in it.
+	 * @returns The poller, or nullptr if the log can not be opened
+	 */
+	static std::unique_ptr<recently_played_poller_t> open(const std::filesystem::path &log_path);
+
+	~recently_played_poller_t();
+
+	recently_played_poller_t(const recently_played_poller_t &) = delete;
+	recently_played_poller_t &operator=(const recently_played_poller_t &) = delete;
+
+	/**
+	 * @brief Fetches the plays since the last poll.
+	 * @param access_token The access token of the user to follow
+	 */
+	result_t poll(const std::string &access_token);
+
+	/// @returns The unix time in milliseconds of the newest play seen, or 0 before the first one.
+	int64_t cursor() const { return this->_cursor; }
+
+	/// @returns The number of plays logged, including the ones from previous runs.
+	size_t play_count() const { return this->_play_count; }
+
+	/// @returns Every play in a log written by a poller, oldest first. Lines that can not be read are skipped.
+	static std::vector<play_t> read_log(const std::filesystem::path &log_path);
+
+	/// @returns An ISO 8601 timestamp such as "2016-12-13T20:44:04.589Z" as unix milliseconds, if it can be read.
+	static std::optional<int64_t> parse_timestamp(std::string_view timestamp);
+
+	private:
+	// Adds a play to the log and the deduplication set, unless it was seen before
+	bool record(const play_t &play);
+	void forget_before(int64_t time_ms);
+
+	std::FILE *_log = nullptr;
+	int64_t _cursor = 0;
+	size_t _play_count = 0;
+	/// `played_at` and track URI of the recent plays
+	std::unordered_set<std::string> _seen;
+	/// The same plays in the order they were seen, to forget the old ones
+	std::deque<std::pair<int64_t, std::string>> _seen_order;
+};
+
+} // namespace spotify_api
+
+#endif
@@ -0,0 +1,116 @@
+#pragma once
+#ifndef _SPOTIFY_API_LIBRARY_SYNC_
+#define _SPOTIFY_API_LIBRARY_SYNC_
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "categories/ids.hpp"
+#include "categories/tracks.hpp"
+#include "categories/albums.hpp"
+
+namespace spotify_api
+{
+
+/**
+ * @brief Keeps a local mirror of the user's saved tracks (/me/tracks) or saved albums (/me/albums) up to date.
+ *
+ * Spotify lists saved items newest first, so a sync only reads pages until it reaches an item it already knows,
+ * which usually takes a single request. Removals do not show up at the top of the list: they are noticed when
+ * the total reported by Spotify does not match the mirror, and caught up on by a full reconciliation.
+ * A removal and an addition between two syncs cancel out in the total, so a full reconciliation also runs
+ * after @ref reconcile_interval has passed since the last one.
+ *
+ * The sync state (every ID with its `added_at` time, and the time of the last reconciliation) can be saved
+ * to a file and loaded again. The decoded items are not saved: entries loaded from a file have no item until
+ * the next reconciliation, but their IDs can be passed to the multi-get functions of the API classes.
+ *
+ * @tparam T @ref track_t or @ref album_t
+ */
+template <class T>
+class library_sync_t
+{
+	public:
+	struct entry_t
+	{
+		spotify_id_t id;
+		/// When the item was saved, as an ISO 8601 timestamp.
+		std::string added_at;
+		/// The decoded item, or null if it was loaded from a state file.
+		std::shared_ptr<const T> item;
+	};
+
+	struct result_t
+	{
+		/// The items saved since the previous sync, newest first.
+		std::vector<entry_t> added;
+		/// The items that are no longer saved. Only known after a full reconciliation.
+		std::vector<spotify_id_t> removed;
+		/// The number of requests the sync made.
+		size_t requests = 0;
+		/// Whether the whole library was read.
+		bool reconciled = false;
+		/// Whether every request succeeded. A failed sync leaves the mirror unchanged.
+		bool succeeded = true;
+	};
+
+	/// The time after which a sync reads the whole library even if the totals match.
+	std::chrono::seconds reconcile_interval = std::chrono::hours(24);
+
+	/**
+	 * @brief Brings the mirror up to date.
+	 * @param access_token The user's access token
+	 * @param market A country code, or an empty string
+	 * @param force_reconcile Read the whole library, whatever the totals say
+	 */
+	result_t sync(const std::string &access_token, const std::string &market = "", bool force_reconcile = false);
+
+	/// @returns The mirrored items, newest first.
+	const std::vector<entry_t> &entries() const { return this->_entries; }
+
+	size_t size() const { return this->_entries.size(); }
+
+	bool contains(const spotify_id_t &id) const { return this->_positions.contains(id); }
+
+	/**
+	 * @brief Writes the sync state to a file. The file is replaced atomically.
+	 * @returns false if the file could not be written
+	 */
+	bool save(const std::filesystem::path &path) const;
+
+	/**
+	 * @brief Replaces the sync state with one written by @ref save.
+	 * @returns false if the file could not be read, in which case the state is unchanged
+	 */
+	bool load(const std::filesystem::path &path);
+
+	private:
+	struct page_result_t
+	{
+		std::vector<entry_t> entries;
+		int total = 0;
+		bool has_next = false;
+		bool succeeded = false;
+	};
+
+	static page_result_t fetch_page(const std::string &access_token, const std::string &market, size_t offset);
+
+	bool update(const std::string &access_token, const std::string &market, result_t &result);
+	bool reconcile(const std::string &access_token, const std::string &market, result_t &result);
+	void rebuild_positions();
+
+	std::vector<entry_t> _entries;
+	std::unordered_map<spotify_id_t, size_t> _positions;
+	std::chrono::system_clock::time_point _last_reconcile;
+};
+
+} // namespace spotify_api
+
+#endif
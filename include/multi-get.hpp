@@ -0,0 +1,199 @@
+#pragma once
+#ifndef _SPOTIFY_API_MULTI_GET_
+#define _SPOTIFY_API_MULTI_GET_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "categories/ids.hpp"
+
+namespace spotify_api
+{
+
+/// @returns The most batches of a multi-get that are requested at the same time. 4 by default.
+size_t multi_get_parallelism();
+
+/// Sets the most batches of a multi-get that are requested at the same time. 1 requests them one after the other.
+void set_multi_get_parallelism(size_t parallelism);
+
+/**
+ * @brief Holds back requests that are sent together while Spotify is rate limiting them.
+ * When a request is answered with 429, every request waits before going out, for longer after each 429 in a row.
+ */
+class request_backoff_t
+{
+	public:
+	/// Waits until requests may be sent again.
+	void wait() const;
+	/// Records a rate limited or failed request, and pushes the next requests back.
+	void failed();
+	/// Records a successful request, which resets the delay.
+	void succeeded();
+
+	private:
+	std::atomic<int64_t> _resume_at_ns = 0;
+	std::atomic<int> _failures = 0;
+};
+
+/// How many times a batch or a page is requested before giving up on it.
+constexpr int max_request_attempts = 4;
+
+/// @returns Whether a request answered with this status may succeed when sent again: rate limited (429) or a server error (5xx).
+constexpr bool is_retryable_status(int code)
+{
+	return code == 429 || code >= 500;
+}
+
+/// Thrown by the fetch function of @ref fetch_in_batches when its request may succeed when sent again, see @ref is_retryable_status.
+struct batch_retry_t : std::runtime_error
+{
+	int code;
+	explicit batch_retry_t(int code): std::runtime_error("batch request failed with status " + std::to_string(code)), code(code) {}
+};
+
+/**
+ * @brief Splits IDs into batches and requests them, several batches at a time.
+ * @param ids The IDs to get, without duplicates
+ * @param batch_size The most IDs the endpoint takes per request
+ * @param fetch Requests one batch. Returns one item per ID in the batch, in the same order, null for IDs that were
+ * not found. Throws @ref batch_retry_t when Spotify rate limited the request or failed. Called from several threads at once.
+ * @returns One item per ID in `ids`, null for IDs that were not found and for batches that still failed after
+ * @ref max_request_attempts attempts
+ * @throws The first exception thrown by `fetch`, other than @ref batch_retry_t, once the batches in flight returned.
+ * The remaining batches are not requested. Network errors (a `const char *` from http::get) are retried first.
+ */
+template <class T, class Fetch>
+std::vector<std::unique_ptr<T>> fetch_in_batches(std::span<const spotify_id_t> ids, size_t batch_size, Fetch &fetch)
+{
+	std::vector<std::unique_ptr<T>> fetched(ids.size());
+	batch_size = std::max<size_t>(batch_size, 1);
+	size_t batch_count = (ids.size() + batch_size - 1) / batch_size;
+
+	std::atomic<size_t> next_batch = 0;
+	std::exception_ptr error;
+	std::mutex error_mutex;
+	request_backoff_t backoff;
+
+	auto request_batches = [&]()
+	{
+		for (size_t index; (index = next_batch++) < batch_count;)
+		{
+			size_t first = index * batch_size;
+			std::span<const spotify_id_t> batch = ids.subspan(first, std::min(batch_size, ids.size() - first));
+			for (int attempt = 1; attempt <= max_request_attempts; attempt++)
+			{
+				backoff.wait();
+				try
+				{
+					std::vector<std::unique_ptr<T>> items = fetch(batch);
+					backoff.succeeded();
+					for (size_t i = 0; i < batch.size() && i < items.size(); i++) fetched[first + i] = std::move(items[i]);
+					break;
+				}
+				catch (const batch_retry_t &e)
+				{
+					// Every thread waits, so that a rate limit is not made worse by the other batches
+					backoff.failed();
+					if (attempt == max_request_attempts) std::cerr << "Giving up on a batch of " << batch.size() << " IDs: " << e.what() << std::endl;
+				}
+				catch (const char *)
+				{
+					backoff.failed();
+					if (attempt < max_request_attempts) continue;
+					std::lock_guard<std::mutex> lock(error_mutex);
+					if (!error) error = std::current_exception();
+					next_batch = batch_count;
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(error_mutex);
+					if (!error) error = std::current_exception();
+					next_batch = batch_count;
+					break;
+				}
+			}
+		}
+	};
+
+	// The calling thread takes batches too, so a single batch never starts a thread
+	std::vector<std::thread> threads;
+	size_t thread_count = std::min(multi_get_parallelism(), batch_count);
+	for (size_t i = 1; i < thread_count; i++) threads.emplace_back(request_batches);
+	request_batches();
+	for (std::thread &thread : threads) thread.join();
+
+	if (error) std::rethrow_exception(error);
+	return fetched;
+}
+
+/**
+ * @brief Gets any number of items from an endpoint that takes a limited number of IDs per request.
+ * Duplicate IDs are requested once, and the batches are requested several at a time with @ref fetch_in_batches.
+ * @param ids The IDs to get. Duplicates are allowed.
+ * @returns One item per ID in `ids`, in the same order, null for IDs that were not found
+ */
+template <class T, class Fetch>
+std::vector<std::unique_ptr<T>> multi_get(const std::vector<spotify_id_t> &ids, size_t batch_size, Fetch &&fetch)
+{
+	std::vector<spotify_id_t> unique_ids;
+	std::unordered_map<spotify_id_t, size_t> positions;
+	positions.reserve(ids.size());
+	for (const spotify_id_t &id : ids)
+	{
+		if (positions.try_emplace(id, unique_ids.size()).second) unique_ids.push_back(id);
+	}
+
+	std::vector<std::unique_ptr<T>> fetched = fetch_in_batches<T>(std::span<const spotify_id_t>(unique_ids), batch_size, fetch);
+	if (unique_ids.size() == ids.size()) return fetched;
+
+	// The last copy of an ID takes the item, the earlier ones get a copy of it
+	std::vector<std::unique_ptr<T>> output(ids.size());
+	std::vector<size_t> owners(unique_ids.size(), SIZE_MAX);
+	for (size_t i = ids.size(); i-- > 0;)
+	{
+		size_t position = positions[ids[i]];
+		if (owners[position] == SIZE_MAX)
+		{
+			output[i] = std::move(fetched[position]);
+			owners[position] = i;
+		}
+		else if (output[owners[position]]) output[i] = std::make_unique<T>(*output[owners[position]]);
+	}
+	return output;
+}
+
+/**
+ * @brief Lines the items fetched for normalized IDs back up with the inputs they came from.
+ * @param items One item per ID in `ids.ids`
+ * @param ids The IDs, normalized without deduplication
+ * @returns One item per input of @ref normalize_spotify_ids, null for inputs that were not valid IDs
+ */
+template <class T>
+std::vector<std::unique_ptr<T>> align_to_inputs(std::vector<std::unique_ptr<T>> items, const normalized_ids_t &ids)
+{
+	if (ids.invalid_count == 0) return items;
+
+	std::vector<std::unique_ptr<T>> aligned(ids.positions.size());
+	for (size_t i = 0; i < ids.positions.size(); i++)
+	{
+		int64_t position = ids.positions[i];
+		if (position >= 0 && static_cast<size_t>(position) < items.size()) aligned[i] = std::move(items[position]);
+	}
+	return aligned;
+}
+
+} // namespace spotify_api
+
+#endif
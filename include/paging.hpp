@@ -0,0 +1,441 @@
+#pragma once
+#ifndef _SPOTIFY_API_PAGING_
+#define _SPOTIFY_API_PAGING_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "multi-get.hpp"
+
+namespace spotify_api
+{
+
+/// Every item of a paged list, read with @ref fetch_all_pages.
+template <class Item>
+struct all_pages_t
+{
+	/// The items, in the order of the list.
+	std::vector<Item> items;
+	/// The total Spotify reported with the first page.
+	int total = 0;
+	size_t requests = 0;
+	/// Whether every page was read. The items of the pages that could not be read are missing.
+	bool complete = true;
+};
+
+/**
+ * @brief Requests one page of a list, retrying when Spotify rate limits it or fails.
+ * @param page_key The member holding the page in the response, for endpoints that wrap it, such as "albums"
+ * in /browse/new-releases, or null
+ * @returns The page object, or nothing if it could not be read
+ */
+std::optional<nlohmann::json> fetch_page_json(const std::string &url, const std::string &query_data, const std::string &access_token, request_backoff_t &backoff, const char *page_key = nullptr);
+
+/**
+ * @brief Reads the pages of a list from `begin` up to `end`, several pages at a time, and appends their items to `result`.
+ * For lists whose first page came with another object, such as the tracks of a playlist.
+ * @param url The endpoint of the list
+ * @param query_data Extra query parameters, without `limit` and `offset`, or an empty string
+ * @param page_size The largest `limit` the endpoint takes
+ * @param decode_item Turns one json item into an `Item`. It is called from several threads at once.
+ * @throws The first exception thrown by `decode_item`, once every thread stopped
+ */
+template <class Item, class Decode>
+void fetch_pages(const std::string &url, const std::string &query_data, const std::string &access_token, size_t page_size, size_t begin, size_t end, Decode &decode_item, all_pages_t<Item> &result, const char *page_key = nullptr)
+{
+	if (begin >= end) return;
+	page_size = std::max<size_t>(page_size, 1);
+
+	size_t page_count = (end - begin + page_size - 1) / page_size;
+	std::vector<std::vector<Item>> pages(page_count);
+	std::vector<char> failed(page_count, 0);
+	std::atomic<size_t> next_page = 0;
+	std::atomic<size_t> requests = 0;
+	request_backoff_t backoff;
+	std::exception_ptr error;
+	std::mutex error_mutex;
+
+	auto read_pages = [&]()
+	{
+		for (size_t index; (index = next_page++) < page_count;)
+		{
+			try
+			{
+				size_t offset = begin + index * page_size;
+				size_t limit = std::min(page_size, end - offset);
+				std::string page_query = "limit=" + std::to_string(limit) + "&offset=" + std::to_string(offset);
+				if (!query_data.empty()) page_query += "&" + query_data;
+
+				requests++;
+				std::optional<nlohmann::json> page = fetch_page_json(url, page_query, access_token, backoff, page_key);
+				if (!page || !page->contains("items"))
+				{
+					failed[index] = 1;
+					continue;
+				}
+				pages[index].reserve((*page)["items"].size());
+				for (const nlohmann::json &item : (*page)["items"]) pages[index].push_back(decode_item(item));
+			}
+			catch (...)
+			{
+				// Stop handing out pages, and rethrow on the calling thread once every thread returned
+				next_page = page_count;
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!error) error = std::current_exception();
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	size_t thread_count = std::min(multi_get_parallelism(), page_count);
+	for (size_t i = 1; i < thread_count; i++) threads.emplace_back(read_pages);
+	read_pages();
+	for (std::thread &thread : threads) thread.join();
+	if (error) std::rethrow_exception(error);
+
+	result.requests += requests;
+	result.items.reserve(result.items.size() + (end - begin));
+	for (size_t i = 0; i < page_count; i++)
+	{
+		if (failed[i]) result.complete = false;
+		std::move(pages[i].begin(), pages[i].end(), std::back_inserter(result.items));
+	}
+}
+
+/**
+ * @brief Reads every item of a paged list.
+ * The first page tells the total, then the other pages are requested together, several at a time (see
+ * @ref multi_get_parallelism), so reading a list takes about two round trips instead of one per page.
+ * Requests that are rate limited are retried after a delay.
+ * @param url The endpoint of the list
+ * @param query_data Extra query parameters, without `limit` and `offset`, or an empty string
+ * @param page_size The largest `limit` the endpoint takes
+ * @param decode_item Turns one json item into an `Item`
+ * @param max_items Stop after this many items
+ * @param page_key The member holding the page in the response, for endpoints that wrap it, or null
+ */
+template <class Item, class Decode>
+all_pages_t<Item> fetch_all_pages(const std::string &url, const std::string &query_data, const std::string &access_token, size_t page_size, Decode &&decode_item, size_t max_items = SIZE_MAX, const char *page_key = nullptr)
+{
+	all_pages_t<Item> result;
+	page_size = std::max<size_t>(std::min(page_size, max_items), 1);
+
+	std::string first_query = "limit=" + std::to_string(page_size) + "&offset=0";
+	if (!query_data.empty()) first_query += "&" + query_data;
+
+	request_backoff_t backoff;
+	result.requests++;
+	std::optional<nlohmann::json> first_page = fetch_page_json(url, first_query, access_token, backoff, page_key);
+	if (!first_page || !first_page->contains("items"))
+	{
+		result.complete = false;
+		return result;
+	}
+
+	result.total = first_page->value("total", 0);
+	size_t count = std::min(static_cast<size_t>(std::max(result.total, 0)), max_items);
+	for (const nlohmann::json &item : (*first_page)["items"])
+	{
+		if (result.items.size() >= count) break;
+		result.items.push_back(decode_item(item));
+	}
+
+	fetch_pages(url, query_data, access_token, page_size, result.items.size(), count, decode_item, result, page_key);
+	return result;
+}
+
+/**
+ * @brief Goes through a paged list item by item, while the next pages are downloaded in the background.
+ *
+ * Pages are requested one after the other by following their `next` link, up to @ref options_t::prefetch_pages
+ * pages ahead of the item being read, so the items of one page are processed while the next one is on its way,
+ * and only the pages that are read (and the few after them) are requested. Nothing is requested before
+ * @ref begin is called.
+ *
+ * It is an input range: it can be read once, from one thread.
+ * @code
+ * for (auto &track : track_api.iterate_saved_tracks())
+ *     process(*track);
+ * @endcode
+ */
+template <class Item>
+class paged_range_t
+{
+	public:
+	using decode_t = std::function<Item(const nlohmann::json &item)>;
+
+	struct options_t
+	{
+		/// The largest `limit` the endpoint takes
+		size_t page_size = 50;
+		/// The most pages downloaded but not read yet. At least 1.
+		size_t prefetch_pages = 2;
+		/// The member holding the page in the response, for endpoints that wrap it, or null
+		const char *page_key = nullptr;
+	};
+
+	class iterator
+	{
+		public:
+		using value_type = Item;
+		using difference_type = std::ptrdiff_t;
+
+		iterator() = default;
+
+		Item &operator*() const { return this->_range->_page[this->_range->_index]; }
+		Item *operator->() const { return &**this; }
+
+		iterator &operator++()
+		{
+			this->_range->advance();
+			return *this;
+		}
+		void operator++(int) { ++*this; }
+
+		friend bool operator==(const iterator &it, std::default_sentinel_t) { return it.at_end(); }
+
+		private:
+		friend class paged_range_t;
+		explicit iterator(paged_range_t *range): _range(range) {}
+
+		bool at_end() const { return !this->_range || this->_range->at_end(); }
+
+		paged_range_t *_range = nullptr;
+	};
+
+	/**
+	 * @param url The endpoint of the list
+	 * @param query_data Extra query parameters, without `limit` and `offset`, or an empty string
+	 * @param decode_item Turns one json item into an `Item`. It is called on the background thread.
+	 */
+	paged_range_t(const std::string &url, const std::string &query_data, const std::string &access_token, decode_t decode_item, options_t options):
+		_url(url), _query_data(query_data), _access_token(access_token), _decode(std::move(decode_item)), _options(options)
+	{
+		this->_options.page_size = std::max<size_t>(this->_options.page_size, 1);
+		this->_options.prefetch_pages = std::max<size_t>(this->_options.prefetch_pages, 1);
+	}
+
+	paged_range_t(const std::string &url, const std::string &query_data, const std::string &access_token, decode_t decode_item):
+		paged_range_t(url, query_data, access_token, std::move(decode_item), options_t())
+	{
+	}
+
+	/// Stops downloading. Waits for the request in flight, if any.
+	~paged_range_t()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->_mutex);
+			this->_stopping = true;
+		}
+		this->_signal.notify_all();
+		if (this->_thread.joinable()) this->_thread.join();
+	}
+
+	paged_range_t(const paged_range_t &) = delete;
+	paged_range_t &operator=(const paged_range_t &) = delete;
+
+	/**
+	 * @brief Starts the downloads, and waits for the first page.
+	 * @throws The exception thrown by the item decoder, if any, here or when advancing the iterator
+	 */
+	iterator begin()
+	{
+		if (!this->_thread.joinable()) this->_thread = std::thread(&paged_range_t::fetch_loop, this);
+		this->next_page();
+		return iterator(this);
+	}
+
+	std::default_sentinel_t end() const { return std::default_sentinel; }
+
+	/// @returns The total Spotify reported, once the first page was read.
+	int total() const
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		return this->_total;
+	}
+
+	/// @returns The number of pages requested so far, not counting retries.
+	size_t requests() const
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		return this->_requests;
+	}
+
+	/// @returns Whether every page was read. False when the iteration ended early because a page could not be read.
+	bool complete() const
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		return !this->_failed;
+	}
+
+	private:
+	bool at_end() const { return this->_index >= this->_page.size(); }
+
+	void advance()
+	{
+		if (++this->_index >= this->_page.size()) this->next_page();
+	}
+
+	// Swaps in the next page that has items, or leaves the page empty at the end of the list
+	void next_page()
+	{
+		this->_page.clear();
+		this->_index = 0;
+
+		std::unique_lock<std::mutex> lock(this->_mutex);
+		while (this->_page.empty())
+		{
+			this->_signal.wait(lock, [this] { return !this->_pages.empty() || this->_done; });
+			if (this->_pages.empty())
+			{
+				if (this->_error) std::rethrow_exception(std::exchange(this->_error, nullptr));
+				return;
+			}
+			this->_page = std::move(this->_pages.front());
+			this->_pages.pop_front();
+			this->_signal.notify_all();
+		}
+	}
+
+	void fetch_loop()
+	{
+		std::string url = this->_url;
+		std::string query_data = "limit=" + std::to_string(this->_options.page_size) + "&offset=0";
+		if (!this->_query_data.empty()) query_data += "&" + this->_query_data;
+		request_backoff_t backoff;
+		bool first_page = true;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(this->_mutex);
+				this->_signal.wait(lock, [this] { return this->_stopping || this->_pages.size() < this->_options.prefetch_pages; });
+				if (this->_stopping) return;
+				this->_requests++;
+			}
+
+			std::vector<Item> items;
+			std::string next;
+			int total = 0;
+			bool failed = false;
+			std::exception_ptr error;
+			try
+			{
+				std::optional<nlohmann::json> page = fetch_page_json(url, query_data, this->_access_token, backoff, this->_options.page_key);
+				if (page && page->contains("items"))
+				{
+					items.reserve((*page)["items"].size());
+					for (const nlohmann::json &item : (*page)["items"]) items.push_back(this->_decode(item));
+					if (page->contains("next") && (*page)["next"].is_string()) next = (*page)["next"];
+					total = page->value("total", 0);
+				}
+				else failed = true;
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(this->_mutex);
+				if (!items.empty()) this->_pages.push_back(std::move(items));
+				if (first_page) this->_total = total;
+				this->_failed = failed || error;
+				this->_error = error;
+				this->_done = next.empty() || failed || error;
+			}
+			this->_signal.notify_all();
+			if (next.empty() || failed || error) return;
+
+			// The next link carries the limit, offset and the rest of the query
+			url = std::move(next);
+			query_data.clear();
+			first_page = false;
+		}
+	}
+
+	const std::string _url;
+	const std::string _query_data;
+	const std::string _access_token;
+	const decode_t _decode;
+	options_t _options;
+
+	// Only touched by the reading thread
+	std::vector<Item> _page;
+	size_t _index = 0;
+
+	mutable std::mutex _mutex;
+	/// Pages downloaded but not read yet
+	std::deque<std::vector<Item>> _pages;
+	int _total = 0;
+	size_t _requests = 0;
+	bool _failed = false;
+	std::exception_ptr _error;
+	bool _done = false;
+
+	std::condition_variable _signal;
+	bool _stopping = false;
+	std::thread _thread;
+};
+
+/// The outcome of @ref visit_all_pages.
+struct visit_result_t
+{
+	/// The number of items passed to the visitor.
+	size_t visited = 0;
+	/// The total Spotify reported with the first page.
+	int total = 0;
+	size_t requests = 0;
+	/// Whether every page was read. False when a page could not be read, not when the visitor stopped early.
+	bool complete = true;
+	/// Whether the visitor returned false.
+	bool stopped = false;
+};
+
+/**
+ * @brief Passes every item of a paged list to `visit`, one at a time, without keeping them.
+ * Each item is moved into the visitor and released when it returns, unless the visitor keeps it, so no more than
+ * @ref paged_range_t::options_t::prefetch_pages "prefetch_pages" + 1 pages are held at once however long the list is.
+ * Pages are downloaded in the background while the items are visited, as with @ref paged_range_t.
+ * @param decode_item Turns one json item into an `Item`. It is called on a background thread.
+ * @param visit Called on the calling thread for each item, in order. Returns false to stop.
+ * @throws The exception thrown by `decode_item` or `visit`, if any
+ */
+template <class Item>
+visit_result_t visit_all_pages(const std::string &url, const std::string &query_data, const std::string &access_token, typename paged_range_t<Item>::decode_t decode_item, const std::function<bool(Item item)> &visit, typename paged_range_t<Item>::options_t options)
+{
+	visit_result_t result;
+	paged_range_t<Item> range(url, query_data, access_token, std::move(decode_item), options);
+	for (Item &item : range)
+	{
+		result.visited++;
+		if (!visit(std::move(item)))
+		{
+			result.stopped = true;
+			break;
+		}
+	}
+	result.total = range.total();
+	result.requests = range.requests();
+	result.complete = range.complete();
+	return result;
+}
+
+} // namespace spotify_api
+
+#endif
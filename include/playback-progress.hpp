@@ -0,0 +1,74 @@
+#pragma once
+#ifndef _SPOTIFY_API_PLAYBACK_PROGRESS_
+#define _SPOTIFY_API_PLAYBACK_PROGRESS_
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+#include "categories/player.hpp"
+
+namespace spotify_api
+{
+
+/**
+ * @brief Tracks the position in the current track between two playback state requests.
+ *
+ * Each @ref update anchors the model to a position reported by Spotify and the moment it was received, on the
+ * steady clock. The position at any later time is worked out from that anchor, so drawing a progress bar needs
+ * no requests. The `timestamp` of a playback state is not used: it is the server time of the last state change,
+ * not of the response, and the two clocks are not in sync anyway.
+ *
+ * The model also knows when the track will end, which is when a new playback state is worth requesting.
+ */
+class playback_progress_t
+{
+	public:
+	using steady_clock_t = std::chrono::steady_clock;
+
+	/**
+	 * @brief Anchors the model to a position reported by Spotify.
+	 * @param received When the response arrived. Subtract half of the request time for a closer estimate.
+	 */
+	void update(int64_t progress_ms, int64_t duration_ms, bool is_playing, steady_clock_t::time_point received = steady_clock_t::now());
+
+	/// Anchors the model to a playback state. A state without a track clears the model.
+	void update(const playback_state_t &state, steady_clock_t::time_point received = steady_clock_t::now());
+
+	/// Forgets the anchor, for when nothing is playing.
+	void clear() { this->_duration_ms = -1; }
+
+	/// @returns Whether the model has a track to follow.
+	bool has_track() const { return this->_duration_ms >= 0; }
+
+	bool is_playing() const { return this->has_track() && this->_is_playing; }
+
+	int64_t duration_ms() const { return this->_duration_ms; }
+
+	/// @returns The estimated position in the track, which stops at its end. 0 without a track.
+	int64_t position_ms(steady_clock_t::time_point now = steady_clock_t::now()) const;
+
+	/// @returns The estimated position as a fraction of the track, between 0 and 1.
+	double fraction(steady_clock_t::time_point now = steady_clock_t::now()) const;
+
+	/// @returns When the track is expected to end, if it is playing.
+	std::optional<steady_clock_t::time_point> track_end() const;
+
+	/**
+	 * @brief Applies the expected effect of a command right away, before Spotify confirms it.
+	 * The next @ref update replaces the guess.
+	 */
+	void pause(steady_clock_t::time_point now = steady_clock_t::now());
+	void resume(steady_clock_t::time_point now = steady_clock_t::now());
+	void seek(int64_t position_ms, steady_clock_t::time_point now = steady_clock_t::now());
+
+	private:
+	int64_t _progress_ms = 0;
+	int64_t _duration_ms = -1;
+	bool _is_playing = false;
+	steady_clock_t::time_point _anchor;
+};
+
+} // namespace spotify_api
+
+#endif
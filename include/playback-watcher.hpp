@@ -0,0 +1,171 @@
+#pragma once
+#ifndef _SPOTIFY_API_PLAYBACK_WATCHER_
+#define _SPOTIFY_API_PLAYBACK_WATCHER_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "categories/tracks.hpp"
+#include "playback-progress.hpp"
+
+namespace spotify_api
+{
+
+/**
+ * @brief Polls a user's playback state (/me/player) and reports what changed between two polls.
+ *
+ * Only the handful of fields that are compared are read from each response; the track is decoded when it changes.
+ * The interval between polls follows the state:
+ * - while a track plays, at @ref options_t::playing_interval, but right after the track is due to end
+ * - for @ref options_t::command_window after @ref notify_command, at @ref options_t::fast_interval
+ * - while paused, at @ref options_t::paused_interval
+ * - with nothing playing, or after a failed request, at @ref options_t::idle_interval
+ *
+ * The watcher can be driven by calling @ref poll and waiting for @ref next_interval, or run on its own thread with
+ * @ref start. A watcher follows a single user.
+ */
+class playback_watcher_t
+{
+	public:
+	using steady_clock_t = std::chrono::steady_clock;
+
+	struct options_t
+	{
+		/// Only catches changes made elsewhere, such as a pause on another device: the end of the track is predicted.
+		std::chrono::milliseconds playing_interval = std::chrono::seconds(30);
+		std::chrono::milliseconds paused_interval = std::chrono::seconds(30);
+		std::chrono::milliseconds idle_interval = std::chrono::seconds(60);
+		std::chrono::milliseconds fast_interval = std::chrono::seconds(1);
+		/// How long to poll at @ref fast_interval after a command.
+		std::chrono::milliseconds command_window = std::chrono::seconds(5);
+		/// How long after the expected end of a track to poll, so the next track has started.
+		std::chrono::milliseconds track_end_margin = std::chrono::milliseconds(500);
+		/// How far the progress may drift from where it was expected to be before it counts as a seek.
+		std::chrono::milliseconds seek_tolerance = std::chrono::seconds(2);
+	};
+
+	/// The compared fields of a playback state.
+	struct snapshot_t
+	{
+		/// Whether anything is playing or paused. The other fields are empty when false.
+		bool active = false;
+		bool is_playing = false;
+		std::string track_uri;
+		int64_t duration_ms = 0;
+		int64_t progress_ms = 0;
+		std::string context_uri;
+		std::string device_id;
+		int volume_percent = -1;
+		bool shuffle_state = false;
+		std::string repeat_state;
+		/// When the state was received.
+		steady_clock_t::time_point received;
+
+		/// Reads a /me/player response. A null object (nothing playing) gives an inactive snapshot.
+		static snapshot_t from_json(const nlohmann::json &json_obj, steady_clock_t::time_point received);
+	};
+
+	enum class event_type_t
+	{
+		/// Something started playing on a device after nothing was.
+		STARTED,
+		/// Playback ended, or no device is active anymore.
+		STOPPED,
+		TRACK_CHANGED,
+		PAUSED,
+		RESUMED,
+		SEEKED,
+		CONTEXT_CHANGED,
+		DEVICE_CHANGED,
+		VOLUME_CHANGED,
+		SHUFFLE_CHANGED,
+		REPEAT_CHANGED,
+	};
+
+	struct event_t
+	{
+		event_type_t type;
+		snapshot_t previous;
+		snapshot_t current;
+		/// The new track, for @ref event_type_t::STARTED and @ref event_type_t::TRACK_CHANGED. Null otherwise, and for episodes.
+		std::shared_ptr<track_t> track;
+	};
+
+	struct result_t
+	{
+		std::vector<event_t> events;
+		/// Whether the request succeeded. The last known state is kept when it did not.
+		bool succeeded = true;
+	};
+
+	options_t options;
+
+	playback_watcher_t() = default;
+	explicit playback_watcher_t(options_t options): options(options) {}
+	~playback_watcher_t();
+
+	playback_watcher_t(const playback_watcher_t &) = delete;
+	playback_watcher_t &operator=(const playback_watcher_t &) = delete;
+
+	/// Fetches the playback state and compares it to the previous one.
+	result_t poll(const std::string &access_token);
+
+	/// @ref poll with the time the response is considered received, for callers that keep their own clock.
+	result_t poll(const std::string &access_token, steady_clock_t::time_point now);
+
+	/// @returns How long to wait before the next @ref poll.
+	std::chrono::milliseconds next_interval() const;
+
+	/// @returns The state seen by the last successful poll.
+	snapshot_t last_state() const;
+
+	/// @returns The position in the current track, extrapolated from the last successful poll.
+	playback_progress_t progress() const;
+
+	/**
+	 * @brief Signals that a command (play, pause, skip, seek...) was sent for this user.
+	 * The next polls are made at the fast interval to pick up its effect, and a running watcher polls right away.
+	 */
+	void notify_command();
+
+	/**
+	 * @brief Polls on a background thread and passes every event to `on_event`, on that thread.
+	 * @returns false if the watcher is already running
+	 */
+	bool start(const std::string &access_token, std::function<void(const event_t &)> on_event);
+
+	/// Stops the background thread, waiting for the request in flight if any.
+	void stop();
+
+	/// Replaces the access token used by the background thread, once the old one expires.
+	void set_access_token(const std::string &access_token);
+
+	private:
+	void compare(const snapshot_t &previous, const snapshot_t &current, const nlohmann::json &json_obj, std::vector<event_t> &events) const;
+	void run_loop(std::function<void(const event_t &)> on_event);
+
+	mutable std::mutex _mutex;
+	snapshot_t _state;
+	playback_progress_t _progress;
+	bool _failed = false;
+	steady_clock_t::time_point _fast_until;
+
+	std::string _access_token;
+	std::condition_variable _wake;
+	bool _woken = false;
+	bool _stopping = false;
+	std::thread _thread;
+};
+
+} // namespace spotify_api
+
+#endif
@@ -0,0 +1,206 @@
+#pragma once
+#ifndef _SPOTIFY_API_PLAYER_COMMANDS_
+#define _SPOTIFY_API_PLAYER_COMMANDS_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "categories/player.hpp"
+#include "endpoints/player.hpp"
+
+namespace spotify_api
+{
+
+/**
+ * @brief Sends volume, seek, shuffle and repeat commands in the background, dropping the ones that are superseded.
+ *
+ * Interactive controls such as volume sliders and seek bars produce far more values than Spotify can take. Each
+ * call here returns right away. Commands are kept per type and device, and only the last one submitted is
+ * sent: while a command is in flight, newer ones for the same type and device replace each other, and only the
+ * latest is sent once the request returns. There is never more than one request in flight per type and device,
+ * and no more than one every @ref options_t::min_interval.
+ *
+ * A command that fails is sent once more after @ref options_t::retry_delay, unless a newer one replaced it.
+ * All functions are thread safe.
+ */
+class player_command_coalescer_t
+{
+	public:
+	enum class command_type_t
+	{
+		VOLUME,
+		SEEK,
+		SHUFFLE,
+		REPEAT,
+	};
+
+	struct options_t
+	{
+		/// The number of threads sending commands, which is also the most requests in flight at once.
+		size_t threads = 2;
+		/// The shortest time between two requests for the same type and device.
+		std::chrono::milliseconds min_interval = std::chrono::milliseconds(250);
+		std::chrono::milliseconds retry_delay = std::chrono::seconds(1);
+		/// Called on a sending thread after each request, for example to call @ref playback_watcher_t::notify_command.
+		std::function<void(command_type_t type, const std::string &device_id, bool succeeded)> on_sent;
+	};
+
+	struct stats_t
+	{
+		size_t submitted = 0;
+		size_t sent = 0;
+		/// Commands replaced by a newer one before they were sent.
+		size_t coalesced = 0;
+		/// Requests that failed, including the retries.
+		size_t failed = 0;
+	};
+
+	explicit player_command_coalescer_t(const std::string &access_token);
+	player_command_coalescer_t(const std::string &access_token, options_t options);
+
+	/// Waits for the requests in flight. Commands that were not sent yet are dropped; call @ref flush first to send them.
+	~player_command_coalescer_t();
+
+	player_command_coalescer_t(const player_command_coalescer_t &) = delete;
+	player_command_coalescer_t &operator=(const player_command_coalescer_t &) = delete;
+
+	/// @param device_id The device to target, or an empty string for the active device
+	void set_volume(int volume_percent, const std::string &device_id = "");
+	void seek_to_position(int position_ms, const std::string &device_id = "");
+	void set_shuffle(bool state, const std::string &device_id = "");
+	void set_repeat_mode(Player_API::REPEAT_MODE state, const std::string &device_id = "");
+
+	void set_access_token(const std::string &access_token);
+
+	/// Blocks until every submitted command was sent, or given up on.
+	void flush();
+
+	stats_t stats() const;
+
+	private:
+	using key_t = std::pair<command_type_t, std::string>;
+
+	struct slot_t
+	{
+		/// The value to send next
+		std::optional<int> pending;
+		/// Whether the value that failed last is being retried
+		bool retrying = false;
+		bool scheduled = false;
+		bool in_flight = false;
+		std::chrono::steady_clock::time_point last_sent;
+	};
+
+	void submit(command_type_t type, const std::string &device_id, int value);
+	// Must be called with `_mutex` held
+	void schedule(const key_t &key, slot_t &slot, std::chrono::steady_clock::time_point not_before);
+	void send_loop();
+	bool send(command_type_t type, const std::string &device_id, int value, const std::string &access_token) const;
+
+	options_t _options;
+	mutable std::mutex _mutex;
+	std::string _access_token;
+	std::map<key_t, slot_t> _slots;
+	/// The slots with a pending value, by the earliest time it may be sent
+	std::multimap<std::chrono::steady_clock::time_point, key_t> _schedule;
+	size_t _in_flight = 0;
+	stats_t _stats;
+
+	std::condition_variable _schedule_signal;
+	std::condition_variable _idle_signal;
+	bool _stopping = false;
+	std::vector<std::thread> _threads;
+};
+
+/**
+ * @brief Sends playback commands (play, pause, skip, queue) in the background, in the order they were issued.
+ *
+ * Each call returns right away with a future for the result, and optionally takes a callback run when the
+ * command completes. Commands for the same device are sent one after the other, in the order they were issued,
+ * each one only once the previous one returned, so Spotify sees them in that order. Commands for different
+ * devices are sent in parallel. Commands without a device go to the active device, and are ordered among
+ * themselves.
+ *
+ * Unlike the commands of a @ref player_command_coalescer_t, these do not replace each other, and failed ones
+ * are not sent again: skipping twice is not the same as skipping once.
+ * All functions are thread safe.
+ */
+class player_command_queue_t
+{
+	public:
+	/// Called with whether Spotify accepted the command, on the thread that sent it.
+	using callback_t = std::function<void(bool succeeded)>;
+
+	/// @param threads The number of devices that can be sent commands at the same time
+	explicit player_command_queue_t(const std::string &access_token, size_t threads = 2);
+
+	/// Sends the commands still queued, then stops.
+	~player_command_queue_t();
+
+	player_command_queue_t(const player_command_queue_t &) = delete;
+	player_command_queue_t &operator=(const player_command_queue_t &) = delete;
+
+	/// @see Player_API::start_or_resume_playback
+	std::future<bool> start_or_resume_playback(const std::string &context_uri, const std::vector<std::string> &uris, int offset, int position_ms, const std::string &device_id = "", callback_t on_done = nullptr);
+	std::future<bool> pause_playback(const std::string &device_id = "", callback_t on_done = nullptr);
+	std::future<bool> skip_to_next(const std::string &device_id = "", callback_t on_done = nullptr);
+	std::future<bool> skip_to_previous(const std::string &device_id = "", callback_t on_done = nullptr);
+	std::future<bool> add_item_to_playback_queue(const std::string &item_uri, const std::string &device_id = "", callback_t on_done = nullptr);
+
+	/**
+	 * @brief Queues any other command for a device.
+	 * @param command Sends the command with the given API object, which has the current access token, and returns whether it succeeded
+	 */
+	std::future<bool> enqueue(const std::string &device_id, std::function<bool(Player_API &)> command, callback_t on_done = nullptr);
+
+	void set_access_token(const std::string &access_token);
+
+	/// @returns The number of commands not completed yet, including the ones in flight.
+	size_t pending() const;
+
+	/// Blocks until every command issued so far completed.
+	void flush();
+
+	private:
+	struct command_t
+	{
+		std::function<bool(Player_API &)> send;
+		std::promise<bool> result;
+		callback_t on_done;
+	};
+
+	struct device_queue_t
+	{
+		std::deque<command_t> commands;
+		/// Whether the device is waiting for a thread or being sent a command
+		bool scheduled = false;
+	};
+
+	void send_loop();
+
+	mutable std::mutex _mutex;
+	std::string _access_token;
+	std::map<std::string, device_queue_t> _devices;
+	/// The devices with commands to send and no command in flight, in the order they became ready
+	std::deque<std::string> _ready;
+	size_t _pending = 0;
+
+	std::condition_variable _ready_signal;
+	std::condition_variable _idle_signal;
+	bool _stopping = false;
+	std::vector<std::thread> _threads;
+};
+
+} // namespace spotify_api
+
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef _SPOTIFY_API_PLAYLIST_CACHE_
+#define _SPOTIFY_API_PLAYLIST_CACHE_
+
+#include <cstddef>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "categories/playlist.hpp"
+
+namespace spotify_api
+{
+
+/**
+ * @brief Decoded playlists with their complete track lists, keyed by playlist ID and market.
+ *
+ * A playlist's `snapshot_id` changes whenever its tracks or details change, so a stored playlist
+ * stays valid for as long as Spotify reports the same snapshot. @ref Playlist_API uses that to refresh
+ * a stored playlist with a request for just its snapshot ID, and only downloads the tracks again
+ * when the snapshot changed.
+ *
+ * The tracks of a playlist are relinked for the market it was requested with, so the same playlist
+ * is stored once per market. The market is a country code, "from_token", or an empty string.
+ *
+ * Stored playlists are immutable and shared. They are deep copies of the inserted playlists, so their
+ * tracks are not shared with any playlist handed out; use @ref copy to get a playlist that can be modified.
+ * All functions are thread safe.
+ */
+class playlist_cache_t
+{
+	public:
+	playlist_cache_t() = default;
+	playlist_cache_t(const playlist_cache_t &) = delete;
+	playlist_cache_t &operator=(const playlist_cache_t &) = delete;
+
+	/// @returns The playlist stored for the market, or null if there is none.
+	std::shared_ptr<const playlist_t> find(const std::string &playlist_id, const std::string &market) const;
+
+	/// Stores a copy of a playlist for the market, replacing the one with the same ID and market.
+	void insert(const playlist_t &playlist, const std::string &market);
+
+	/// Removes the playlist for every market.
+	void erase(const std::string &playlist_id);
+	void clear();
+
+	/// @returns Every playlist stored for the market.
+	std::vector<std::shared_ptr<const playlist_t>> playlists(const std::string &market) const;
+
+	/// @returns The number of stored playlists, counting each market separately.
+	size_t size() const;
+
+	/**
+	 * @brief Copies a playlist along with its tracks, and their albums and artists,
+	 * so that modifying the copy leaves the original untouched.
+	 */
+	static std::unique_ptr<playlist_t> copy(const playlist_t &playlist);
+
+	private:
+	mutable std::shared_mutex _mutex;
+	// Playlist ID -> market -> playlist
+	std::unordered_map<std::string, std::unordered_map<std::string, std::shared_ptr<const playlist_t>>> _playlists;
+};
+
+} // namespace spotify_api
+
+#endif
@@ -0,0 +1,171 @@
+#pragma once
+#ifndef _SPOTIFY_API_RESPONSE_CACHE_
+#define _SPOTIFY_API_RESPONSE_CACHE_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace http
+{
+
+/**
+ * @brief A persistent cache of GET response bodies, kept in a directory on disk.
+ *
+ * Entries are appended to log segments (`segment-<n>.log`), compressed with zlib and checksummed.
+ * A crash can only lose the record that was being written: when the cache is opened, every
+ * segment is replayed up to its first incomplete or corrupt record and the rest is cut off.
+ *
+ * Removing an entry, or evicting it because the cache grew past its size limit, appends a small
+ * tombstone record; expired entries need none. The space of removed entries is reclaimed by a background
+ * thread, which rewrites the live entries of the oldest segments into the newest one and deletes the old files.
+ *
+ * Only endpoints with a time to live are cached, see @ref options_t::ttls.
+ * All functions are thread safe.
+ */
+class response_cache_t
+{
+	public:
+	struct options_t
+	{
+		/// The directory the segments are stored in. It is created if it does not exist.
+		std::filesystem::path directory;
+
+		/// The combined size of the stored entries above which the least recently used ones are removed.
+		uint64_t max_bytes = 256ull << 20;
+
+		/// The size at which a new segment is started.
+		uint64_t segment_bytes = 16ull << 20;
+
+		/// The share of the stored bytes that may belong to removed entries before segments are compacted.
+		double compaction_ratio = 0.5;
+
+		/**
+		 * @brief The time to live of each endpoint, by path prefix below `/v1`.
+		 * A prefix matches whole path segments, so "/tracks" matches "/tracks/{id}" but not "/me/tracks".
+		 * The longest matching prefix wins. Requests to any other path are not cached.
+		 */
+		std::vector<std::pair<std::string, std::chrono::seconds>> ttls = {
+			{"/tracks", std::chrono::hours(24 * 7)},
+			{"/albums", std::chrono::hours(24 * 7)},
+			{"/artists", std::chrono::hours(24)},
+			{"/audio-features", std::chrono::hours(24 * 30)},
+			{"/audio-analysis", std::chrono::hours(24 * 30)},
+		};
+	};
+
+	/**
+	 * @brief Opens a cache directory, recovering the entries stored by a previous run.
+	 * @returns The cache, or nullptr if the directory can not be created or read
+	 */
+	static std::unique_ptr<response_cache_t> open(const options_t &options);
+
+	~response_cache_t();
+
+	response_cache_t(const response_cache_t &) = delete;
+	response_cache_t &operator=(const response_cache_t &) = delete;
+
+	/**
+	 * @brief Builds the cache key of a request: its path, followed by its query parameters in sorted order.
+	 * The scheme, the host and the order of the parameters do not change the key.
+	 */
+	static std::string normalize_key(const std::string &url, const std::string &query_data);
+
+	/// @returns The time to live of a request URL, or 0 if it should not be cached.
+	std::chrono::seconds ttl_for(const std::string &url) const;
+
+	/**
+	 * @brief Tells whether a response depends on the user the request was made for, so it must not be cached.
+	 * Keys do not identify the user, so requests with a `market` that is not a country code, such as `from_token`,
+	 * are never stored: their relinking and playability are those of the user's own country.
+	 */
+	static bool is_user_specific(const std::string &url, const std::string &query_data);
+
+	/// @returns The stored body for a key, if there is one that has not expired.
+	std::optional<std::string> get(const std::string &key);
+
+	/// Stores a body, replacing any previous body with the same key.
+	void put(const std::string &key, const std::string &body, std::chrono::seconds ttl);
+
+	/// Removes a stored body.
+	void erase(const std::string &key);
+
+	/// Rewrites the live entries of every full segment now, instead of waiting for the background thread.
+	void compact();
+
+	/// @returns The number of stored entries.
+	size_t size() const;
+
+	/// @returns The compressed size of the stored entries, in bytes.
+	uint64_t live_bytes() const;
+
+	/// @returns The size of all segment files, in bytes.
+	uint64_t disk_bytes() const;
+
+	private:
+	struct segment_t
+	{
+		std::FILE *file = nullptr;
+		uint64_t size = 0;
+		uint64_t live_bytes = 0;
+	};
+
+	struct entry_t
+	{
+		uint32_t segment;
+		uint64_t offset;
+		uint32_t record_size;
+		int64_t expires_at;
+		std::list<std::string>::iterator position;
+	};
+
+	explicit response_cache_t(const options_t &options);
+
+	bool load();
+	bool load_segment(uint32_t id);
+	bool open_active_segment(uint32_t id);
+	std::filesystem::path segment_path(uint32_t id) const;
+
+	// The functions below must be called with `_mutex` held
+	bool append(const std::string &record);
+	void remove(std::unordered_map<std::string, entry_t>::iterator entry, bool write_tombstone);
+	void evict();
+	bool needs_compaction() const;
+	// Releases the lock while it reads the segment and between chunks of records
+	bool compact_oldest(std::unique_lock<std::mutex> &lock);
+
+	void compaction_loop();
+
+	options_t _options;
+
+	mutable std::mutex _mutex;
+	/// Held for a whole compaction, which releases `_mutex` at times. Taken before `_mutex`.
+	std::mutex _compaction_mutex;
+	std::map<uint32_t, segment_t> _segments;
+	uint32_t _active = 0;
+	std::unordered_map<std::string, entry_t> _entries;
+	/// Keys from most to least recently used
+	std::list<std::string> _recency;
+	uint64_t _live_bytes = 0;
+	uint64_t _disk_bytes = 0;
+
+	std::condition_variable _compaction_signal;
+	bool _stopping = false;
+	std::thread _compaction_thread;
+};
+
+} // namespace http
+
+#endif
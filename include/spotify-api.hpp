@@ -16,9 +16,29 @@
 #include <condition_variable>
 
 
+#include "string-pool.hpp"
+#include "entity-store.hpp"
+#include "entity-cache.hpp"
+#include "playlist-cache.hpp"
+#include "library-sync.hpp"
+#include "history-poller.hpp"
+#include "playback-progress.hpp"
+#include "playback-watcher.hpp"
+#include "player-commands.hpp"
+#include "batch-loader.hpp"
+#include "multi-get.hpp"
+#include "paging.hpp"
+#include "analysis-kernels.hpp"
+#include "feature-index.hpp"
+#include "feature-filter.hpp"
+#include "binary-library.hpp"
+#include "response-cache.hpp"
 #include "categories/common.hpp"
+#include "categories/ids.hpp"
+#include "categories/markets.hpp"
 #include "categories/session.hpp"
 #include "categories/tracks.hpp"
+#include "categories/analysis.hpp"
 #include "categories/artists.hpp"
 #include "categories/albums.hpp"
 #include "categories/episodes.hpp"
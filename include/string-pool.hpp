@@ -0,0 +1,131 @@
+#pragma once
+#ifndef _SPOTIFY_API_STRING_POOL_
+#define _SPOTIFY_API_STRING_POOL_
+
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+#include <nlohmann/json.hpp>
+
+namespace spotify_api
+{
+
+class string_pool_t;
+
+/**
+ * @brief A handle to a string stored in a @ref string_pool_t.
+ * 
+ * Every occurrence of the same text shares one pooled copy, so a handle is just a pointer.
+ * Two handles from the same pool are equal exactly when they point at the same string,
+ * which makes equality checks a pointer comparison.
+ * A default constructed handle refers to an empty string.
+ */
+class interned_string_t
+{
+	public:
+	interned_string_t();
+
+	const std::string &str() const { return *this->_value; }
+	std::string_view view() const { return *this->_value; }
+	const char *c_str() const { return this->_value->c_str(); }
+	size_t size() const { return this->_value->size(); }
+	bool empty() const { return this->_value->empty(); }
+
+	operator const std::string &() const { return *this->_value; }
+	operator std::string_view() const { return *this->_value; }
+
+	/// Compares the addresses of the pooled strings. Only valid for handles from the same pool.
+	friend bool operator==(const interned_string_t &lhs, const interned_string_t &rhs) { return lhs._value == rhs._value; }
+
+	friend bool operator==(const interned_string_t &lhs, std::string_view rhs) { return lhs.view() == rhs; }
+
+	/// Orders handles by their text, so they sort the same way the strings would.
+	friend std::strong_ordering operator<=>(const interned_string_t &lhs, const interned_string_t &rhs)
+	{
+		if (lhs._value == rhs._value) return std::strong_ordering::equal;
+		return lhs.view() <=> rhs.view();
+	}
+
+	friend std::ostream &operator<<(std::ostream &stream, const interned_string_t &value) { return stream << value.view(); }
+
+	/**
+	 * @brief Interns a json string in the global pool.
+	 * @param json_value The json value to intern. A null value results in an empty string.
+	 */
+	static interned_string_t from_json(const nlohmann::json &json_value);
+
+	private:
+	friend class string_pool_t;
+	friend struct std::hash<interned_string_t>;
+
+	explicit interned_string_t(const std::string *value): _value(value) {}
+
+	const std::string *_value;
+};
+
+/**
+ * @brief A thread-safe set of unique strings that hands out @ref interned_string_t "interned handles".
+ * 
+ * The pool is split into shards, each guarded by its own reader/writer lock, so concurrent
+ * lookups of strings that are already pooled only take shared locks.
+ * Strings are never removed; memory use grows with the number of unique strings.
+ */
+class string_pool_t
+{
+	public:
+	string_pool_t() = default;
+	string_pool_t(const string_pool_t &) = delete;
+	string_pool_t &operator=(const string_pool_t &) = delete;
+
+	/// @returns The pool used by all of the `from_json` functions.
+	static string_pool_t &global();
+
+	/// @returns A handle to the pooled copy of `value`, adding it to the pool if needed.
+	interned_string_t intern(std::string_view value);
+
+	/// @returns The number of unique strings in the pool.
+	size_t size() const;
+
+	private:
+	struct transparent_hash
+	{
+		using is_transparent = void;
+		size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+	};
+
+	struct shard_t
+	{
+		mutable std::shared_mutex mutex;
+		std::unordered_set<std::string, transparent_hash, std::equal_to<>> strings;
+	};
+
+	static constexpr size_t shard_count = 16;
+
+	std::array<shard_t, shard_count> _shards;
+};
+
+/// Interns a string in the global pool.
+inline interned_string_t intern(std::string_view value)
+{
+	return string_pool_t::global().intern(value);
+}
+
+} // namespace spotify_api
+
+template <>
+struct std::hash<spotify_api::interned_string_t>
+{
+	size_t operator()(const spotify_api::interned_string_t &value) const noexcept
+	{
+		return std::hash<const std::string *>{}(value._value);
+	}
+};
+
+#endif
@@ -0,0 +1,546 @@
+#include "analysis-kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+	#include <immintrin.h>
+	#define SPOTIFY_API_KERNELS_AVX2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	#include <arm_neon.h>
+	#define SPOTIFY_API_KERNELS_NEON
+#endif
+
+namespace spotify_api
+{
+
+namespace analysis_kernels
+{
+
+// The segment columns the loudness curve reads, as raw pointers so every kernel variant can use them
+struct loudness_columns_t
+{
+	const float *start;
+	const float *duration;
+	const float *loudness_start;
+	const float *loudness_max;
+	const float *loudness_max_time;
+	const float *loudness_end;
+	uint32_t count;
+};
+
+struct bounds_t
+{
+	const float *lower;
+	const float *upper;
+	const float *target;
+	const float *weights;
+};
+
+struct kernel_table_t
+{
+	std::string_view name;
+	float (*sum)(const float *values, size_t count);
+	void (*sum_rows)(const vector_row_t *rows, size_t count, float *output);
+	void (*loudness)(const loudness_columns_t &segments, const uint32_t *indexes, float start_time, float step, size_t count, float *output);
+	void (*distances)(const float *query, const vector_row_t *rows, size_t count, float *output);
+	void (*bounded_distances)(const bounds_t &bounds, const vector_row_t *rows, size_t count, float *output);
+};
+
+
+// Scalar versions, also used for the tails the vector versions leave over
+
+static float sum_scalar(const float *values, size_t count)
+{
+	float sum = 0.0f;
+	for (size_t i = 0; i < count; i++) sum += values[i];
+	return sum;
+}
+
+static void sum_rows_scalar(const vector_row_t *rows, size_t count, float *output)
+{
+	std::fill_n(output, columnar_analysis_t::vector_size, 0.0f);
+	for (size_t i = 0; i < count; i++)
+	{
+		for (size_t j = 0; j < columnar_analysis_t::vector_size; j++) output[j] += rows[i][j];
+	}
+}
+
+static float loudness_at(const loudness_columns_t &segments, uint32_t segment, float time)
+{
+	float duration = segments.duration[segment];
+	float rise_end = segments.loudness_max_time[segment];
+	float start = segments.loudness_start[segment];
+	float peak = segments.loudness_max[segment];
+	float next = segment + 1 < segments.count ? segments.loudness_start[segment + 1] : segments.loudness_end[segment];
+	float local = std::min(std::max(time - segments.start[segment], 0.0f), duration);
+
+	if (local < rise_end) return start + (peak - start) * (local / rise_end);
+
+	float fall = duration - rise_end;
+	if (fall <= 0.0f) return peak;
+	return peak + (next - peak) * ((local - rise_end) / fall);
+}
+
+static void loudness_scalar(const loudness_columns_t &segments, const uint32_t *indexes, float start_time, float step, size_t count, float *output)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		output[i] = loudness_at(segments, indexes[i], start_time + step * static_cast<float>(i));
+	}
+}
+
+static float distance_scalar(const float *query, const float *row)
+{
+	float sum = 0.0f;
+	for (size_t j = 0; j < columnar_analysis_t::vector_size; j++)
+	{
+		float difference = row[j] - query[j];
+		sum += difference * difference;
+	}
+	return std::sqrt(sum);
+}
+
+static void distances_scalar(const float *query, const vector_row_t *rows, size_t count, float *output)
+{
+	for (size_t i = 0; i < count; i++) output[i] = distance_scalar(query, rows[i].data());
+}
+
+static float bounded_distance_scalar(const bounds_t &bounds, const float *row)
+{
+	bool inside = true;
+	float sum = 0.0f;
+	for (size_t j = 0; j < columnar_analysis_t::vector_size; j++)
+	{
+		// & instead of && so there is no branch per dimension
+		inside &= (row[j] >= bounds.lower[j]) & (row[j] <= bounds.upper[j]);
+		float difference = row[j] - bounds.target[j];
+		sum += bounds.weights[j] * difference * difference;
+	}
+	return inside ? std::sqrt(sum) : std::numeric_limits<float>::infinity();
+}
+
+static void bounded_distances_scalar(const bounds_t &bounds, const vector_row_t *rows, size_t count, float *output)
+{
+	for (size_t i = 0; i < count; i++) output[i] = bounded_distance_scalar(bounds, rows[i].data());
+}
+
+
+#if defined(SPOTIFY_API_KERNELS_AVX2)
+
+// These are compiled for AVX2 regardless of the flags the library is built with,
+// and only called after checking that the CPU supports it.
+
+__attribute__((target("avx2")))
+static float horizontal_sum(__m256 value)
+{
+	__m128 sum = _mm_add_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1));
+	sum = _mm_hadd_ps(sum, sum);
+	sum = _mm_hadd_ps(sum, sum);
+	return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2")))
+static float sum_avx2(const float *values, size_t count)
+{
+	__m256 first = _mm256_setzero_ps();
+	__m256 second = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		first = _mm256_add_ps(first, _mm256_loadu_ps(values + i));
+		second = _mm256_add_ps(second, _mm256_loadu_ps(values + i + 8));
+	}
+	if (i + 8 <= count)
+	{
+		first = _mm256_add_ps(first, _mm256_loadu_ps(values + i));
+		i += 8;
+	}
+	return horizontal_sum(_mm256_add_ps(first, second)) + sum_scalar(values + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void sum_rows_avx2(const vector_row_t *rows, size_t count, float *output)
+{
+	// A row is 12 floats: one 8 lane and one 4 lane register
+	__m256 low = _mm256_setzero_ps();
+	__m128 high = _mm_setzero_ps();
+	for (size_t i = 0; i < count; i++)
+	{
+		low = _mm256_add_ps(low, _mm256_loadu_ps(rows[i].data()));
+		high = _mm_add_ps(high, _mm_loadu_ps(rows[i].data() + 8));
+	}
+	_mm256_storeu_ps(output, low);
+	_mm_storeu_ps(output + 8, high);
+}
+
+__attribute__((target("avx2")))
+static void loudness_avx2(const loudness_columns_t &segments, const uint32_t *indexes, float start_time, float step, size_t count, float *output)
+{
+	const __m256 lane_offsets = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 tiny = _mm256_set1_ps(1e-9f);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i last = _mm256_set1_epi32(static_cast<int>(segments.count - 1));
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i segment = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(indexes + i));
+		__m256i next_segment = _mm256_min_epu32(_mm256_add_epi32(segment, one), last);
+
+		__m256 time = _mm256_add_ps(_mm256_set1_ps(start_time), _mm256_mul_ps(_mm256_set1_ps(step), _mm256_add_ps(_mm256_set1_ps(static_cast<float>(i)), lane_offsets)));
+		__m256 start_of_segment = _mm256_i32gather_ps(segments.start, segment, 4);
+		__m256 duration = _mm256_i32gather_ps(segments.duration, segment, 4);
+		__m256 rise_end = _mm256_i32gather_ps(segments.loudness_max_time, segment, 4);
+		__m256 start = _mm256_i32gather_ps(segments.loudness_start, segment, 4);
+		__m256 peak = _mm256_i32gather_ps(segments.loudness_max, segment, 4);
+		__m256 next = _mm256_blendv_ps(
+			_mm256_i32gather_ps(segments.loudness_start, next_segment, 4),
+			_mm256_i32gather_ps(segments.loudness_end, segment, 4),
+			_mm256_castsi256_ps(_mm256_cmpeq_epi32(segment, last)));
+
+		__m256 local = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(time, start_of_segment), zero), duration);
+		__m256 fall = _mm256_sub_ps(duration, rise_end);
+
+		__m256 rising = _mm256_add_ps(start, _mm256_mul_ps(_mm256_sub_ps(peak, start), _mm256_div_ps(local, _mm256_max_ps(rise_end, tiny))));
+		__m256 falling = _mm256_add_ps(peak, _mm256_mul_ps(_mm256_sub_ps(next, peak), _mm256_div_ps(_mm256_sub_ps(local, rise_end), _mm256_max_ps(fall, tiny))));
+		falling = _mm256_blendv_ps(peak, falling, _mm256_cmp_ps(fall, zero, _CMP_GT_OQ));
+
+		_mm256_storeu_ps(output + i, _mm256_blendv_ps(falling, rising, _mm256_cmp_ps(local, rise_end, _CMP_LT_OQ)));
+	}
+	for (; i < count; i++)
+	{
+		output[i] = loudness_at(segments, indexes[i], start_time + step * static_cast<float>(i));
+	}
+}
+
+__attribute__((target("avx2")))
+static __m128 squared_distance_parts(__m256 query_low, __m128 query_high, const float *row)
+{
+	__m256 low = _mm256_sub_ps(_mm256_loadu_ps(row), query_low);
+	__m128 high = _mm_sub_ps(_mm_loadu_ps(row + 8), query_high);
+	low = _mm256_mul_ps(low, low);
+	high = _mm_mul_ps(high, high);
+	return _mm_add_ps(_mm_add_ps(_mm256_castps256_ps128(low), _mm256_extractf128_ps(low, 1)), high);
+}
+
+__attribute__((target("avx2")))
+static void distances_avx2(const float *query, const vector_row_t *rows, size_t count, float *output)
+{
+	__m256 query_low = _mm256_loadu_ps(query);
+	__m128 query_high = _mm_loadu_ps(query + 8);
+
+	// Four rows at a time, so the horizontal sums of all four finish in one register
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 first = squared_distance_parts(query_low, query_high, rows[i].data());
+		__m128 second = squared_distance_parts(query_low, query_high, rows[i + 1].data());
+		__m128 third = squared_distance_parts(query_low, query_high, rows[i + 2].data());
+		__m128 fourth = squared_distance_parts(query_low, query_high, rows[i + 3].data());
+		__m128 sums = _mm_hadd_ps(_mm_hadd_ps(first, second), _mm_hadd_ps(third, fourth));
+		_mm_storeu_ps(output + i, _mm_sqrt_ps(sums));
+	}
+	for (; i < count; i++) output[i] = distance_scalar(query, rows[i].data());
+}
+
+struct avx2_bounds_t
+{
+	__m256 lower_low, upper_low, target_low, weights_low;
+	__m128 lower_high, upper_high, target_high, weights_high;
+};
+
+// Returns the weighted squared differences folded to 4 lanes, and sets `inside` to all ones if the row is inside the bounds
+__attribute__((target("avx2")))
+static __m128 bounded_parts(const avx2_bounds_t &bounds, const float *row, __m128 &inside)
+{
+	__m256 low = _mm256_loadu_ps(row);
+	__m128 high = _mm_loadu_ps(row + 8);
+
+	__m256 inside_low = _mm256_and_ps(_mm256_cmp_ps(low, bounds.lower_low, _CMP_GE_OQ), _mm256_cmp_ps(low, bounds.upper_low, _CMP_LE_OQ));
+	__m128 inside_high = _mm_and_ps(_mm_cmpge_ps(high, bounds.lower_high), _mm_cmple_ps(high, bounds.upper_high));
+	inside = _mm_and_ps(_mm_and_ps(_mm256_castps256_ps128(inside_low), _mm256_extractf128_ps(inside_low, 1)), inside_high);
+
+	__m256 difference_low = _mm256_sub_ps(low, bounds.target_low);
+	__m128 difference_high = _mm_sub_ps(high, bounds.target_high);
+	difference_low = _mm256_mul_ps(bounds.weights_low, _mm256_mul_ps(difference_low, difference_low));
+	difference_high = _mm_mul_ps(bounds.weights_high, _mm_mul_ps(difference_high, difference_high));
+	return _mm_add_ps(_mm_add_ps(_mm256_castps256_ps128(difference_low), _mm256_extractf128_ps(difference_low, 1)), difference_high);
+}
+
+// Reduces a 4 lane mask to all ones in every lane if all 4 lanes are set
+__attribute__((target("avx2")))
+static __m128 all_lanes(__m128 mask)
+{
+	mask = _mm_and_ps(mask, _mm_shuffle_ps(mask, mask, _MM_SHUFFLE(1, 0, 3, 2)));
+	return _mm_and_ps(mask, _mm_shuffle_ps(mask, mask, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+__attribute__((target("avx2")))
+static void bounded_distances_avx2(const bounds_t &bounds, const vector_row_t *rows, size_t count, float *output)
+{
+	const avx2_bounds_t registers = {
+		_mm256_loadu_ps(bounds.lower), _mm256_loadu_ps(bounds.upper), _mm256_loadu_ps(bounds.target), _mm256_loadu_ps(bounds.weights),
+		_mm_loadu_ps(bounds.lower + 8), _mm_loadu_ps(bounds.upper + 8), _mm_loadu_ps(bounds.target + 8), _mm_loadu_ps(bounds.weights + 8)
+	};
+	const __m128 infinity = _mm_set1_ps(std::numeric_limits<float>::infinity());
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 inside[4];
+		__m128 first = bounded_parts(registers, rows[i].data(), inside[0]);
+		__m128 second = bounded_parts(registers, rows[i + 1].data(), inside[1]);
+		__m128 third = bounded_parts(registers, rows[i + 2].data(), inside[2]);
+		__m128 fourth = bounded_parts(registers, rows[i + 3].data(), inside[3]);
+		__m128 sums = _mm_sqrt_ps(_mm_hadd_ps(_mm_hadd_ps(first, second), _mm_hadd_ps(third, fourth)));
+
+		// Lane k of the combined mask says whether row i + k is inside
+		__m128 masks = _mm_blend_ps(
+			_mm_blend_ps(all_lanes(inside[0]), all_lanes(inside[1]), 0b0010),
+			_mm_blend_ps(all_lanes(inside[2]), all_lanes(inside[3]), 0b1000),
+			0b1100);
+		_mm_storeu_ps(output + i, _mm_blendv_ps(infinity, sums, masks));
+	}
+	for (; i < count; i++) output[i] = bounded_distance_scalar(bounds, rows[i].data());
+}
+
+#elif defined(SPOTIFY_API_KERNELS_NEON)
+
+static float sum_neon(const float *values, size_t count)
+{
+	float32x4_t first = vdupq_n_f32(0.0f);
+	float32x4_t second = vdupq_n_f32(0.0f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		first = vaddq_f32(first, vld1q_f32(values + i));
+		second = vaddq_f32(second, vld1q_f32(values + i + 4));
+	}
+	return vaddvq_f32(vaddq_f32(first, second)) + sum_scalar(values + i, count - i);
+}
+
+static void sum_rows_neon(const vector_row_t *rows, size_t count, float *output)
+{
+	float32x4_t first = vdupq_n_f32(0.0f);
+	float32x4_t second = vdupq_n_f32(0.0f);
+	float32x4_t third = vdupq_n_f32(0.0f);
+	for (size_t i = 0; i < count; i++)
+	{
+		first = vaddq_f32(first, vld1q_f32(rows[i].data()));
+		second = vaddq_f32(second, vld1q_f32(rows[i].data() + 4));
+		third = vaddq_f32(third, vld1q_f32(rows[i].data() + 8));
+	}
+	vst1q_f32(output, first);
+	vst1q_f32(output + 4, second);
+	vst1q_f32(output + 8, third);
+}
+
+static void distances_neon(const float *query, const vector_row_t *rows, size_t count, float *output)
+{
+	float32x4_t query_first = vld1q_f32(query);
+	float32x4_t query_second = vld1q_f32(query + 4);
+	float32x4_t query_third = vld1q_f32(query + 8);
+	for (size_t i = 0; i < count; i++)
+	{
+		float32x4_t first = vsubq_f32(vld1q_f32(rows[i].data()), query_first);
+		float32x4_t second = vsubq_f32(vld1q_f32(rows[i].data() + 4), query_second);
+		float32x4_t third = vsubq_f32(vld1q_f32(rows[i].data() + 8), query_third);
+		float32x4_t sum = vmulq_f32(first, first);
+		sum = vmlaq_f32(sum, second, second);
+		sum = vmlaq_f32(sum, third, third);
+		output[i] = std::sqrt(vaddvq_f32(sum));
+	}
+}
+
+static void bounded_distances_neon(const bounds_t &bounds, const vector_row_t *rows, size_t count, float *output)
+{
+	float32x4_t lower[3], upper[3], target[3], weights[3];
+	for (size_t part = 0; part < 3; part++)
+	{
+		lower[part] = vld1q_f32(bounds.lower + part * 4);
+		upper[part] = vld1q_f32(bounds.upper + part * 4);
+		target[part] = vld1q_f32(bounds.target + part * 4);
+		weights[part] = vld1q_f32(bounds.weights + part * 4);
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32x4_t inside = vdupq_n_u32(0xFFFFFFFF);
+		float32x4_t sum = vdupq_n_f32(0.0f);
+		for (size_t part = 0; part < 3; part++)
+		{
+			float32x4_t values = vld1q_f32(rows[i].data() + part * 4);
+			inside = vandq_u32(inside, vandq_u32(vcgeq_f32(values, lower[part]), vcleq_f32(values, upper[part])));
+			float32x4_t difference = vsubq_f32(values, target[part]);
+			sum = vmlaq_f32(sum, weights[part], vmulq_f32(difference, difference));
+		}
+		output[i] = vminvq_u32(inside) ? std::sqrt(vaddvq_f32(sum)) : std::numeric_limits<float>::infinity();
+	}
+}
+
+#endif
+
+static constexpr kernel_table_t scalar_kernels = {"scalar", sum_scalar, sum_rows_scalar, loudness_scalar, distances_scalar, bounded_distances_scalar};
+
+static kernel_table_t select_kernels()
+{
+#if defined(SPOTIFY_API_KERNELS_AVX2)
+	if (__builtin_cpu_supports("avx2")) return {"avx2", sum_avx2, sum_rows_avx2, loudness_avx2, distances_avx2, bounded_distances_avx2};
+#elif defined(SPOTIFY_API_KERNELS_NEON)
+	// NEON has no gather instruction, so the loudness curve uses the scalar loop
+	return {"neon", sum_neon, sum_rows_neon, loudness_scalar, distances_neon, bounded_distances_neon};
+#endif
+	return scalar_kernels;
+}
+
+static kernel_table_t &kernels()
+{
+	static kernel_table_t table = select_kernels();
+	return table;
+}
+
+std::string_view instruction_set()
+{
+	return kernels().name;
+}
+
+bool use_instruction_set(std::string_view name)
+{
+	if (name == "scalar")
+	{
+		kernels() = scalar_kernels;
+		return true;
+	}
+
+	// The best available set is the only vectorized one, see select_kernels
+	kernel_table_t best = select_kernels();
+	if (best.name != name) return false;
+	kernels() = best;
+	return true;
+}
+
+
+std::vector<segment_range_t> segments_per_interval(std::span<const float> segment_starts, std::span<const float> interval_starts, std::span<const float> interval_durations)
+{
+	std::vector<segment_range_t> ranges(interval_starts.size(), segment_range_t{0, 0});
+	if (segment_starts.empty()) return ranges;
+
+	// Both lists are sorted, so one cursor walks the segments once for all intervals
+	size_t segment = 0;
+	for (size_t i = 0; i < interval_starts.size(); i++)
+	{
+		float start = interval_starts[i];
+		float end = start + interval_durations[i];
+
+		while (segment < segment_starts.size() && segment_starts[segment] < start) segment++;
+
+		size_t first = segment;
+		while (segment < segment_starts.size() && segment_starts[segment] < end) segment++;
+
+		if (segment > first)
+		{
+			ranges[i] = segment_range_t{static_cast<uint32_t>(first), static_cast<uint32_t>(segment - first)};
+		}
+		else
+		{
+			// No segment starts inside this interval, so use the one that is still playing
+			ranges[i] = segment_range_t{static_cast<uint32_t>(first > 0 ? first - 1 : 0), 1};
+		}
+	}
+	return ranges;
+}
+
+std::vector<segment_range_t> segments_per_interval(const columnar_analysis_t::segment_columns_t &segments, const columnar_analysis_t::interval_columns_t &intervals)
+{
+	return segments_per_interval(segments.start, intervals.start, intervals.duration);
+}
+
+std::vector<segment_range_t> segments_per_interval(const columnar_analysis_t::segment_columns_t &segments, const columnar_analysis_t::section_columns_t &sections)
+{
+	return segments_per_interval(segments.start, sections.start, sections.duration);
+}
+
+std::vector<float> mean_per_interval(std::span<const float> values, std::span<const segment_range_t> ranges)
+{
+	const kernel_table_t &table = kernels();
+	std::vector<float> means(ranges.size(), 0.0f);
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		const segment_range_t &range = ranges[i];
+		if (range.count == 0 || range.first + range.count > values.size()) continue;
+		means[i] = table.sum(values.data() + range.first, range.count) / static_cast<float>(range.count);
+	}
+	return means;
+}
+
+std::vector<vector_row_t> mean_rows_per_interval(std::span<const vector_row_t> rows, std::span<const segment_range_t> ranges)
+{
+	const kernel_table_t &table = kernels();
+	std::vector<vector_row_t> means(ranges.size(), vector_row_t{});
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		const segment_range_t &range = ranges[i];
+		if (range.count == 0 || range.first + range.count > rows.size()) continue;
+
+		table.sum_rows(rows.data() + range.first, range.count, means[i].data());
+		float scale = 1.0f / static_cast<float>(range.count);
+		for (float &value : means[i]) value *= scale;
+	}
+	return means;
+}
+
+std::vector<float> loudness_curve(const columnar_analysis_t::segment_columns_t &segments, float start_time, float step, size_t count)
+{
+	std::vector<float> curve;
+	if (segments.empty()) return curve;
+
+	loudness_columns_t columns = {
+		segments.start.data(),
+		segments.duration.data(),
+		segments.loudness_start.data(),
+		segments.loudness_max.data(),
+		segments.loudness_max_time.data(),
+		segments.loudness_end.data(),
+		static_cast<uint32_t>(segments.size())
+	};
+
+	// Finding the segment of each sample is a sequential walk; the interpolation after it is not
+	std::vector<uint32_t> indexes(count);
+	uint32_t segment = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		float time = start_time + step * static_cast<float>(i);
+		while (segment + 1 < columns.count && segments.start[segment + 1] <= time) segment++;
+		indexes[i] = segment;
+	}
+
+	curve.resize(count);
+	kernels().loudness(columns, indexes.data(), start_time, step, count, curve.data());
+	return curve;
+}
+
+void distances(const vector_row_t &query, std::span<const vector_row_t> rows, std::span<float> output)
+{
+	kernels().distances(query.data(), rows.data(), std::min(rows.size(), output.size()), output.data());
+}
+
+std::vector<float> distances(const vector_row_t &query, std::span<const vector_row_t> rows)
+{
+	std::vector<float> output(rows.size());
+	distances(query, rows, output);
+	return output;
+}
+
+void bounded_distances(const vector_row_t &lower, const vector_row_t &upper, const vector_row_t &target, const vector_row_t &weights,
+	std::span<const vector_row_t> rows, std::span<float> output)
+{
+	bounds_t bounds = {lower.data(), upper.data(), target.data(), weights.data()};
+	kernels().bounded_distances(bounds, rows.data(), std::min(rows.size(), output.size()), output.data());
+}
+
+} // namespace analysis_kernels
+
+} // namespace spotify_api
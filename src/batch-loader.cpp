@@ -0,0 +1,214 @@
+#include "batch-loader.hpp"
+
+#include <iostream>
+
+namespace spotify_api
+{
+
+template <class T>
+batch_loader_t<T>::batch_loader_t(fetch_t fetch, options_t options):
+	_fetch(std::move(fetch)), _options(options)
+{
+	this->_options.max_batch = std::max<size_t>(this->_options.max_batch, 1);
+	this->_thread = std::thread(&batch_loader_t::send_loop, this);
+}
+
+template <class T>
+batch_loader_t<T>::~batch_loader_t()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		this->_stopping = true;
+	}
+	this->_signal.notify_all();
+	this->_thread.join();
+}
+
+template <class T>
+std::shared_future<std::shared_ptr<const T>> batch_loader_t<T>::load(const std::string &id_or_uri)
+{
+	auto id = spotify_id_t::parse(id_or_uri);
+	if (!id)
+	{
+		promise_t invalid;
+		invalid.set_value(nullptr);
+		return invalid.get_future().share();
+	}
+
+	std::shared_future<std::shared_ptr<const T>> future;
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		future = this->enqueue(*id);
+	}
+	this->_signal.notify_one();
+	return future;
+}
+
+template <class T>
+std::vector<std::shared_future<std::shared_ptr<const T>>> batch_loader_t<T>::load_many(const std::vector<std::string> &ids_or_uris)
+{
+	std::vector<std::shared_future<std::shared_ptr<const T>>> futures;
+	futures.reserve(ids_or_uris.size());
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		for (const std::string &id_or_uri : ids_or_uris)
+		{
+			auto id = spotify_id_t::parse(id_or_uri);
+			if (id)
+			{
+				futures.push_back(this->enqueue(*id));
+				continue;
+			}
+			promise_t invalid;
+			invalid.set_value(nullptr);
+			futures.push_back(invalid.get_future().share());
+		}
+	}
+	this->_signal.notify_one();
+	return futures;
+}
+
+template <class T>
+std::shared_future<std::shared_ptr<const T>> batch_loader_t<T>::enqueue(const spotify_id_t &id)
+{
+	this->_stats.loads++;
+
+	auto waiting = this->_open.futures.find(id);
+	if (waiting != this->_open.futures.end())
+	{
+		this->_stats.duplicates++;
+		return waiting->second;
+	}
+
+	if (this->_open.ids.empty()) this->_open.deadline = std::chrono::steady_clock::now() + this->_options.window;
+	this->_open.ids.push_back(id);
+	this->_open.promises.emplace_back();
+	auto future = this->_open.promises.back().get_future().share();
+	this->_open.futures.emplace(id, future);
+
+	if (this->_open.ids.size() >= this->_options.max_batch)
+	{
+		this->_ready.push_back(std::move(this->_open));
+		this->_open = batch_t();
+	}
+	return future;
+}
+
+template <class T>
+void batch_loader_t<T>::dispatch()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		if (this->_open.ids.empty()) return;
+		this->_ready.push_back(std::move(this->_open));
+		this->_open = batch_t();
+	}
+	this->_signal.notify_one();
+}
+
+template <class T>
+typename batch_loader_t<T>::stats_t batch_loader_t<T>::stats() const
+{
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	return this->_stats;
+}
+
+template <class T>
+void batch_loader_t<T>::send_loop()
+{
+	std::unique_lock<std::mutex> lock(this->_mutex);
+	while (true)
+	{
+		// The open batch is sent at the end of its window, or right away when stopping
+		bool open_due = !this->_open.ids.empty() && (this->_stopping || std::chrono::steady_clock::now() >= this->_open.deadline);
+		if (open_due)
+		{
+			this->_ready.push_back(std::move(this->_open));
+			this->_open = batch_t();
+		}
+
+		if (!this->_ready.empty())
+		{
+			std::vector<batch_t> ready = std::move(this->_ready);
+			this->_ready.clear();
+			this->_stats.requests += ready.size();
+
+			lock.unlock();
+			for (batch_t &batch : ready) this->send(batch);
+			lock.lock();
+			continue;
+		}
+
+		if (this->_stopping) return;
+		if (this->_open.ids.empty()) this->_signal.wait(lock);
+		else this->_signal.wait_until(lock, this->_open.deadline);
+	}
+}
+
+template <class T>
+void batch_loader_t<T>::send(batch_t &batch)
+{
+	std::vector<std::unique_ptr<T>> items;
+	try
+	{
+		items = this->_fetch(batch.ids);
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << "Failed to load a batch of " << batch.ids.size() << " items: " << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		// http::get throws a const char* on network errors
+		std::cerr << "Failed to load a batch of " << batch.ids.size() << " items" << std::endl;
+	}
+
+	for (size_t i = 0; i < batch.promises.size(); i++)
+	{
+		std::shared_ptr<const T> item;
+		if (i < items.size() && items[i]) item = std::move(items[i]);
+		batch.promises[i].set_value(std::move(item));
+	}
+}
+
+namespace
+{
+	std::vector<std::string> base62_ids(std::span<const spotify_id_t> ids)
+	{
+		std::vector<std::string> strings;
+		strings.reserve(ids.size());
+		for (const spotify_id_t &id : ids) strings.push_back(id.to_string());
+		return strings;
+	}
+} // namespace
+
+std::unique_ptr<batch_loader_t<track_t>> make_track_loader(Track_API *api, const std::string &market)
+{
+	auto fetch = [api, market](std::span<const spotify_id_t> ids) { return api->get_tracks(base62_ids(ids), market); };
+	return std::make_unique<batch_loader_t<track_t>>(fetch, batch_loader_t<track_t>::options_t{50});
+}
+
+std::unique_ptr<batch_loader_t<album_t>> make_album_loader(Album_API *api)
+{
+	auto fetch = [api](std::span<const spotify_id_t> ids) { return api->get_albums(base62_ids(ids)); };
+	return std::make_unique<batch_loader_t<album_t>>(fetch, batch_loader_t<album_t>::options_t{20});
+}
+
+std::unique_ptr<batch_loader_t<artist_t>> make_artist_loader(Artist_API *api)
+{
+	auto fetch = [api](std::span<const spotify_id_t> ids) { return api->get_artists(base62_ids(ids)); };
+	return std::make_unique<batch_loader_t<artist_t>>(fetch, batch_loader_t<artist_t>::options_t{50});
+}
+
+std::unique_ptr<batch_loader_t<audio_features_t>> make_audio_features_loader(Track_API *api)
+{
+	auto fetch = [api](std::span<const spotify_id_t> ids) { return api->get_audio_features_for_tracks(base62_ids(ids)); };
+	return std::make_unique<batch_loader_t<audio_features_t>>(fetch, batch_loader_t<audio_features_t>::options_t{100});
+}
+
+template class batch_loader_t<track_t>;
+template class batch_loader_t<album_t>;
+template class batch_loader_t<artist_t>;
+template class batch_loader_t<audio_features_t>;
+
+} // namespace spotify_api
@@ -0,0 +1,521 @@
+#include "binary-library.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace spotify_api
+{
+
+using namespace binary_format;
+
+// The smallest record size a reader needs for each section
+static constexpr uint32_t minimum_record_sizes[section_count] = {
+	1,
+	sizeof(string_ref_t),
+	sizeof(uint32_t),
+	sizeof(pair_record_t),
+	sizeof(image_record_t),
+	sizeof(track_record_t),
+	sizeof(album_record_t),
+	sizeof(artist_record_t),
+	sizeof(playlist_record_t),
+	sizeof(episode_record_t),
+	sizeof(audio_features_record_t),
+};
+
+static constexpr uint32_t major_version(uint32_t version) { return version >> 16; }
+
+
+// Views
+
+static track_view_t track_at(const binary_library_t *library, uint32_t position)
+{
+	return library->track(library->index_at(position));
+}
+
+static artist_view_t artist_at(const binary_library_t *library, uint32_t position)
+{
+	return library->artist(library->index_at(position));
+}
+
+static std::string_view string_at(const binary_library_t *library, uint32_t position)
+{
+	return library->string(*library->record<string_ref_t>(string_lists, position));
+}
+
+static string_pair_t pair_at(const binary_library_t *library, uint32_t position)
+{
+	const pair_record_t *pair = library->record<pair_record_t>(pair_lists, position);
+	return string_pair_t(library->string(pair->key), library->string(pair->value));
+}
+
+static image_view_t image_at(const binary_library_t *library, uint32_t position)
+{
+	return image_view_t(library, library->record<image_record_t>(image_lists, position));
+}
+
+static market_set_t markets_of(const uint64_t (&bits)[market_set_t::word_count])
+{
+	std::array<uint64_t, market_set_t::word_count> words;
+	std::copy(std::begin(bits), std::end(bits), words.begin());
+	return market_set_t(words);
+}
+
+std::string_view image_view_t::url() const { return this->_library->string(this->_record->url); }
+
+std::string_view track_view_t::id() const { return this->_library->string(this->_record->id); }
+std::string_view track_view_t::name() const { return this->_library->string(this->_record->name); }
+std::string_view track_view_t::preview_url() const { return this->_library->string(this->_record->preview_url); }
+list_view_t<artist_view_t> track_view_t::artists() const { return list_view_t<artist_view_t>(this->_library, this->_record->artists, artist_at); }
+list_view_t<string_pair_t> track_view_t::external_ids() const { return list_view_t<string_pair_t>(this->_library, this->_record->external_ids, pair_at); }
+market_set_t track_view_t::available_markets() const { return markets_of(this->_record->available_markets); }
+
+std::optional<album_view_t> track_view_t::album() const
+{
+	if (this->_record->album == no_index) return std::nullopt;
+	return this->_library->album(this->_record->album);
+}
+
+std::string_view album_view_t::id() const { return this->_library->string(this->_record->id); }
+std::string_view album_view_t::name() const { return this->_library->string(this->_record->name); }
+std::string_view album_view_t::album_type() const { return this->_library->string(this->_record->album_type); }
+std::string_view album_view_t::release_date() const { return this->_library->string(this->_record->release_date); }
+std::string_view album_view_t::release_date_precision() const { return this->_library->string(this->_record->release_date_precision); }
+std::string_view album_view_t::label() const { return this->_library->string(this->_record->label); }
+list_view_t<artist_view_t> album_view_t::artists() const { return list_view_t<artist_view_t>(this->_library, this->_record->artists, artist_at); }
+list_view_t<track_view_t> album_view_t::tracks() const { return list_view_t<track_view_t>(this->_library, this->_record->tracks, track_at); }
+list_view_t<image_view_t> album_view_t::images() const { return list_view_t<image_view_t>(this->_library, this->_record->images, image_at); }
+list_view_t<std::string_view> album_view_t::genres() const { return list_view_t<std::string_view>(this->_library, this->_record->genres, string_at); }
+list_view_t<string_pair_t> album_view_t::external_ids() const { return list_view_t<string_pair_t>(this->_library, this->_record->external_ids, pair_at); }
+list_view_t<string_pair_t> album_view_t::copyrights() const { return list_view_t<string_pair_t>(this->_library, this->_record->copyrights, pair_at); }
+market_set_t album_view_t::available_markets() const { return markets_of(this->_record->available_markets); }
+
+std::string_view artist_view_t::id() const { return this->_library->string(this->_record->id); }
+std::string_view artist_view_t::name() const { return this->_library->string(this->_record->name); }
+list_view_t<std::string_view> artist_view_t::genres() const { return list_view_t<std::string_view>(this->_library, this->_record->genres, string_at); }
+list_view_t<image_view_t> artist_view_t::images() const { return list_view_t<image_view_t>(this->_library, this->_record->images, image_at); }
+
+std::string_view playlist_view_t::id() const { return this->_library->string(this->_record->id); }
+std::string_view playlist_view_t::name() const { return this->_library->string(this->_record->name); }
+std::string_view playlist_view_t::description() const { return this->_library->string(this->_record->description); }
+std::string_view playlist_view_t::snapshot_id() const { return this->_library->string(this->_record->snapshot_id); }
+std::string_view playlist_view_t::owner_id() const { return this->_library->string(this->_record->owner_id); }
+std::string_view playlist_view_t::owner_display_name() const { return this->_library->string(this->_record->owner_display_name); }
+list_view_t<image_view_t> playlist_view_t::images() const { return list_view_t<image_view_t>(this->_library, this->_record->images, image_at); }
+list_view_t<track_view_t> playlist_view_t::tracks() const { return list_view_t<track_view_t>(this->_library, this->_record->tracks, track_at); }
+
+std::string_view episode_view_t::id() const { return this->_library->string(this->_record->id); }
+std::string_view episode_view_t::name() const { return this->_library->string(this->_record->name); }
+std::string_view episode_view_t::description() const { return this->_library->string(this->_record->description); }
+std::string_view episode_view_t::html_description() const { return this->_library->string(this->_record->html_description); }
+std::string_view episode_view_t::audio_preview_url() const { return this->_library->string(this->_record->audio_preview_url); }
+std::string_view episode_view_t::release_date() const { return this->_library->string(this->_record->release_date); }
+std::string_view episode_view_t::release_date_precision() const { return this->_library->string(this->_record->release_date_precision); }
+list_view_t<image_view_t> episode_view_t::images() const { return list_view_t<image_view_t>(this->_library, this->_record->images, image_at); }
+list_view_t<std::string_view> episode_view_t::languages() const { return list_view_t<std::string_view>(this->_library, this->_record->languages, string_at); }
+
+std::string_view audio_features_view_t::id() const { return this->_library->string(this->_record->id); }
+
+
+// Reading
+
+binary_library_t::~binary_library_t()
+{
+#ifdef _WIN32
+	if (this->_mapping) UnmapViewOfFile(this->_mapping);
+	if (this->_mapping_handle) CloseHandle(static_cast<HANDLE>(this->_mapping_handle));
+#else
+	if (this->_mapping) munmap(this->_mapping, this->_size);
+#endif
+}
+
+std::unique_ptr<binary_library_t> binary_library_t::open(const std::string &path)
+{
+	auto library = std::unique_ptr<binary_library_t>(new binary_library_t());
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		std::cerr << "Failed to open library file " << path << std::endl;
+		return std::unique_ptr<binary_library_t>(nullptr);
+	}
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	library->_size = static_cast<size_t>(size.QuadPart);
+	if (library->_size > 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping)
+		{
+			library->_mapping_handle = mapping;
+			library->_mapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		}
+	}
+	CloseHandle(file);
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		std::cerr << "Failed to open library file " << path << std::endl;
+		return std::unique_ptr<binary_library_t>(nullptr);
+	}
+	struct stat status;
+	if (fstat(file, &status) == 0 && status.st_size > 0)
+	{
+		library->_size = static_cast<size_t>(status.st_size);
+		void *mapping = mmap(nullptr, library->_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (mapping != MAP_FAILED) library->_mapping = mapping;
+	}
+	::close(file);
+#endif
+
+	if (!library->_mapping)
+	{
+		std::cerr << "Failed to map library file " << path << std::endl;
+		return std::unique_ptr<binary_library_t>(nullptr);
+	}
+	library->_data = static_cast<const char *>(library->_mapping);
+	return validate(std::move(library));
+}
+
+std::unique_ptr<binary_library_t> binary_library_t::from_bytes(std::string bytes)
+{
+	auto library = std::unique_ptr<binary_library_t>(new binary_library_t());
+	library->_buffer = std::move(bytes);
+	library->_data = library->_buffer.data();
+	library->_size = library->_buffer.size();
+	return validate(std::move(library));
+}
+
+std::unique_ptr<binary_library_t> binary_library_t::validate(std::unique_ptr<binary_library_t> library)
+{
+	// The section table is read in place, so a file must have at least as many sections as this reader knows about.
+	// Newer files may have more.
+	if (library->_size < sizeof(header_t) || reinterpret_cast<uintptr_t>(library->_data) % 8 != 0)
+	{
+		std::cerr << "Library file is too small or not aligned" << std::endl;
+		return std::unique_ptr<binary_library_t>(nullptr);
+	}
+
+	const header_t *header = library->header();
+	if (std::memcmp(header->magic, magic, sizeof(magic)) != 0 || header->byte_order_mark != byte_order_mark)
+	{
+		std::cerr << "Not a library file, or written on a machine with a different byte order" << std::endl;
+		return std::unique_ptr<binary_library_t>(nullptr);
+	}
+	if (major_version(header->version) != major_version(binary_format::version) || header->section_entries < section_count || header->header_size < sizeof(header_t))
+	{
+		std::cerr << "Unsupported library file version " << (header->version >> 16) << '.' << (header->version & 0xFFFF) << std::endl;
+		return std::unique_ptr<binary_library_t>(nullptr);
+	}
+
+	for (uint32_t id = 0; id < section_count; id++)
+	{
+		const section_t &section = header->sections[id];
+		uint32_t alignment = std::min<uint32_t>(minimum_record_sizes[id], 8);
+		bool valid = section.offset % 8 == 0
+			&& section.offset <= library->_size && section.size <= library->_size - section.offset
+			&& section.record_size >= minimum_record_sizes[id] && section.record_size % alignment == 0
+			&& static_cast<uint64_t>(section.count) * section.record_size <= section.size;
+		if (!valid)
+		{
+			std::cerr << "Library file section " << id << " is damaged" << std::endl;
+			return std::unique_ptr<binary_library_t>(nullptr);
+		}
+	}
+	return library;
+}
+
+std::string_view binary_library_t::string(string_ref_t ref) const
+{
+	const section_t &section = this->header()->sections[strings];
+	if (static_cast<uint64_t>(ref.offset) + ref.length > section.count) return std::string_view();
+	return std::string_view(this->_data + section.offset + ref.offset, ref.length);
+}
+
+uint32_t binary_library_t::index_at(uint32_t position) const
+{
+	const section_t &section = this->header()->sections[index_lists];
+	if (position >= section.count) return no_index;
+	return *reinterpret_cast<const uint32_t *>(this->_data + section.offset + static_cast<uint64_t>(position) * section.record_size);
+}
+
+
+// Writing
+
+string_ref_t binary_library_writer_t::add_string(std::string_view value)
+{
+	if (value.empty()) return string_ref_t{0, 0};
+
+	auto found = this->_string_refs.find(std::string(value));
+	if (found != this->_string_refs.end()) return found->second;
+
+	string_ref_t ref = {static_cast<uint32_t>(this->_strings.size()), static_cast<uint32_t>(value.size())};
+	this->_strings.append(value);
+	this->_string_refs.emplace(std::string(value), ref);
+	return ref;
+}
+
+template <class Strings>
+list_ref_t binary_library_writer_t::add_string_list(const Strings &values)
+{
+	list_ref_t list = {static_cast<uint32_t>(this->_string_lists.size()), static_cast<uint32_t>(values.size())};
+	for (const auto &value : values) this->_string_lists.push_back(this->add_string(std::string_view(value)));
+	return list;
+}
+
+list_ref_t binary_library_writer_t::add_images(const std::vector<image_t> &images)
+{
+	list_ref_t list = {static_cast<uint32_t>(this->_image_lists.size()), static_cast<uint32_t>(images.size())};
+	for (const image_t &image : images)
+	{
+		this->_image_lists.push_back(image_record_t{this->add_string(image.url), image.width, image.height});
+	}
+	return list;
+}
+
+list_ref_t binary_library_writer_t::add_pairs(const std::map<std::string, std::string> &values)
+{
+	list_ref_t list = {static_cast<uint32_t>(this->_pair_lists.size()), static_cast<uint32_t>(values.size())};
+	for (const auto &[key, value] : values)
+	{
+		this->_pair_lists.push_back(pair_record_t{this->add_string(key), this->add_string(value)});
+	}
+	return list;
+}
+
+list_ref_t binary_library_writer_t::add_indexes(const std::vector<uint32_t> &indexes)
+{
+	list_ref_t list = {static_cast<uint32_t>(this->_index_lists.size()), static_cast<uint32_t>(indexes.size())};
+	this->_index_lists.insert(this->_index_lists.end(), indexes.begin(), indexes.end());
+	return list;
+}
+
+// Reserves a record for an entity before its references are added, so that cycles
+// (an album whose tracks point back at the album) resolve to the reserved index.
+// Returns the existing index and false if the ID was already added.
+template <class Record>
+static std::pair<uint32_t, bool> reserve_record(std::vector<Record> &records, std::unordered_map<std::string, uint32_t> &ids, const std::string &id)
+{
+	if (!id.empty())
+	{
+		auto found = ids.find(id);
+		if (found != ids.end()) return {found->second, false};
+		ids.emplace(id, static_cast<uint32_t>(records.size()));
+	}
+	records.emplace_back();
+	return {static_cast<uint32_t>(records.size() - 1), true};
+}
+
+template <class Entities, class Add>
+static std::vector<uint32_t> collect_indexes(const Entities &entities, Add add)
+{
+	std::vector<uint32_t> indexes;
+	indexes.reserve(entities.size());
+	for (const auto &entity : entities)
+	{
+		if (entity) indexes.push_back(add(*entity));
+	}
+	return indexes;
+}
+
+uint32_t binary_library_writer_t::add(const track_t &track)
+{
+	auto [index, added] = reserve_record(this->_tracks, this->_track_ids, track.id);
+	if (!added) return index;
+
+	track_record_t record{};
+	record.id = this->add_string(track.id);
+	record.name = this->add_string(track.name);
+	record.preview_url = this->add_string(track.preview_url);
+	record.album = track.album ? this->add(*track.album) : no_index;
+	record.flags = (track.is_explicit ? uint32_t(track_explicit) : 0) | (track.is_playable ? uint32_t(track_playable) : 0) | (track.is_local ? uint32_t(track_local) : 0);
+	record.artists = this->add_indexes(collect_indexes(track.artists, [this](const artist_t &artist) { return this->add(artist); }));
+	record.external_ids = this->add_pairs(track.external_ids);
+	std::copy(track.available_markets.bits().begin(), track.available_markets.bits().end(), record.available_markets);
+	record.disc_number = track.disc_number;
+	record.duration_ms = track.duration_ms;
+	record.track_number = track.track_number;
+	record.popularity = track.popularity;
+
+	this->_tracks[index] = record;
+	return index;
+}
+
+uint32_t binary_library_writer_t::add(const album_t &album)
+{
+	auto [index, added] = reserve_record(this->_albums, this->_album_ids, album.id);
+	if (!added) return index;
+
+	album_record_t record{};
+	record.id = this->add_string(album.id);
+	record.name = this->add_string(album.name);
+	record.album_type = this->add_string(album.album_type);
+	record.release_date = this->add_string(album.release_date);
+	record.release_date_precision = this->add_string(album.release_date_precision);
+	record.label = this->add_string(album.label.view());
+	record.artists = this->add_indexes(collect_indexes(album.artists, [this](const artist_t &artist) { return this->add(artist); }));
+	record.tracks = this->add_indexes(collect_indexes(album.tracks.items, [this](const track_t &track) { return this->add(track); }));
+	record.images = this->add_images(album.images);
+	record.genres = this->add_string_list(album.genres);
+	record.external_ids = this->add_pairs(album.external_ids);
+
+	record.copyrights = list_ref_t{static_cast<uint32_t>(this->_pair_lists.size()), static_cast<uint32_t>(album.copyrights.size())};
+	for (const copyright_t &copyright : album.copyrights)
+	{
+		this->_pair_lists.push_back(pair_record_t{this->add_string(copyright.text.view()), this->add_string(copyright.type)});
+	}
+
+	std::copy(album.available_markets.bits().begin(), album.available_markets.bits().end(), record.available_markets);
+	record.total_tracks = album.total_tracks;
+	record.popularity = album.popularity;
+
+	this->_albums[index] = record;
+	return index;
+}
+
+uint32_t binary_library_writer_t::add(const artist_t &artist)
+{
+	auto [index, added] = reserve_record(this->_artists, this->_artist_ids, artist.id);
+	if (!added) return index;
+
+	artist_record_t record{};
+	record.id = this->add_string(artist.id);
+	record.name = this->add_string(artist.name.view());
+	record.genres = this->add_string_list(artist.genres);
+	record.images = this->add_images(artist.images);
+	record.popularity = artist.popularity;
+	record.followers = artist.followers.total;
+
+	this->_artists[index] = record;
+	return index;
+}
+
+uint32_t binary_library_writer_t::add(const playlist_t &playlist)
+{
+	auto [index, added] = reserve_record(this->_playlists, this->_playlist_ids, playlist.id);
+	if (!added) return index;
+
+	playlist_record_t record{};
+	record.id = this->add_string(playlist.id);
+	record.name = this->add_string(playlist.name);
+	record.description = this->add_string(playlist.description);
+	record.snapshot_id = this->add_string(playlist.snapshot_id);
+	record.owner_id = this->add_string(playlist.owner.id);
+	record.owner_display_name = this->add_string(playlist.owner.display_name);
+	record.images = this->add_images(playlist.images);
+	record.tracks = this->add_indexes(collect_indexes(playlist.tracks.items, [this](const track_t &track) { return this->add(track); }));
+	record.total_tracks = playlist.tracks.total;
+	record.followers = playlist.followers.total;
+	record.flags = (playlist.collaborative ? uint32_t(playlist_collaborative) : 0) | (playlist.is_public ? uint32_t(playlist_public) : 0);
+
+	this->_playlists[index] = record;
+	return index;
+}
+
+uint32_t binary_library_writer_t::add(const episode_t &episode)
+{
+	auto [index, added] = reserve_record(this->_episodes, this->_episode_ids, episode.id);
+	if (!added) return index;
+
+	episode_record_t record{};
+	record.id = this->add_string(episode.id);
+	record.name = this->add_string(episode.name);
+	record.description = this->add_string(episode.description);
+	record.html_description = this->add_string(episode.html_description);
+	record.audio_preview_url = this->add_string(episode.audio_preview_url);
+	record.release_date = this->add_string(episode.release_date);
+	record.release_date_precision = this->add_string(episode.release_date_precision);
+	record.images = this->add_images(episode.images);
+	record.languages = this->add_string_list(episode.languages);
+	record.duration_ms = episode.duration_ms;
+	record.resume_position_ms = episode.resume_point.resume_position_ms;
+	record.flags = (episode.is_explicit ? uint32_t(episode_explicit) : 0) | (episode.is_externally_hosted ? uint32_t(episode_externally_hosted) : 0)
+		| (episode.is_playable ? uint32_t(episode_playable) : 0) | (episode.resume_point.fully_played ? uint32_t(episode_fully_played) : 0);
+
+	this->_episodes[index] = record;
+	return index;
+}
+
+uint32_t binary_library_writer_t::add(const audio_features_t &features)
+{
+	auto [index, added] = reserve_record(this->_audio_features, this->_audio_features_ids, features.id);
+	if (!added) return index;
+
+	audio_features_record_t record{};
+	record.id = this->add_string(features.id);
+	record.acousticness = features.acousticness;
+	record.danceability = features.danceability;
+	record.energy = features.energy;
+	record.instrumentalness = features.instrumentalness;
+	record.liveness = features.liveness;
+	record.loudness = features.loudness;
+	record.speechiness = features.speechiness;
+	record.tempo = features.tempo;
+	record.valence = features.valence;
+	record.duration_ms = features.duration_ms;
+	record.key = features.key;
+	record.mode = features.mode;
+	record.time_signature = features.time_signature;
+
+	this->_audio_features[index] = record;
+	return index;
+}
+
+std::string binary_library_writer_t::serialize() const
+{
+	header_t header{};
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = binary_format::version;
+	header.byte_order_mark = byte_order_mark;
+	header.header_size = sizeof(header_t);
+	header.section_entries = section_count;
+
+	std::string output(sizeof(header_t), '\0');
+	auto append = [&output, &header](section_id_t id, const void *data, size_t count, size_t record_size) {
+		output.resize((output.size() + 7) & ~size_t(7), '\0');
+		header.sections[id] = section_t{output.size(), count * record_size, static_cast<uint32_t>(count), static_cast<uint32_t>(record_size)};
+		output.append(static_cast<const char *>(data), count * record_size);
+	};
+
+	append(strings, this->_strings.data(), this->_strings.size(), 1);
+	append(string_lists, this->_string_lists.data(), this->_string_lists.size(), sizeof(string_ref_t));
+	append(index_lists, this->_index_lists.data(), this->_index_lists.size(), sizeof(uint32_t));
+	append(pair_lists, this->_pair_lists.data(), this->_pair_lists.size(), sizeof(pair_record_t));
+	append(image_lists, this->_image_lists.data(), this->_image_lists.size(), sizeof(image_record_t));
+	append(tracks, this->_tracks.data(), this->_tracks.size(), sizeof(track_record_t));
+	append(albums, this->_albums.data(), this->_albums.size(), sizeof(album_record_t));
+	append(artists, this->_artists.data(), this->_artists.size(), sizeof(artist_record_t));
+	append(playlists, this->_playlists.data(), this->_playlists.size(), sizeof(playlist_record_t));
+	append(episodes, this->_episodes.data(), this->_episodes.size(), sizeof(episode_record_t));
+	append(audio_features, this->_audio_features.data(), this->_audio_features.size(), sizeof(audio_features_record_t));
+
+	std::memcpy(output.data(), &header, sizeof(header_t));
+	return output;
+}
+
+bool binary_library_writer_t::write(const std::string &path) const
+{
+	std::string bytes = this->serialize();
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+	if (!file)
+	{
+		std::cerr << "Failed to write library file " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+} // namespace spotify_api
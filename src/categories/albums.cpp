@@ -1,6 +1,7 @@
 #include <iostream>
 #include "categories/albums.hpp"
 #include "endpoints/albums.hpp"
+#include "entity-store.hpp"
 
 namespace json = nlohmann;
 
@@ -23,89 +24,91 @@ std::unique_ptr<album_t> album_t::from_json(const std::string &json_string)
 	
 }
 
-std::unique_ptr<album_t> album_t::from_json(const json::json &json_object)
+// Returns the member if it exists, or an empty json value otherwise, without copying either.
+static const json::json &optional_member(const json::json &json_object, const char *key)
 {
-	auto album = std::make_unique<album_t>();
-
-	// using a single "temp" variable to save on memory space.
-	// why initialize a bunch of big stack variables when you could just use 1
-	json::json temp;
+	static const json::json empty;
+	auto member = json_object.find(key);
+	return member != json_object.end() ? *member : empty;
+}
 
+// Shared by every variant of album_t::from_json.
+// Artists and tracks are decoded with the same context, so they share its memory resource and entity store.
+static bool parse_album(album_t &album, const json::json &json_object, const decode_context_t &context)
+{
 	try
 	{
-		album->album_type = json_object["album_type"];
-		album->total_tracks = json_object["total_tracks"];
-
-		temp = json_object["available_markets"];
-		album->available_markets.reserve(temp.size());
-		for (auto market = temp.begin(); market != temp.end(); ++market)
+		album.album_type = json_object["album_type"];
+		album.total_tracks = json_object["total_tracks"];
+
+		if (json_object.contains("available_markets"))
+			album.available_markets = market_set_t::from_json(json_object["available_markets"]);
+
+		album.id = json_object["id"];
+#ifdef SPOTIFY_API_COMPACT_LINKS
+		album.links = entity_links_t::from_json(json_object, album_t::type, album.id);
+#else
+		const json::json &external_urls = json_object["external_urls"];
+		for (auto ext_url = external_urls.begin(); ext_url != external_urls.end(); ++ext_url)
 		{
-			album->available_markets.push_back(market.value());
+			album.external_urls.emplace(ext_url.key(), ext_url.value().get<std::string>());
 		}
-		album->available_markets.shrink_to_fit();
 
-		temp = json_object["external_urls"];
-		for (auto ext_url = temp.begin(); ext_url != temp.end(); ++ext_url)
-		{
-			album->external_urls.emplace(ext_url.key(), ext_url.value().get<std::string>());
-		}
+		album.href = json_object["href"];
+		album.uri = json_object["uri"];
+#endif
 
-		album->href = json_object["href"];
-		album->id = json_object["id"];
-
-		temp = json_object["images"];
-		album->images.reserve(temp.size());
-		for (auto image = temp.begin(); image != temp.end(); ++image)
+		const json::json &images = json_object["images"];
+		album.images.reserve(images.size());
+		for (auto image = images.begin(); image != images.end(); ++image)
 		{
-			album->images.push_back(image_t::from_json(image.value()));
+			album.images.push_back(image_t::from_json(image.value()));
 		}
-		album->images.shrink_to_fit();
 
-		album->name = json_object["name"];
-		album->release_date = json_object["release_date"];
-		album->release_date_precision = json_object["release_date_precision"];
+		album.name = json_object["name"];
+		album.release_date = json_object["release_date"];
+		album.release_date_precision = json_object["release_date_precision"];
 
-		
-		temp = json_object.value("restrictions", json::json::object());
-		for (auto item = temp.begin(); item != temp.end(); ++item)
+		const json::json &restrictions = optional_member(json_object, "restrictions");
+		for (auto item = restrictions.begin(); item != restrictions.end(); ++item)
 		{
-			album->restrictions.emplace(item.key(), item.value().get<std::string>());
+			album.restrictions.emplace(item.key(), item.value().get<std::string>());
 		}
 
-		temp = json_object.value("copyrights", json::json::array());
-		for (auto cp = temp.begin(); cp != temp.end(); ++cp)
+		const json::json &copyrights = optional_member(json_object, "copyrights");
+		album.copyrights.reserve(copyrights.size());
+		for (auto cp = copyrights.begin(); cp != copyrights.end(); ++cp)
 		{
-			album->copyrights.push_back((copyright_t) {cp.value()["text"].get<std::string>(), cp.value()["type"].get<std::string>()});
+			album.copyrights.push_back((copyright_t) {interned_string_t::from_json(cp.value()["text"]), cp.value()["type"].get<std::string>()});
 		}
-		album->copyrights.shrink_to_fit();
 
-		album->uri = json_object["uri"];
-
-		temp = json_object.value("external_ids", json::json::object());
-		for (auto id = temp.begin(); id != temp.end(); ++id)
+		const json::json &external_ids = optional_member(json_object, "external_ids");
+		for (auto id = external_ids.begin(); id != external_ids.end(); ++id)
 		{
-			album->restrictions.emplace(id.key(), id.value().get<std::string>());
+			album.external_ids.emplace(id.key(), id.value().get<std::string>());
 		}
 
-		temp = json_object.value("genres", json::json::object());
-		for (auto genre = temp.begin(); genre != temp.end(); ++genre)
+		const json::json &genres = optional_member(json_object, "genres");
+		album.genres.reserve(genres.size());
+		for (auto genre = genres.begin(); genre != genres.end(); ++genre)
 		{
-			album->genres.push_back(genre.value());
+			album.genres.push_back(interned_string_t::from_json(genre.value()));
 		}
 
-		album->popularity = json_object.value("popularity", 0);
+		album.popularity = json_object.value("popularity", 0);
 
-		album->label = json_object.value("label", "");
+		if (json_object.contains("label"))
+			album.label = interned_string_t::from_json(json_object["label"]);
 
-		temp = json_object.value("artists", json::json::array());
-		for (auto artist = temp.begin(); artist != temp.end(); ++artist)
+		const json::json &artists = optional_member(json_object, "artists");
+		album.artists.reserve(artists.size());
+		for (auto artist = artists.begin(); artist != artists.end(); ++artist)
 		{
-			album->artists.push_back(artist_t::from_json(artist.value()));
+			album.artists.push_back(artist_t::from_json(artist.value(), context));
 		}
 
-		album->tracks = json_object.contains("tracks")
-			? page_t<std::shared_ptr<track_t>>::from_json(json_object["tracks"])
-			: page_t<std::shared_ptr<track_t>>();
+		if (json_object.contains("tracks"))
+			album.tracks = page_t<std::shared_ptr<track_t>>::from_json(json_object["tracks"], context);
 	}
 	catch (const std::exception &e)
 	{
@@ -115,20 +118,51 @@ std::unique_ptr<album_t> album_t::from_json(const json::json &json_object)
 		// TODO: idk if this try-catch is necessary, but i guess it would be nice to have
 		// if someone gives us junk data. maybe return as much useful data as we can collect
 		// instead of returning an empty object? ¯\_(ツ)_/¯
-		return std::unique_ptr<album_t>(nullptr);
+		return false;
 	}
+	return true;
+}
+
+std::unique_ptr<album_t> album_t::from_json(const json::json &json_object)
+{
+	auto album = std::make_unique<album_t>();
+	if (!parse_album(*album, json_object, decode_context_t())) return std::unique_ptr<album_t>(nullptr);
+	return album;
+}
+
+std::shared_ptr<album_t> album_t::from_json(const json::json &json_object, const decode_context_t &context)
+{
+	if (context.store)
+	{
+		auto stored = context.store->lookup<album_t>(json_object);
+		if (stored) return stored;
+	}
+
+	auto album = make_entity<album_t>(context.resource);
+	if (!parse_album(*album, json_object, context)) return std::shared_ptr<album_t>(nullptr);
+
+	if (context.store) return context.store->insert(std::move(album), json_object);
 	return album;
 }
 
 std::unique_ptr<album_t> Album_API::get_album(const std::string &album_id)
 {
+	entity_cache_t<album_t>::key_t key;
+	bool cacheable = this->cache && entity_cache_t<album_t>::make_key(album_id, "", key);
+	if (cacheable)
+	{
+		if (auto cached = this->cache->find(key)) return std::make_unique<album_t>(*cached);
+	}
+
 	std::string url = API_PREFIX "/albums/";
 	url += album_id;
 
 	http::api_response response = http::get(url.c_str(), std::string(""), this->access_token);
 	if (response.code == 200)
 	{
-		return album_t::from_json(response.body);
+		auto album = album_t::from_json(response.body);
+		if (cacheable && album) this->cache->insert(key, std::make_shared<const album_t>(*album));
+		return album;
 	}
 
 	return std::unique_ptr<album_t>(nullptr);
@@ -136,39 +170,25 @@ std::unique_ptr<album_t> Album_API::get_album(const std::string &album_id)
 
 std::vector<std::unique_ptr<album_t>> Album_API::get_albums(const std::vector<std::string> &album_ids)
 {
-	std::vector<std::unique_ptr<album_t>> albums;
-	albums.reserve(album_ids.size());
-	std::string query_string = "";
-	size_t num_batches = ceil(album_ids.size() / 20);
-
-	std::vector<std::string> response_batches;
+	// Duplicates are kept, and invalid IDs get a null, so that the output lines up with the requested IDs.
+	normalized_ids_t ids = normalize_spotify_ids(album_ids, false);
 
-	for (size_t batch = 0; batch < num_batches; batch++)
+	return align_to_inputs(entity_cache_t<album_t>::get_many(this->cache.get(), ids.ids, -1, 20, [&](std::span<const spotify_id_t> batch)
 	{
-		size_t batch_size = batch * 20 + 20 < album_ids.size() ? 20 : album_ids.size() - (batch * 20 + 20);
-		query_string = "ids=";
-		for (size_t i = batch * 20; i < (batch * 20) + batch_size; i++)
-		{
-			query_string += album_ids.at(i) + ",";
-		}
-		query_string = std::regex_replace(query_string, std::regex(",+$"), "");
+		std::string query_string = "ids=" + join_spotify_ids(std::vector<spotify_id_t>(batch.begin(), batch.end()));
 		http::api_response batch_response = http::get(API_PREFIX "/albums", query_string, this->access_token);
-		if (batch_response.code == 200)
-		{
-			response_batches.push_back(batch_response.body);
-		}
-	}
 
-	for (auto page : response_batches)
-	{
-		json::json page_json = json::json::parse(page)["albums"];
+		std::vector<std::unique_ptr<album_t>> albums;
+		if (is_retryable_status(batch_response.code)) throw batch_retry_t(batch_response.code);
+		if (batch_response.code != 200) return albums;
+
+		json::json page_json = json::json::parse(batch_response.body)["albums"];
 		for (auto album = page_json.begin(); album != page_json.end(); ++album)
 		{
-			albums.push_back(album_t::from_json(album.value().dump()));
+			albums.push_back(album.value().is_null() ? std::unique_ptr<album_t>(nullptr) : album_t::from_json(album.value()));
 		}
-	}
-	albums.shrink_to_fit();
-	return albums;
+		return albums;
+	}), ids);
 }
 
 page_t<std::unique_ptr<track_t>> Album_API::get_album_tracks(const std::string &album_id, uint32_t limit, uint32_t offset, const std::string &market)
@@ -209,6 +229,16 @@ page_t<std::unique_ptr<track_t>> Album_API::get_album_tracks(const std::string &
 	return retval;
 }
 
+all_pages_t<std::unique_ptr<track_t>> Album_API::get_all_album_tracks(const std::string &album_id, const std::string &market)
+{
+	std::string url = API_PREFIX "/albums/" + truncate_spotify_uri(album_id) + "/tracks";
+	std::string query_data = market.empty() ? "" : "market=" + market;
+	return fetch_all_pages<std::unique_ptr<track_t>>(url, query_data, this->access_token, 50, [](const json::json &track)
+	{
+		return track_t::from_json(track);
+	});
+}
+
 page_t<std::unique_ptr<album_t>> Album_API::get_users_albums(uint32_t limit, uint32_t offset, const std::string &market)
 {
 	std::ostringstream query_data;
@@ -218,7 +248,33 @@ page_t<std::unique_ptr<album_t>> Album_API::get_users_albums(uint32_t limit, uin
 	if (response.code != 200) {
 		return page_t<std::unique_ptr<album_t>>();
 	}
-	return page_t<std::unique_ptr<album_t>>::from_json(response.body);
+
+	// Saved albums come wrapped as {"added_at", "album"}
+	json::json page_json = json::json::parse(response.body);
+	for (auto &item : page_json["items"])
+	{
+		json::json album = std::move(item["album"]);
+		item = std::move(album);
+	}
+	return page_t<std::unique_ptr<album_t>>::from_json(page_json);
+}
+
+// Saved albums come wrapped as {"added_at", "album"}
+static std::unique_ptr<album_t> saved_album_from_item(const json::json &item)
+{
+	return album_t::from_json(item.at("album"));
+}
+
+all_pages_t<std::unique_ptr<album_t>> Album_API::get_all_users_albums(const std::string &market, size_t max_items)
+{
+	std::string query_data = market.empty() ? "" : "market=" + market;
+	return fetch_all_pages<std::unique_ptr<album_t>>(API_PREFIX "/me/albums", query_data, this->access_token, 50, saved_album_from_item, max_items);
+}
+
+visit_result_t Album_API::for_each_users_album(const std::function<bool(std::unique_ptr<album_t> album)> &visit, const std::string &market)
+{
+	std::string query_data = market.empty() ? "" : "market=" + market;
+	return visit_all_pages<std::unique_ptr<album_t>>(API_PREFIX "/me/albums", query_data, this->access_token, saved_album_from_item, visit, {50, 2});
 }
 
 void Album_API::save_albums_for_current_user(const std::vector<std::string> &album_ids)
@@ -332,4 +388,14 @@ page_t<std::unique_ptr<album_t>> Album_API::get_new_releases(uint32_t limit, uin
 	return new_releases;
 }
 
-} // namespace spotify_api
\ No newline at end of file
+all_pages_t<std::unique_ptr<album_t>> Album_API::get_all_new_releases(const std::string &country, size_t max_items)
+{
+	std::string query_data = country.empty() ? "" : "country=" + country;
+	// The page comes wrapped in {"albums"}
+	return fetch_all_pages<std::unique_ptr<album_t>>(API_PREFIX "/browse/new-releases", query_data, this->access_token, 50, [](const json::json &album)
+	{
+		return album_t::from_json(album);
+	}, max_items, "albums");
+}
+
+} // namespace spotify_api
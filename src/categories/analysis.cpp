@@ -0,0 +1,359 @@
+#include "categories/analysis.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <span>
+#include <string_view>
+
+namespace json = nlohmann;
+
+namespace spotify_api
+{
+
+using interval_columns_t = columnar_analysis_t::interval_columns_t;
+using section_columns_t = columnar_analysis_t::section_columns_t;
+using segment_columns_t = columnar_analysis_t::segment_columns_t;
+using vector_row_t = columnar_analysis_t::vector_row_t;
+
+template <class Columns>
+struct column_field_t
+{
+	std::string_view name;
+	std::vector<float> Columns::*column;
+};
+
+static constexpr column_field_t<interval_columns_t> interval_fields[] = {
+	{"start", &interval_columns_t::start},
+	{"duration", &interval_columns_t::duration},
+	{"confidence", &interval_columns_t::confidence},
+};
+
+static constexpr column_field_t<section_columns_t> section_fields[] = {
+	{"start", &section_columns_t::start},
+	{"duration", &section_columns_t::duration},
+	{"confidence", &section_columns_t::confidence},
+	{"loudness", &section_columns_t::loudness},
+	{"tempo", &section_columns_t::tempo},
+	{"tempo_confidence", &section_columns_t::tempo_confidence},
+	{"key", &section_columns_t::key},
+	{"key_confidence", &section_columns_t::key_confidence},
+	{"mode", &section_columns_t::mode},
+	{"mode_confidence", &section_columns_t::mode_confidence},
+	{"time_signature", &section_columns_t::time_signature},
+	{"time_signature_confidence", &section_columns_t::time_signature_confidence},
+};
+
+static constexpr column_field_t<segment_columns_t> segment_fields[] = {
+	{"start", &segment_columns_t::start},
+	{"duration", &segment_columns_t::duration},
+	{"confidence", &segment_columns_t::confidence},
+	{"loudness_start", &segment_columns_t::loudness_start},
+	{"loudness_max", &segment_columns_t::loudness_max},
+	{"loudness_max_time", &segment_columns_t::loudness_max_time},
+	{"loudness_end", &segment_columns_t::loudness_end},
+};
+
+static constexpr std::pair<std::string_view, double columnar_analysis_t::*> track_double_fields[] = {
+	{"duration", &columnar_analysis_t::duration},
+	{"loudness", &columnar_analysis_t::loudness},
+	{"tempo", &columnar_analysis_t::tempo},
+	{"tempo_confidence", &columnar_analysis_t::tempo_confidence},
+	{"key_confidence", &columnar_analysis_t::key_confidence},
+	{"mode_confidence", &columnar_analysis_t::mode_confidence},
+	{"time_signature_confidence", &columnar_analysis_t::time_signature_confidence},
+};
+
+static constexpr std::pair<std::string_view, int columnar_analysis_t::*> track_int_fields[] = {
+	{"key", &columnar_analysis_t::key},
+	{"mode", &columnar_analysis_t::mode},
+	{"time_signature", &columnar_analysis_t::time_signature},
+};
+
+static void set_track_field(columnar_analysis_t &analysis, std::string_view key, double value)
+{
+	for (const auto &field : track_double_fields)
+	{
+		if (field.first == key)
+		{
+			analysis.*field.second = value;
+			return;
+		}
+	}
+	for (const auto &field : track_int_fields)
+	{
+		if (field.first == key)
+		{
+			analysis.*field.second = static_cast<int>(value);
+			return;
+		}
+	}
+}
+
+template <class Columns>
+static std::vector<float> *find_column(Columns &columns, std::span<const column_field_t<Columns>> fields, std::string_view key)
+{
+	for (const auto &field : fields)
+	{
+		if (field.name == key) return &(columns.*field.column);
+	}
+	return nullptr;
+}
+
+template <class Columns>
+static void add_row(Columns &columns, std::span<const column_field_t<Columns>> fields)
+{
+	for (const auto &field : fields) (columns.*field.column).push_back(0.0f);
+}
+
+template <class Columns>
+static void reserve_rows(Columns &columns, std::span<const column_field_t<Columns>> fields, size_t count)
+{
+	for (const auto &field : fields) (columns.*field.column).reserve(count);
+}
+
+template <class Columns>
+static size_t columns_usage(const Columns &columns, std::span<const column_field_t<Columns>> fields)
+{
+	size_t bytes = 0;
+	for (const auto &field : fields) bytes += (columns.*field.column).capacity() * sizeof(float);
+	return bytes;
+}
+
+// Writes rows into whichever table a top-level key of the analysis refers to.
+// Exactly one of the pointers is set for a known table, none for anything else.
+struct table_writer_t
+{
+	interval_columns_t *intervals = nullptr;
+	section_columns_t *sections = nullptr;
+	segment_columns_t *segments = nullptr;
+
+	static table_writer_t for_key(columnar_analysis_t &analysis, std::string_view key)
+	{
+		table_writer_t writer;
+		if (key == "bars") writer.intervals = &analysis.bars;
+		else if (key == "beats") writer.intervals = &analysis.beats;
+		else if (key == "tatums") writer.intervals = &analysis.tatums;
+		else if (key == "sections") writer.sections = &analysis.sections;
+		else if (key == "segments") writer.segments = &analysis.segments;
+		return writer;
+	}
+
+	bool valid() const { return intervals || sections || segments; }
+
+	void reserve(size_t count) const
+	{
+		if (intervals) reserve_rows<interval_columns_t>(*intervals, interval_fields, count);
+		if (sections) reserve_rows<section_columns_t>(*sections, section_fields, count);
+		if (segments)
+		{
+			reserve_rows<segment_columns_t>(*segments, segment_fields, count);
+			segments->pitches.reserve(count);
+			segments->timbre.reserve(count);
+		}
+	}
+
+	void add_row() const
+	{
+		if (intervals) spotify_api::add_row<interval_columns_t>(*intervals, interval_fields);
+		if (sections) spotify_api::add_row<section_columns_t>(*sections, section_fields);
+		if (segments)
+		{
+			spotify_api::add_row<segment_columns_t>(*segments, segment_fields);
+			segments->pitches.emplace_back();
+			segments->timbre.emplace_back();
+		}
+	}
+
+	std::vector<float> *column(std::string_view key) const
+	{
+		if (intervals) return find_column<interval_columns_t>(*intervals, interval_fields, key);
+		if (sections) return find_column<section_columns_t>(*sections, section_fields, key);
+		if (segments) return find_column<segment_columns_t>(*segments, segment_fields, key);
+		return nullptr;
+	}
+
+	// The 12 value row of the current segment for "pitches" or "timbre"
+	vector_row_t *vector(std::string_view key) const
+	{
+		if (!segments) return nullptr;
+		if (key == "pitches") return &segments->pitches.back();
+		if (key == "timbre") return &segments->timbre.back();
+		return nullptr;
+	}
+};
+
+namespace
+{
+
+// SAX handler for nlohmann::json::sax_parse.
+// Depth 1 is the root object, 2 the top-level arrays and the "track" object,
+// 3 the rows of each table and 4 the pitch and timbre arrays of a segment.
+class analysis_sax_t
+{
+	public:
+	explicit analysis_sax_t(columnar_analysis_t &analysis): _analysis(analysis) {}
+
+	bool null() { return true; }
+	bool boolean(bool) { return true; }
+	bool number_integer(json::json::number_integer_t value) { return this->number(static_cast<double>(value)); }
+	bool number_unsigned(json::json::number_unsigned_t value) { return this->number(static_cast<double>(value)); }
+	bool number_float(json::json::number_float_t value, const json::json::string_t &) { return this->number(value); }
+	bool string(json::json::string_t &) { return true; }
+	bool binary(json::json::binary_t &) { return true; }
+
+	bool start_object(size_t)
+	{
+		this->_depth++;
+		if (this->_depth == 2) this->_in_track = this->_key == "track";
+		else if (this->_depth == 3 && this->_table.valid()) this->_table.add_row();
+		return true;
+	}
+
+	bool end_object()
+	{
+		if (this->_depth == 2) this->_in_track = false;
+		this->_column = nullptr;
+		this->_vector = nullptr;
+		this->_depth--;
+		return true;
+	}
+
+	bool start_array(size_t)
+	{
+		this->_depth++;
+		if (this->_depth == 2) this->_table = table_writer_t::for_key(this->_analysis, this->_key);
+		else if (this->_depth == 4) this->_vector_index = 0;
+		return true;
+	}
+
+	bool end_array()
+	{
+		if (this->_depth == 2) this->_table = table_writer_t();
+		else if (this->_depth == 4) this->_vector = nullptr;
+		this->_depth--;
+		return true;
+	}
+
+	bool key(json::json::string_t &key)
+	{
+		if (this->_depth == 1 || (this->_depth == 2 && this->_in_track))
+		{
+			this->_key = key;
+		}
+		else if (this->_depth == 3 && this->_table.valid())
+		{
+			this->_column = this->_table.column(key);
+			this->_vector = this->_column ? nullptr : this->_table.vector(key);
+		}
+		return true;
+	}
+
+	bool parse_error(size_t, const std::string &, const json::detail::exception &) { return false; }
+
+	private:
+	bool number(double value)
+	{
+		if (this->_depth == 2 && this->_in_track)
+		{
+			set_track_field(this->_analysis, this->_key, value);
+		}
+		else if (this->_depth == 3 && this->_column)
+		{
+			this->_column->back() = static_cast<float>(value);
+			this->_column = nullptr;
+		}
+		else if (this->_depth == 4 && this->_vector && this->_vector_index < columnar_analysis_t::vector_size)
+		{
+			(*this->_vector)[this->_vector_index++] = static_cast<float>(value);
+		}
+		return true;
+	}
+
+	columnar_analysis_t &_analysis;
+	table_writer_t _table;
+	int _depth = 0;
+	bool _in_track = false;
+	std::string _key;
+	std::vector<float> *_column = nullptr;
+	vector_row_t *_vector = nullptr;
+	size_t _vector_index = 0;
+};
+
+} // namespace
+
+
+size_t columnar_analysis_t::memory_usage() const
+{
+	size_t bytes = sizeof(columnar_analysis_t);
+	bytes += columns_usage<interval_columns_t>(this->bars, interval_fields);
+	bytes += columns_usage<interval_columns_t>(this->beats, interval_fields);
+	bytes += columns_usage<interval_columns_t>(this->tatums, interval_fields);
+	bytes += columns_usage<section_columns_t>(this->sections, section_fields);
+	bytes += columns_usage<segment_columns_t>(this->segments, segment_fields);
+	bytes += (this->segments.pitches.capacity() + this->segments.timbre.capacity()) * sizeof(vector_row_t);
+	return bytes;
+}
+
+std::unique_ptr<columnar_analysis_t> columnar_analysis_t::from_json(const std::string &json_string)
+{
+	auto analysis = std::make_unique<columnar_analysis_t>();
+	analysis_sax_t handler(*analysis);
+	if (!json::json::sax_parse(json_string, &handler))
+	{
+		std::cerr << "Failed to parse the audio analysis" << std::endl;
+		return std::unique_ptr<columnar_analysis_t>(nullptr);
+	}
+	return analysis;
+}
+
+std::unique_ptr<columnar_analysis_t> columnar_analysis_t::from_json(const json::json &json_obj)
+{
+	auto analysis = std::make_unique<columnar_analysis_t>();
+	if (!json_obj.is_object()) return analysis;
+
+	for (auto item = json_obj.begin(); item != json_obj.end(); ++item)
+	{
+		const json::json &value = item.value();
+		if (item.key() == "track" && value.is_object())
+		{
+			for (auto field = value.begin(); field != value.end(); ++field)
+			{
+				if (field.value().is_number()) set_track_field(*analysis, field.key(), field.value().get<double>());
+			}
+			continue;
+		}
+
+		table_writer_t table = table_writer_t::for_key(*analysis, item.key());
+		if (!table.valid() || !value.is_array()) continue;
+
+		table.reserve(value.size());
+		for (auto row = value.begin(); row != value.end(); ++row)
+		{
+			table.add_row();
+			if (!row.value().is_object()) continue;
+
+			for (auto field = row.value().begin(); field != row.value().end(); ++field)
+			{
+				const json::json &field_value = field.value();
+				if (field_value.is_number())
+				{
+					std::vector<float> *column = table.column(field.key());
+					if (column) column->back() = field_value.get<float>();
+				}
+				else if (field_value.is_array())
+				{
+					vector_row_t *vector = table.vector(field.key());
+					if (!vector) continue;
+					size_t count = std::min(field_value.size(), vector_size);
+					for (size_t i = 0; i < count; i++)
+					{
+						if (field_value[i].is_number()) (*vector)[i] = field_value[i].get<float>();
+					}
+				}
+			}
+		}
+	}
+	return analysis;
+}
+
+} // namespace spotify_api
@@ -2,6 +2,8 @@
 #include <unordered_set>
 #include "categories/artists.hpp"
 #include "endpoints/artists.hpp"
+#include "categories/ids.hpp"
+#include "entity-store.hpp"
 
 #include <nlohmann/json.hpp>
 
@@ -17,112 +19,155 @@ std::unique_ptr<artist_t> artist_t::from_json(const std::string &json_string)
 	return from_json(json::json::parse(json_string));
 }
 
-std::unique_ptr<artist_t> artist_t::from_json(const json::json &json_obj)
+// Shared by every variant of artist_t::from_json.
+static bool parse_artist(artist_t &output, const json::json &json_obj)
 {
-	auto output = std::make_unique<artist_t>();
 	try
 	{
-		auto url_obj = json_obj["external_urls"];
-		for (auto url = url_obj.begin(); url != url_obj.end(); ++url)
+		if (json_obj.contains("followers"))
 		{
-			output->external_urls.emplace(url.key(), url.value());
+			output.followers.href = json_obj["followers"].value("href", "");
+			output.followers.total = json_obj["followers"]["total"];
 		}
 
-		if (json_obj.contains("followers"))
+		// Simplified artist objects have no genres or images, so look them up instead of copying a default array.
+		if (json_obj.contains("genres"))
 		{
-			output->followers.href = json_obj["followers"].value("href", "");
-			output->followers.total = json_obj["followers"]["total"];
+			const json::json &genre_array = json_obj["genres"];
+			output.genres.reserve(genre_array.size());
+			for (auto genre = genre_array.begin(); genre != genre_array.end(); ++genre)
+			{
+				output.genres.push_back(interned_string_t::from_json(genre.value()));
+			}
 		}
 
-		auto genre_array = json_obj.value("genres", json::json::array());
-		output->genres.reserve(genre_array.size());
-		for (auto genre = genre_array.begin(); genre != genre_array.end(); ++genre)
+		output.id = json_obj["id"];
+#ifdef SPOTIFY_API_COMPACT_LINKS
+		output.links = entity_links_t::from_json(json_obj, artist_t::type, output.id);
+#else
+		const json::json &url_obj = json_obj["external_urls"];
+		for (auto url = url_obj.begin(); url != url_obj.end(); ++url)
 		{
-			output->genres.push_back(genre.value());
+			output.external_urls.emplace(url.key(), url.value());
 		}
-		output->genres.shrink_to_fit();
 
-		output->href = json_obj["href"];
-		output->id = json_obj["id"];
+		output.href = json_obj["href"];
+		output.uri = json_obj["uri"];
+#endif
 
-		auto image_array = json_obj.value("images", json::json::array());
-		for (auto image = image_array.begin(); image != image_array.end(); ++image)
+		if (json_obj.contains("images"))
 		{
-			output->images.push_back(image_t::from_json(image.value().dump()));
+			const json::json &image_array = json_obj["images"];
+			output.images.reserve(image_array.size());
+			for (auto image = image_array.begin(); image != image_array.end(); ++image)
+			{
+				output.images.push_back(image_t::from_json(image.value()));
+			}
 		}
-		output->images.shrink_to_fit();
 
-		output->name = json_obj["name"];
-		output->popularity = json_obj.value("popularity", 0);
-		output->uri = json_obj["uri"];
+		output.name = interned_string_t::from_json(json_obj["name"]);
+		output.popularity = json_obj.value("popularity", 0);
 	}
 	catch (const std::exception &e)
 	{
 		std::cerr << e.what() << '\n';
 		fprintf(stderr, "\033[31mspotify-api/artist.cpp: object_from_json(): Error: Failed to convert json data to artist.\nJson string: %s\n\n\033[39m", json_obj.dump().c_str());
-		return std::unique_ptr<artist_t>(nullptr);
+		return false;
 	}
+	return true;
+}
+
+std::unique_ptr<artist_t> artist_t::from_json(const json::json &json_obj)
+{
+	auto output = std::make_unique<artist_t>();
+	if (!parse_artist(*output, json_obj)) return std::unique_ptr<artist_t>(nullptr);
+	return output;
+}
+
+std::shared_ptr<artist_t> artist_t::from_json(const json::json &json_obj, const decode_context_t &context)
+{
+	if (context.store)
+	{
+		auto stored = context.store->lookup<artist_t>(json_obj);
+		if (stored) return stored;
+	}
+
+	auto output = make_entity<artist_t>(context.resource);
+	if (!parse_artist(*output, json_obj)) return std::shared_ptr<artist_t>(nullptr);
+
+	if (context.store) return context.store->insert(std::move(output), json_obj);
 	return output;
 }
 
 std::unique_ptr<artist_t> Artist_API::get_artist(const std::string &artist_id)
 {
+	entity_cache_t<artist_t>::key_t key;
+	bool cacheable = this->cache && entity_cache_t<artist_t>::make_key(artist_id, "", key);
+	if (cacheable)
+	{
+		if (auto cached = this->cache->find(key)) return std::make_unique<artist_t>(*cached);
+	}
+
 	const std::string url = API_PREFIX "/artists/" + artist_id;
 	auto response = http::get(url.c_str(), std::string(), this->access_token);
 
 	if (response.code != 200) return std::unique_ptr<artist_t>(nullptr);
-	return artist_t::from_json(response.body);
+
+	auto artist = artist_t::from_json(response.body);
+	if (cacheable && artist) this->cache->insert(key, std::make_shared<const artist_t>(*artist));
+	return artist;
 }
 
 std::vector<std::unique_ptr<artist_t>> Artist_API::get_artists(const std::vector<std::string> &artist_ids)
 {
-	std::vector<std::string> truncated_ids = truncate_spotify_uris(artist_ids, 50);
-	std::ostringstream query_data;
-	for (size_t i = 0; i < truncated_ids.size(); i++)
+	// Duplicates are kept, and invalid IDs get a null, so that the output lines up with the requested IDs.
+	normalized_ids_t ids = normalize_spotify_ids(artist_ids, false);
+
+	return align_to_inputs(entity_cache_t<artist_t>::get_many(this->cache.get(), ids.ids, -1, 50, [&](std::span<const spotify_id_t> batch)
 	{
-		query_data << truncated_ids[i];
-		if (i < truncated_ids.size() - 1)
+		std::string query_data = "ids=" + join_spotify_ids(std::vector<spotify_id_t>(batch.begin(), batch.end()));
+		auto response = http::get(API_PREFIX "/artists", query_data, this->access_token);
+
+		std::vector<std::unique_ptr<artist_t>> artists;
+		if (is_retryable_status(response.code)) throw batch_retry_t(response.code);
+		if (response.code != 200) return artists;
+
+		json::json artists_array = json::json::parse(response.body)["artists"];
+		for (auto artist = artists_array.begin(); artist != artists_array.end(); ++artist)
 		{
-			query_data << "\%2C"; // url-encoded comma
+			artists.push_back(artist.value().is_null() ? std::unique_ptr<artist_t>(nullptr) : artist_t::from_json(artist.value()));
 		}
-	}
+		return artists;
+	}), ids);
+}
 
-	auto response = http::get(API_PREFIX "/artists", query_data.str(), this->access_token);
-	std::vector<std::unique_ptr<artist_t>> artists;
-	if (response.code != 200) return artists;
 
-	json::json artists_array = json::json::parse(response.body)["artists"];
-	for (auto artist = artists_array.begin(); artist != artists_array.end(); ++artist)
+/// Keeps the allowed album groups, without duplicates, joined with url-encoded commas
+static std::string album_groups_query(const std::vector<std::string> &include_groups)
+{
+	const std::unordered_set<std::string> album_types = {"single", "compilation", "appears_on", "album"};
+	std::unordered_set<std::string> included_types = {};
+
+	std::string groups_string;
+	for (const std::string &group : include_groups)
 	{
-		artists.push_back(artist_t::from_json(artist.value().dump()));
+		if (!album_types.count(group) || !included_types.emplace(group).second) continue;
+		if (!groups_string.empty()) groups_string += "\%2C";
+		groups_string += group;
 	}
-	return artists;
+	return groups_string;
 }
 
-
 page_t<std::unique_ptr<album_t>> Artist_API::get_albums_from_artist(const std::string &artist_id, std::vector<std::string> &include_groups, std::string &market, uint8_t limit, uint32_t offset)
 {
-	const std::unordered_set<std::string> album_types = {"single", "compilation", "appears_on", "album"};
-	std::unordered_set<std::string> included_types = {};
 	std::ostringstream url, query_data;
 	url << API_PREFIX << "/artists/" << truncate_spotify_uri(artist_id) << "/albums";
 
-	// Filter the included groups to only include allowed values and remove duplicates.
-	std::string groups_string;
-	for (size_t i = 0; i < include_groups.size(); ++i)
-	{
-		if (!album_types.count(include_groups[i]) || included_types.count(include_groups[i])) continue;
-		groups_string += include_groups[i] + "\%2C";
-		included_types.emplace(groups_string);
-	}
-	// If the user specified any groups, then remove the trailing comma added by the above for-loop
-	if (groups_string != "") {
-		groups_string = groups_string.substr(0, groups_string.length() - 3);
-	}
 	if (limit > 50) limit = 50;
 
-	query_data << "include_groups=" << groups_string << "&limit=" << limit << "&offset=" << offset << "&market=" << market.substr(0, 2);
-	auto response = http::get(url.str().c_str(), std::string(), this->access_token);
+	// The limit is a uint8_t, which a stream would print as a character
+	query_data << "include_groups=" << album_groups_query(include_groups) << "&limit=" << static_cast<unsigned int>(limit) << "&offset=" << offset << "&market=" << market.substr(0, 2);
+	auto response = http::get(url.str().c_str(), query_data.str(), this->access_token);
 
 	page_t<std::unique_ptr<album_t>> albums;
 	if (response.code != 200) return albums;
@@ -131,6 +176,21 @@ page_t<std::unique_ptr<album_t>> Artist_API::get_albums_from_artist(const std::s
 	return decltype(albums)::from_json(albums_page.dump());
 }
 
+all_pages_t<std::unique_ptr<album_t>> Artist_API::get_all_albums_from_artist(const std::string &artist_id, const std::vector<std::string> &include_groups, const std::string &market)
+{
+	std::string url = API_PREFIX "/artists/" + truncate_spotify_uri(artist_id) + "/albums";
+
+	std::string query_data;
+	std::string groups = album_groups_query(include_groups);
+	if (!groups.empty()) query_data = "include_groups=" + groups;
+	if (!market.empty()) query_data += (query_data.empty() ? "market=" : "&market=") + market.substr(0, 2);
+
+	return fetch_all_pages<std::unique_ptr<album_t>>(url, query_data, this->access_token, 50, [](const json::json &album)
+	{
+		return album_t::from_json(album);
+	});
+}
+
 std::vector<std::unique_ptr<track_t>> Artist_API::get_artist_top_tracks(const std::string &artist_id, const std::string &market)
 {
 	std::ostringstream url;
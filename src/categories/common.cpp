@@ -1,4 +1,5 @@
 #include "categories/common.hpp"
+#include "categories/ids.hpp"
 
 #include <nlohmann/json.hpp>
 
@@ -26,24 +27,126 @@ image_t image_t::from_json(const json::json &json_object)
 	return new_image;
 }
 
+static constexpr std::string_view href_prefix = API_PREFIX "/";
+static constexpr std::string_view uri_prefix = "spotify:";
+static constexpr std::string_view spotify_url_prefix = "https://open.spotify.com/";
+
+// Checks whether `value` is exactly the concatenation of `parts` without building the concatenated string.
+static bool matches_parts(std::string_view value, std::initializer_list<std::string_view> parts)
+{
+	for (std::string_view part : parts)
+	{
+		if (!value.starts_with(part)) return false;
+		value.remove_prefix(part.size());
+	}
+	return value.empty();
+}
+
+std::string entity_links_t::canonical_href(std::string_view type, std::string_view id)
+{
+	std::string href;
+	href.reserve(href_prefix.size() + type.size() + 2 + id.size());
+	href.append(href_prefix).append(type).append("s/").append(id);
+	return href;
+}
+
+std::string entity_links_t::canonical_uri(std::string_view type, std::string_view id)
+{
+	std::string uri;
+	uri.reserve(uri_prefix.size() + type.size() + 1 + id.size());
+	uri.append(uri_prefix).append(type).append(":").append(id);
+	return uri;
+}
+
+std::string entity_links_t::canonical_spotify_url(std::string_view type, std::string_view id)
+{
+	std::string url;
+	url.reserve(spotify_url_prefix.size() + type.size() + 1 + id.size());
+	url.append(spotify_url_prefix).append(type).append("/").append(id);
+	return url;
+}
+
+std::string entity_links_t::href(std::string_view type, std::string_view id) const
+{
+	if (this->_fallback && this->_fallback->href) return *this->_fallback->href;
+	return canonical_href(type, id);
+}
+
+std::string entity_links_t::uri(std::string_view type, std::string_view id) const
+{
+	if (this->_fallback && this->_fallback->uri) return *this->_fallback->uri;
+	return canonical_uri(type, id);
+}
+
+std::map<std::string, std::string> entity_links_t::external_urls(std::string_view type, std::string_view id) const
+{
+	if (this->_fallback && this->_fallback->external_urls) return *this->_fallback->external_urls;
+	return {{"spotify", canonical_spotify_url(type, id)}};
+}
+
+entity_links_t entity_links_t::from_json(const json::json &json_object, std::string_view type, std::string_view id)
+{
+	entity_links_t links;
+	fallback_t fallback;
+	bool needs_fallback = false;
+
+	// Missing or null values are kept as empty strings rather than being made up from the id.
+	auto string_member = [&json_object](const char *key) -> std::string_view {
+		auto member = json_object.find(key);
+		if (member == json_object.end() || !member->is_string()) return std::string_view();
+		return member->get_ref<const std::string &>();
+	};
+
+	std::string_view href = string_member("href");
+	if (!matches_parts(href, {href_prefix, type, "s/", id}))
+	{
+		fallback.href.emplace(href);
+		needs_fallback = true;
+	}
+
+	std::string_view uri = string_member("uri");
+	if (!matches_parts(uri, {uri_prefix, type, ":", id}))
+	{
+		fallback.uri.emplace(uri);
+		needs_fallback = true;
+	}
+
+	auto urls = json_object.find("external_urls");
+	bool canonical_urls = urls != json_object.end() && urls->is_object() && urls->size() == 1
+		&& urls->contains("spotify") && (*urls)["spotify"].is_string()
+		&& matches_parts((*urls)["spotify"].get_ref<const std::string &>(), {spotify_url_prefix, type, "/", id});
+	if (!canonical_urls)
+	{
+		fallback.external_urls.emplace();
+		if (urls != json_object.end() && urls->is_object())
+		{
+			for (auto url = urls->begin(); url != urls->end(); ++url)
+			{
+				if (url.value().is_string()) fallback.external_urls->emplace(url.key(), url.value().get<std::string>());
+			}
+		}
+		needs_fallback = true;
+	}
+
+	if (needs_fallback) links._fallback = std::make_shared<const fallback_t>(std::move(fallback));
+	return links;
+}
+
 std::string truncate_spotify_uri(const std::string &full_id)
 {
-	size_t id_start = full_id.find_last_of(':');
-	return id_start != std::string::npos ? full_id.substr(id_start + 1) : full_id;
+	return std::string(extract_spotify_id(full_id));
 }
 
 std::vector<std::string> truncate_spotify_uris(const std::vector<std::string> &full_ids, size_t limit)
 {
-	std::vector<std::string> truncated_ids;
+	size_t count = (limit && limit < full_ids.size()) ? limit : full_ids.size();
 
-	int i = 0;
+	std::vector<std::string> truncated_ids;
+	truncated_ids.reserve(count);
 
-	for (std::string id : full_ids)
+	for (size_t i = 0; i < count; i++)
 	{
-		if (limit && i == limit) break;
-		size_t id_start = id.find_last_of(':');
-		truncated_ids.push_back(id_start != std::string::npos ? id.substr(id_start + 1) : id);
-		i++;
+		truncated_ids.emplace_back(extract_spotify_id(full_ids[i]));
 	}
 
 	return truncated_ids;
@@ -28,17 +28,22 @@ std::unique_ptr<episode_t> episode_t::from_json(const nlohmann::json &json_objec
 	output->duration_ms = json_object["duration_ms"];
 	output->is_explicit = json_object["explicit"];
 	
-	json::json temp_obj = json_object["external_urls"];
+	output->id = json_object["id"];
+#ifdef SPOTIFY_API_COMPACT_LINKS
+	output->links = entity_links_t::from_json(json_object, type, output->id);
+#else
+	const json::json &external_urls = json_object["external_urls"];
 
-	for (auto i = temp_obj.begin(); i != temp_obj.end(); ++i)
+	for (auto i = external_urls.begin(); i != external_urls.end(); ++i)
 	{
 		output->external_urls.emplace(i.key(), i.value());
 	}
-	
+
 	output->href = json_object["href"];
-	output->id = json_object["id"];
+	output->uri = json_object["uri"];
+#endif
 
-	temp_obj = json_object["images"];
+	json::json temp_obj = json_object["images"];
 
 	for (auto i = temp_obj.begin(); i != temp_obj.end(); ++i)
 	{
@@ -74,8 +79,6 @@ std::unique_ptr<episode_t> episode_t::from_json(const nlohmann::json &json_objec
 
 	output->show = show_t::from_json(json_object["show"]);
 
-	output->uri = json_object["uri"];
-
 	return output;
 }
 }
@@ -0,0 +1,164 @@
+#include "categories/ids.hpp"
+
+#include <unordered_map>
+
+namespace spotify_api
+{
+
+// 62^10 is the largest power of 62 that fits in 64 bits, which lets
+// encoding work on 64-bit chunks after two 128-bit divisions.
+static constexpr uint64_t base62_chunk = 839299365868340224ULL;
+static constexpr size_t base62_chunk_digits = 10;
+
+static constexpr std::array<int8_t, 256> base62_digits = [] {
+	std::array<int8_t, 256> table{};
+	for (auto &digit : table) digit = -1;
+	for (size_t i = 0; i < spotify_id_t::alphabet.size(); i++)
+	{
+		table[static_cast<unsigned char>(spotify_id_t::alphabet[i])] = static_cast<int8_t>(i);
+	}
+	return table;
+}();
+
+std::optional<spotify_id_t> spotify_id_t::from_base62(std::string_view id)
+{
+	if (id.size() != encoded_length) return std::nullopt;
+
+	// Not every 22 character string fits in 128 bits, so the value is
+	// built in two halves and checked for overflow before combining them.
+	// The first 12 characters are at most 62^12 - 1 (< 2^72) and the last 10 are below 62^10.
+	unsigned __int128 value = 0;
+	for (size_t i = 0; i < encoded_length - base62_chunk_digits; i++)
+	{
+		int digit = base62_digits[static_cast<unsigned char>(id[i])];
+		if (digit < 0) return std::nullopt;
+		value = value * 62 + digit;
+	}
+
+	uint64_t low_chunk = 0;
+	for (size_t i = encoded_length - base62_chunk_digits; i < encoded_length; i++)
+	{
+		int digit = base62_digits[static_cast<unsigned char>(id[i])];
+		if (digit < 0) return std::nullopt;
+		low_chunk = low_chunk * 62 + digit;
+	}
+
+	constexpr unsigned __int128 max_value = ~static_cast<unsigned __int128>(0);
+	if (value > (max_value - low_chunk) / base62_chunk) return std::nullopt;
+	value = value * base62_chunk + low_chunk;
+
+	return spotify_id_t(static_cast<uint64_t>(value >> 64), static_cast<uint64_t>(value));
+}
+
+std::optional<spotify_id_t> spotify_id_t::parse(std::string_view id_or_uri)
+{
+	return from_base62(extract_spotify_id(id_or_uri));
+}
+
+static inline void write_chunk(char *last, uint64_t chunk, size_t digits)
+{
+	for (size_t i = 0; i < digits; i++)
+	{
+		*--last = spotify_id_t::alphabet[chunk % 62];
+		chunk /= 62;
+	}
+}
+
+char *spotify_id_t::to_chars(char *first) const
+{
+	unsigned __int128 value = (static_cast<unsigned __int128>(this->_high) << 64) | this->_low;
+
+	uint64_t low_chunk = static_cast<uint64_t>(value % base62_chunk);
+	value /= base62_chunk;
+	uint64_t middle_chunk = static_cast<uint64_t>(value % base62_chunk);
+	uint64_t high_chunk = static_cast<uint64_t>(value / base62_chunk);
+
+	char *last = first + encoded_length;
+	write_chunk(last, low_chunk, base62_chunk_digits);
+	write_chunk(last - base62_chunk_digits, middle_chunk, base62_chunk_digits);
+	write_chunk(last - 2 * base62_chunk_digits, high_chunk, encoded_length - 2 * base62_chunk_digits);
+	return last;
+}
+
+std::string spotify_id_t::to_string() const
+{
+	std::string output(encoded_length, '0');
+	this->to_chars(output.data());
+	return output;
+}
+
+std::string_view extract_spotify_id(std::string_view id_or_uri)
+{
+	size_t query_start = id_or_uri.find_first_of("?#");
+	if (query_start != std::string_view::npos) id_or_uri = id_or_uri.substr(0, query_start);
+	while (!id_or_uri.empty() && id_or_uri.back() == '/') id_or_uri.remove_suffix(1);
+
+	size_t id_start = id_or_uri.find_last_of(":/");
+	return id_start != std::string_view::npos ? id_or_uri.substr(id_start + 1) : id_or_uri;
+}
+
+template <typename String_Range>
+static normalized_ids_t normalize_ids(const String_Range &ids_or_uris, bool dedup)
+{
+	normalized_ids_t output;
+	output.ids.reserve(ids_or_uris.size());
+	output.positions.reserve(ids_or_uris.size());
+
+	std::unordered_map<spotify_id_t, int64_t> seen;
+	if (dedup) seen.reserve(ids_or_uris.size());
+
+	for (const auto &input : ids_or_uris)
+	{
+		std::optional<spotify_id_t> id = spotify_id_t::parse(input);
+		if (!id)
+		{
+			output.positions.push_back(-1);
+			output.invalid_count++;
+			continue;
+		}
+
+		if (dedup)
+		{
+			auto inserted = seen.try_emplace(*id, static_cast<int64_t>(output.ids.size()));
+			if (!inserted.second)
+			{
+				output.positions.push_back(inserted.first->second);
+				output.duplicate_count++;
+				continue;
+			}
+		}
+
+		output.positions.push_back(static_cast<int64_t>(output.ids.size()));
+		output.ids.push_back(*id);
+	}
+
+	return output;
+}
+
+normalized_ids_t normalize_spotify_ids(const std::vector<std::string> &ids_or_uris, bool dedup)
+{
+	return normalize_ids(ids_or_uris, dedup);
+}
+
+normalized_ids_t normalize_spotify_ids(std::span<const std::string_view> ids_or_uris, bool dedup)
+{
+	return normalize_ids(ids_or_uris, dedup);
+}
+
+std::string join_spotify_ids(const std::vector<spotify_id_t> &ids, std::string_view separator, size_t first, size_t count)
+{
+	if (first >= ids.size()) return std::string();
+	size_t last = (count >= ids.size() - first) ? ids.size() : first + count;
+
+	// Every ID has the same length, so the output can be sized exactly up front.
+	std::string output((last - first) * (spotify_id_t::encoded_length + separator.size()) - separator.size(), '\0');
+	char *cursor = output.data();
+	for (size_t i = first; i < last; i++)
+	{
+		if (i != first) cursor += separator.copy(cursor, separator.size());
+		cursor = ids[i].to_chars(cursor);
+	}
+	return output;
+}
+
+} // namespace spotify_api
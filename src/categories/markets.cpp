@@ -0,0 +1,32 @@
+#include "categories/markets.hpp"
+
+namespace json = nlohmann;
+
+namespace spotify_api
+{
+
+std::vector<std::string> market_set_t::to_vector() const
+{
+	std::vector<std::string> markets;
+	markets.reserve(this->size());
+	this->for_each([&markets](std::string_view market) {
+		markets.emplace_back(market);
+	});
+	return markets;
+}
+
+market_set_t market_set_t::from_json(const json::json &json_array)
+{
+	market_set_t markets;
+	if (!json_array.is_array()) return markets;
+
+	for (auto market = json_array.begin(); market != json_array.end(); ++market)
+	{
+		// Reading the string in place avoids copying every code into a temporary std::string
+		const std::string *code = market.value().get_ptr<const std::string *>();
+		if (code != nullptr) markets.insert(*code);
+	}
+	return markets;
+}
+
+} // namespace spotify_api
@@ -24,7 +24,7 @@ std::unique_ptr<playback_device_t> playback_device_t::from_json(const json::json
 		device->is_private_session = json_obj["is_private_session"];
 		device->is_restricted = json_obj["is_restricted"];
 		device->name = json_obj["name"];
-		device->type = json_obj["type"];
+		device->type = interned_string_t::from_json(json_obj["type"]);
 		device->volume_percent = json_obj.value("volume_percent", -1);
 	}
 	catch(const std::exception& e)
@@ -102,7 +102,7 @@ std::unique_ptr<playback_state_t> playback_state_t::from_json(const json::json &
 	try
 	{
 		state->actions = context_actions_t::from_json(json_obj["actions"]);
-		if (!json_obj["context"].is_null())
+		if (json_obj["context"].is_null())
 		{
 			state->context.reset();
 		}
@@ -113,9 +113,11 @@ std::unique_ptr<playback_state_t> playback_state_t::from_json(const json::json &
 		state->currently_playing_type = json_obj["currently_playing_type"];
 		state->device = playback_device_t::from_json(json_obj["device"]);
 		state->is_playing = json_obj["is_playing"];
-		state->item = track_t::from_json(json_obj["item"]);
-		state->progress_ms = json_obj["progress_ms"];
-		state->repeat_state = json_obj["repeate_state"];
+		// The item is null during ads and for episodes
+		if (json_obj["item"].is_object() && json_obj["item"].value("type", "") == "track")
+			state->item = track_t::from_json(json_obj["item"]);
+		state->progress_ms = json_obj["progress_ms"].is_number() ? json_obj["progress_ms"].get<int>() : 0;
+		state->repeat_state = json_obj["repeat_state"];
 		state->shuffle_state = json_obj["shuffle_state"];
 		state->timestamp = json_obj["timestamp"];
 	}
@@ -187,7 +189,9 @@ std::unique_ptr<track_history_t> track_history_t::from_json(const json::json &js
 	auto track_history = std::make_unique<track_history_t>();
 
 	track_history->played_at = json_obj["played_at"];
-	track_history->context = context_t::from_json(json_obj["context"]);
+	// Plays outside of an album, artist or playlist have a null context
+	if (json_obj.contains("context") && json_obj["context"].is_object())
+		track_history->context = context_t::from_json(json_obj["context"]);
 	track_history->track = track_t::from_json(json_obj["track"]);
 
 	return track_history;
@@ -199,17 +203,30 @@ std::unique_ptr<recent_tracks_t> recent_tracks_t::from_json(const std::string &j
 	return from_json(json::json::parse(json_string));
 }
 
+// Cursors are unix times in milliseconds, sent as strings, or null when there are no items
+static int64_t cursor_from_json(const json::json &cursors, const char *key)
+{
+	if (!cursors.contains(key)) return -1;
+	const json::json &cursor = cursors[key];
+	if (cursor.is_number()) return cursor.get<int64_t>();
+	if (cursor.is_string()) return std::stoll(cursor.get<std::string>());
+	return -1;
+}
+
 std::unique_ptr<recent_tracks_t> recent_tracks_t::from_json(const json::json &json_obj)
 {
 	auto recent_tracks = std::make_unique<recent_tracks_t>();
 	try
 	{
 		recent_tracks->href = json_obj["href"];
-		recent_tracks->cursor.before = json_obj["cursor"].value("before", -1);
-		recent_tracks->cursor.after = json_obj["cursor"].value("after", -1);
+		if (json_obj.contains("cursors") && json_obj["cursors"].is_object())
+		{
+			recent_tracks->cursor.before = cursor_from_json(json_obj["cursors"], "before");
+			recent_tracks->cursor.after = cursor_from_json(json_obj["cursors"], "after");
+		}
 		recent_tracks->limit = json_obj["limit"];
-		recent_tracks->next = json_obj.value("next", "");
-		recent_tracks->total = json_obj["total"];
+		recent_tracks->next = json_get_nullable(json_obj["next"], "");
+		recent_tracks->total = json_obj.value("total", 0);
 
 		for (auto item = json_obj["items"].begin(); item != json_obj["items"].end(); ++item)
 		{
@@ -265,64 +282,103 @@ std::unique_ptr<track_t> Player_API::get_currently_playing_track()
 	return track_t::from_json(response.body);
 }
 
-void Player_API::start_or_resume_playback(const std::string &context_uri, const std::vector<std::string> &uris, int offset, int position_ms)
+// Appends the device_id parameter to a player URL, for commands that target a device other than the active one
+static void append_device_id(std::string &url, const std::string &device_id)
+{
+	if (device_id.empty()) return;
+	url += url.find('?') == std::string::npos ? "?device_id=" : "&device_id=";
+	url += http::url_encode(device_id);
+}
+
+// Player commands answer with 204, and some of them with 200
+static bool command_succeeded(const http::api_response &response)
+{
+	return response.code == 204 || response.code == 200;
+}
+
+bool Player_API::start_or_resume_playback(const std::string &context_uri, const std::vector<std::string> &uris, int offset, int position_ms, const std::string &device_id)
 {
 	json::json put_data;
-	if (context_uri != "") put_data["context_uri"] = context_uri;
+	if (context_uri != "")
+	{
+		put_data["context_uri"] = context_uri;
+		if (offset > 0) put_data["offset"] = {{"position", offset}};
+	}
 	if (uris.size() > 0) put_data["uris"] = uris;
 	put_data["position_ms"] = position_ms;
 
-	auto response = http::request(API_PREFIX "/me/player/play", http::REQUEST_METHOD::METHOD_PUT, put_data.dump(), this->access_token, true);
-	std::cout << "Code: " << response.code << "\nBody: " << response.body << std::endl;
+	std::string url = API_PREFIX "/me/player/play";
+	append_device_id(url, device_id);
+	return command_succeeded(http::request(url.c_str(), http::REQUEST_METHOD::METHOD_PUT, put_data.dump(), this->access_token, true));
 }
 
-void Player_API::pause_playback()
+bool Player_API::pause_playback(const std::string &device_id)
 {
-	http::request(API_PREFIX "/me/player/pause", http::REQUEST_METHOD::METHOD_PUT, std::string(), this->access_token, true);
+	std::string url = API_PREFIX "/me/player/pause";
+	append_device_id(url, device_id);
+	return command_succeeded(http::request(url.c_str(), http::REQUEST_METHOD::METHOD_PUT, std::string(), this->access_token, true));
 }
 
-void Player_API::seek_to_position(int position_ms)
+bool Player_API::skip_to_previous(const std::string &device_id)
 {
-	json::json put_data = {{"position_ms", position_ms}};
-	http::request(API_PREFIX "/me/player/seek", http::REQUEST_METHOD::METHOD_PUT, put_data.dump(), this->access_token, true);
+	std::string url = API_PREFIX "/me/player/previous";
+	append_device_id(url, device_id);
+	return command_succeeded(http::post(url.c_str(), std::string(), this->access_token, true));
 }
 
-void Player_API::set_repeat_mode(Player_API::REPEAT_MODE state)
+bool Player_API::skip_to_next(const std::string &device_id)
 {
-	json::json put_data;
+	std::string url = API_PREFIX "/me/player/next";
+	append_device_id(url, device_id);
+	return command_succeeded(http::post(url.c_str(), std::string(), this->access_token, true));
+}
+
+bool Player_API::seek_to_position(int position_ms, const std::string &device_id)
+{
+	std::string url = API_PREFIX "/me/player/seek?position_ms=" + std::to_string(std::max(position_ms, 0));
+	append_device_id(url, device_id);
+	return command_succeeded(http::request(url.c_str(), http::REQUEST_METHOD::METHOD_PUT, std::string(), this->access_token, true));
+}
+
+bool Player_API::set_repeat_mode(Player_API::REPEAT_MODE state, const std::string &device_id)
+{
+	std::string url = API_PREFIX "/me/player/repeat?state=";
 
 	switch (state)
 	{
 	using enum Player_API::REPEAT_MODE;
 	case TRACK:
-		put_data["state"] = "track";
+		url += "track";
 		break;
 	
 	case CONTEXT:
-		put_data["state"] = "context";
+		url += "context";
 		break;
 
 	case OFF:
 	default:
-		put_data["state"] = "off";
+		url += "off";
 		break;
 	}
-	http::request(API_PREFIX "/me/player/repeat", http::REQUEST_METHOD::METHOD_PUT, put_data.dump(), this->access_token, true);
+	append_device_id(url, device_id);
+	return command_succeeded(http::request(url.c_str(), http::REQUEST_METHOD::METHOD_PUT, std::string(), this->access_token, true));
 }
 
-void Player_API::set_volume(int volume_percent)
+bool Player_API::set_volume(int volume_percent, const std::string &device_id)
 {
-	json::json put_data = {{"volume_percent", std::clamp(volume_percent, 0, 100)}};
-	http::request(API_PREFIX "/me/player/volume", http::REQUEST_METHOD::METHOD_PUT, put_data.dump(), this->access_token, true);
+	std::string url = API_PREFIX "/me/player/volume?volume_percent=" + std::to_string(std::clamp(volume_percent, 0, 100));
+	append_device_id(url, device_id);
+	return command_succeeded(http::request(url.c_str(), http::REQUEST_METHOD::METHOD_PUT, std::string(), this->access_token, true));
 }
 
-void Player_API::set_shuffle(bool state)
+bool Player_API::set_shuffle(bool state, const std::string &device_id)
 {
-	json::json put_data = {{"state", state}};
-	http::request(API_PREFIX "/me/player/shuffle", http::REQUEST_METHOD::METHOD_PUT, put_data.dump(), this->access_token, true);
+	std::string url = API_PREFIX "/me/player/shuffle?state=" + std::string(state ? "true" : "false");
+	append_device_id(url, device_id);
+	return command_succeeded(http::request(url.c_str(), http::REQUEST_METHOD::METHOD_PUT, std::string(), this->access_token, true));
 }
 
-std::unique_ptr<recent_tracks_t> Player_API::get_recently_played_tracks(int limit = 20, unsigned int timestamp = 0, bool after = false)
+std::unique_ptr<recent_tracks_t> Player_API::get_recently_played_tracks(int limit, int64_t timestamp, bool after)
 {
 	auto recent_tracks = std::make_unique<recent_tracks_t>();
 
@@ -346,12 +402,13 @@ std::unique_ptr<queue_t> Player_API::get_queue()
 	return queue_t::from_json(response.body);
 }
 
-void Player_API::add_item_to_playback_queue(const std::string &item_uri)
+bool Player_API::add_item_to_playback_queue(const std::string &item_uri, const std::string &device_id)
 {
 	std::string url = API_PREFIX "/me/player/queue?uri=";
 	url += http::url_encode(item_uri);
+	append_device_id(url, device_id);
 
-	auto response = http::post(url.c_str(), std::string(), this->access_token, true);
+	return command_succeeded(http::post(url.c_str(), std::string(), this->access_token, true));
 }
 
 } // namespace spotify_api
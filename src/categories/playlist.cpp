@@ -1,9 +1,13 @@
 #include <iostream>
-#include <unistd.h>
 #include "categories/playlist.hpp"
 #include "endpoints/playlist.hpp"
 
 #include "curl-util.hpp"
+#include "paging.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
 
 #include <nlohmann/json.hpp>
 
@@ -19,6 +23,37 @@ std::unique_ptr<playlist_t> playlist_t::from_json(const std::string &json_string
 	return from_json(json::json::parse(json_string));
 }
 
+// Playlist pages wrap every track in an item with "added_at", "added_by" and "is_local".
+// Episodes and removed tracks stay in the list as null, so positions still match the playlist
+static std::shared_ptr<track_t> track_from_item(const json::json &item)
+{
+	const json::json *track = item.contains("track") ? &item["track"] : nullptr;
+	bool is_track = track && track->is_object() && track->value("type", "track") == item_type::TRACK;
+	return is_track ? std::shared_ptr<track_t>(track_t::from_json(*track)) : std::shared_ptr<track_t>(nullptr);
+}
+
+// Simplified playlists, such as the ones in /me/playlists, only have the "href" and "total" of their tracks.
+static page_t<std::shared_ptr<track_t>> tracks_from_json(const json::json &json_obj)
+{
+	page_t<std::shared_ptr<track_t>> tracks;
+	tracks.href = json_obj.value("href", "");
+	tracks.total = json_obj.value("total", 0);
+	tracks.limit = json_obj.value("limit", 0);
+	tracks.offset = json_obj.value("offset", 0);
+	tracks.next = json_obj.contains("next") ? json_get_nullable(json_obj["next"], "") : "";
+	tracks.previous = json_obj.contains("previous") ? json_get_nullable(json_obj["previous"], "") : "";
+
+	if (!json_obj.contains("items")) return tracks;
+
+	const json::json &items = json_obj["items"];
+	tracks.items.reserve(items.size());
+	for (auto item = items.begin(); item != items.end(); ++item)
+	{
+		tracks.items.push_back(track_from_item(item.value()));
+	}
+	return tracks;
+}
+
 std::unique_ptr<playlist_t> playlist_t::from_json(const json::json &json_obj)
 {
 	auto playlist = std::make_unique<playlist_t>();
@@ -36,11 +71,6 @@ std::unique_ptr<playlist_t> playlist_t::from_json(const json::json &json_obj)
 		step++;
 		
 		json::json temp_obj;
-
-		for (auto item = json_obj["external_urls"].begin(); item != json_obj["external_urls"].end(); ++item)
-		{
-			playlist->external_urls.emplace(item.key(), item.value().get<std::string>());
-		}
 		step++;
 		
 		if (json_obj.contains("followers"))
@@ -50,10 +80,20 @@ std::unique_ptr<playlist_t> playlist_t::from_json(const json::json &json_obj)
 		}
 		step++;
 		
-		playlist->href = json_obj["href"];
-		step++;
 		playlist->id = json_obj["id"];
 		step++;
+#ifdef SPOTIFY_API_COMPACT_LINKS
+		playlist->links = entity_links_t::from_json(json_obj, type, playlist->id);
+#else
+		for (auto item = json_obj["external_urls"].begin(); item != json_obj["external_urls"].end(); ++item)
+		{
+			playlist->external_urls.emplace(item.key(), item.value().get<std::string>());
+		}
+
+		playlist->href = json_obj["href"];
+		playlist->uri = json_obj["uri"];
+#endif
+		step++;
 
 		temp_obj = json_obj["images"];
 		playlist->images.reserve(temp_obj.size());
@@ -102,10 +142,8 @@ std::unique_ptr<playlist_t> playlist_t::from_json(const json::json &json_obj)
 		
 		playlist->snapshot_id = json_obj["snapshot_id"];
 		step++;
-		playlist->uri = json_obj["uri"];
-		step++;
 		
-		if (json_obj.contains("tracks")) playlist->tracks = page_t<std::shared_ptr<track_t>>::from_json(json_obj["tracks"]);
+		if (json_obj.contains("tracks")) playlist->tracks = tracks_from_json(json_obj["tracks"]);
 	}
 	catch(const std::exception& e)
 	{
@@ -120,49 +158,126 @@ std::unique_ptr<playlist_t> playlist_t::from_json(const json::json &json_obj)
 
 
 
-std::unique_ptr<playlist_t> Playlist_API::get_playlist()
+std::unique_ptr<playlist_t> Playlist_API::get_playlist(const std::string &playlist_id, const std::string &market)
+{
+	std::string id = truncate_spotify_uri(playlist_id);
+	std::string market_query = market.empty() ? "" : "market=" + market;
+
+	std::shared_ptr<const playlist_t> cached = this->cache ? this->cache->find(id, market) : nullptr;
+	if (cached)
+	{
+		// Only the snapshot ID is requested, so an unchanged playlist costs a few bytes instead of every item
+		std::string url = API_PREFIX "/playlists/" + id;
+		auto response = http::get(url.c_str(), "fields=snapshot_id" + (market.empty() ? "" : "&" + market_query), this->access_token);
+		if (response.code == 200 && json::json::parse(response.body).value("snapshot_id", "") == cached->snapshot_id)
+		{
+			return playlist_cache_t::copy(*cached);
+		}
+	}
+
+	auto playlist = this->fetch_playlist(id, market_query);
+	if (playlist && this->cache) this->cache->insert(*playlist, market);
+	return playlist;
+}
+
+std::unique_ptr<playlist_t> Playlist_API::fetch_playlist(const std::string &playlist_id, const std::string &market_query)
 {
-	return std::unique_ptr<playlist_t>();
+	std::string url = API_PREFIX "/playlists/" + playlist_id;
+	auto response = http::get(url.c_str(), market_query, this->access_token);
+	if (response.code != 200) return std::unique_ptr<playlist_t>(nullptr);
+
+	auto playlist = playlist_t::from_json(response.body);
+
+	// The playlist only holds the first page of its items. The total is known from it, so the other pages
+	// are requested several at a time instead of following the "next" links one by one.
+	page_t<std::shared_ptr<track_t>> &tracks = playlist->tracks;
+	if (!tracks.next.empty())
+	{
+		all_pages_t<std::shared_ptr<track_t>> rest;
+		fetch_pages(url + "/tracks", market_query, this->access_token, 100, tracks.items.size(), static_cast<size_t>(std::max(tracks.total, 0)), track_from_item, rest);
+		if (!rest.complete) return std::unique_ptr<playlist_t>(nullptr);
+		tracks.items.reserve(tracks.items.size() + rest.items.size());
+		std::move(rest.items.begin(), rest.items.end(), std::back_inserter(tracks.items));
+	}
+
+	tracks.next = "";
+	tracks.offset = 0;
+	tracks.limit = static_cast<int>(tracks.items.size());
+	tracks.previous = "";
+	return playlist;
 }
 
-std::vector<std::shared_ptr<playlist_t>> Playlist_API::get_my_playlists(int limit)
+paged_range_t<std::shared_ptr<track_t>> Playlist_API::iterate_playlist_tracks(const std::string &playlist_id, const std::string &market, size_t prefetch_pages)
 {
-	std::vector<std::shared_ptr<playlist_t>> playlists;
-	
-	// Sending a preliminary request to get the total number of playlists to return
-	// makes the code a bit more readable and easy to work with
-	http::api_response temp_res = http::get(API_PREFIX "/me/playlists", "?limit=1", this->access_token);
+	std::string url = API_PREFIX "/playlists/" + truncate_spotify_uri(playlist_id) + "/tracks";
+	std::string query_data = market.empty() ? "" : "market=" + market;
+	return paged_range_t<std::shared_ptr<track_t>>(url, query_data, this->access_token, track_from_item, {100, prefetch_pages});
+}
 
-	int total_playlists = json::json::parse(temp_res.body)["total"];
-	if (limit > total_playlists || limit < 1) limit = total_playlists;
-	playlists.reserve(limit);
+std::vector<std::string> Playlist_API::refresh_cached_playlists(const std::string &market)
+{
+	std::vector<std::string> refreshed;
+	if (!this->cache) return refreshed;
 
-	int batch_size = (limit > 50) ? 50 : limit;
+	// One listing of /me/playlists carries the snapshot IDs of up to 50 playlists
+	using snapshot_t = std::pair<std::string, std::string>;
+	auto listing = fetch_all_pages<snapshot_t>(API_PREFIX "/me/playlists", "", this->access_token, 50, [](const json::json &item)
+	{
+		return snapshot_t(item.value("id", ""), item.value("snapshot_id", ""));
+	});
+	std::unordered_map<std::string, std::string> snapshots;
+	for (auto &[id, snapshot_id] : listing.items)
+	{
+		if (!id.empty() && !snapshot_id.empty()) snapshots.emplace(std::move(id), std::move(snapshot_id));
+	}
 
-	for (int batch = 0; batch < ceil(limit / batch_size); batch++)
+	std::string market_query = market.empty() ? "" : "market=" + market;
+	for (const auto &cached : this->cache->playlists(market))
 	{
-		std::stringstream query;
-		query << "?limit=" << batch_size << "&offset" << batch * batch_size;
-		http::api_response batch_res = http::get(API_PREFIX "/me/playlists", query.str(), this->access_token);
-		printf("Batch Code: %i\n", batch_res.code);
-		if (batch_res.code == 429) {
-			printf("\033[33mspotify-api.cpp: get_my_playlists(): Warning: Rate limit exceeded.\n\033[39m");
-			batch--;
-			sleep(1);
-			continue;
+		auto listed = snapshots.find(cached->id);
+		if (listed != snapshots.end())
+		{
+			if (listed->second == cached->snapshot_id) continue;
+
+			auto playlist = this->fetch_playlist(cached->id, market_query);
+			if (!playlist) continue;
+			this->cache->insert(*playlist, market);
+			refreshed.push_back(cached->id);
 		}
-		// if (batch_res.code == 200) std::cout << batch_res.body << std::endl;
-		json::json json_res = json::json::parse(batch_res.body);
-		
-		for (int i = 0; i < json_res["items"].size(); i++)
+		else
 		{
-			playlists.push_back(playlist_t::from_json(json_res["items"][i]));
+			// Playlists the user does not follow are not listed, so they have to be checked one by one
+			std::string old_snapshot = cached->snapshot_id;
+			auto playlist = this->get_playlist(cached->id, market);
+			if (playlist && playlist->snapshot_id != old_snapshot) refreshed.push_back(cached->id);
 		}
-
-		usleep(1000 * 100); // Sleep for 100,000 microseconds or 100 milliseconds
 	}
-	playlists.shrink_to_fit();
-	return playlists;
+	return refreshed;
+}
+
+std::vector<std::shared_ptr<playlist_t>> Playlist_API::get_my_playlists(int limit)
+{
+	size_t max_items = limit < 1 ? SIZE_MAX : static_cast<size_t>(limit);
+	auto pages = fetch_all_pages<std::shared_ptr<playlist_t>>(API_PREFIX "/me/playlists", "", this->access_token, 50, [](const json::json &item)
+	{
+		return std::shared_ptr<playlist_t>(playlist_t::from_json(item));
+	}, max_items);
+	return std::move(pages.items);
+}
+
+visit_result_t Playlist_API::for_each_my_playlist(const std::function<bool(std::unique_ptr<playlist_t> playlist)> &visit)
+{
+	return visit_all_pages<std::unique_ptr<playlist_t>>(API_PREFIX "/me/playlists", "", this->access_token, [](const json::json &item)
+	{
+		return playlist_t::from_json(item);
+	}, visit, {50, 2});
+}
+
+visit_result_t Playlist_API::for_each_playlist_track(const std::string &playlist_id, const std::function<bool(std::shared_ptr<track_t> track)> &visit, const std::string &market)
+{
+	std::string url = API_PREFIX "/playlists/" + truncate_spotify_uri(playlist_id) + "/tracks";
+	std::string query_data = market.empty() ? "" : "market=" + market;
+	return visit_all_pages<std::shared_ptr<track_t>>(url, query_data, this->access_token, track_from_item, visit, {100, 2});
 }
 
 } // namespace spotify_api
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "endpoints/tracks.hpp"
 #include "categories/albums.hpp"
 #include "categories/artists.hpp"
+#include "entity-store.hpp"
 
 #include <type_traits>
 
@@ -20,108 +21,136 @@ std::unique_ptr<track_t> track_t::from_json(const std::string &json_string, bool
 	return from_json(json::json::parse(json_string), parse_linked_from);
 }
 
-std::unique_ptr<track_t> track_t::from_json(const json::json &json_object, bool parse_linked_from)
+// Shared by every variant of track_t::from_json.
+// Embedded albums and artists are decoded with the same context, so they share its memory resource and entity store.
+static bool parse_track(track_t &track, const json::json &json_object, bool parse_linked_from, const decode_context_t &context)
 {
-	auto track = std::make_unique<track_t>();
 	int step = 1;
 	try
 	{
-		json::json json_obj = json_object;
-		if (json_obj.contains("item"))
-		{
-			json_obj = json_obj["item"];
-		}
+		// Binding a reference instead of copying the object saves a deep copy of the whole track per call.
+		const json::json &json_obj = json_object.contains("item") ? json_object["item"] : json_object;
 
 		// not sure whether this check is needed
 		if (json_obj.contains("album"))
 		{
-			track->album = album_t::from_json(json_obj["album"]);
+			track.album = album_t::from_json(json_obj["album"], context);
 		}
 
-		json::json temp = json_obj["artists"];
-		for (auto artist = temp.begin(); artist != temp.end(); ++artist)
+		const json::json &artists = json_obj.at("artists");
+		track.artists.reserve(artists.size());
+		for (auto artist = artists.begin(); artist != artists.end(); ++artist)
 		{
-			track->artists.push_back(artist_t::from_json(artist.value().dump()));
+			track.artists.push_back(artist_t::from_json(artist.value(), context));
 		}
-		track->artists.shrink_to_fit();
 
 		step++;
 
-		temp = json_obj["available_markets"];
-		for (auto market = temp.begin(); market != temp.end(); ++market)
-		{
-			track->available_markets.push_back(market.value());
-		}
-		track->available_markets.shrink_to_fit();
+		if (json_obj.contains("available_markets"))
+			track.available_markets = market_set_t::from_json(json_obj["available_markets"]);
 
 		step++;
 
-		track->disc_number = json_obj["disc_number"];
+		track.disc_number = json_obj.at("disc_number");
 		step++;
-		track->duration_ms = json_obj["duration_ms"];
+		track.duration_ms = json_obj.at("duration_ms");
 		step++;
 
-		temp = json_obj.value("external_ids", json::json::object());
-		for (auto ext_id = temp.begin(); ext_id != temp.end(); ++ext_id)
+		if (json_obj.contains("external_ids"))
 		{
-			track->external_ids.emplace(ext_id.key(), ext_id.value());
+			const json::json &external_ids = json_obj["external_ids"];
+			for (auto ext_id = external_ids.begin(); ext_id != external_ids.end(); ++ext_id)
+			{
+				track.external_ids.emplace(ext_id.key(), ext_id.value());
+			}
 		}
 
 		step++;
 
-		temp = json_obj.value("external_urls", json::json::object());
-		for (auto ext_url = temp.begin(); ext_url != temp.end(); ++ext_url)
+		track.id = json_obj.at("id");
+		step++;
+#ifdef SPOTIFY_API_COMPACT_LINKS
+		track.links = entity_links_t::from_json(json_obj, track_t::type, track.id);
+#else
+		if (json_obj.contains("external_urls"))
 		{
-			track->external_urls.emplace(ext_url.key(), ext_url.value());
+			const json::json &external_urls = json_obj["external_urls"];
+			for (auto ext_url = external_urls.begin(); ext_url != external_urls.end(); ++ext_url)
+			{
+				track.external_urls.emplace(ext_url.key(), ext_url.value());
+			}
 		}
 
+		track.href = json_obj.at("href");
+		track.uri = json_obj.at("uri");
+#endif
 		step++;
-
-		track->href = json_obj["href"];
-		step++;
-		track->id = json_obj["id"];
-		step++;
-		track->is_explicit = json_obj["explicit"];
+		track.is_explicit = json_obj.at("explicit");
 		step++;
-		track->is_local = json_obj["is_local"];
+		track.is_local = json_obj.at("is_local");
 		step++;
-		track->is_playable = json_obj.value("is_playable", false);
+		track.is_playable = json_obj.value("is_playable", false);
 
 		step++;
 
 		if (json_obj.contains("linked_from") && parse_linked_from)
-			track->linked_from.emplace(track_t::from_json(json_obj["linked_from"], false));
+			track.linked_from.emplace(track_t::from_json(json_obj["linked_from"], decode_context_t{context.resource}, false));
 		else
-			track->linked_from.reset();
+			track.linked_from.reset();
 
 		step++;
 
-		track->name = json_obj["name"];
+		track.name = json_obj.at("name");
 		step++;
-		track->popularity = json_obj.value("popularity", 0);
+		track.popularity = json_obj.value("popularity", 0);
 		step++;
-		track->preview_url = json_get_nullable(json_obj["preview_url"], "");
+		track.preview_url = json_get_nullable(json_obj.at("preview_url"), "");
 		step++;
 
-		temp = json_obj.value("restrictions", json::json::object());
-		for (auto restriction = temp.begin(); restriction != temp.end(); ++restriction)
+		if (json_obj.contains("restrictions"))
 		{
-			track->restrictions.emplace(restriction.key(), restriction.value());
+			const json::json &restrictions = json_obj["restrictions"];
+			for (auto restriction = restrictions.begin(); restriction != restrictions.end(); ++restriction)
+			{
+				track.restrictions.emplace(restriction.key(), restriction.value());
+			}
 		}
 
 		step++;
 
-		track->track_number = json_obj["track_number"];
-		step++;
-		track->uri = json_obj["uri"];
+		track.track_number = json_obj.at("track_number");
 	}
 	catch (const std::exception &e)
 	{
 		std::cerr << e.what() << '\n';
 		fprintf(stderr, "\033[31mspotify-api.cpp: object_from_json(): Error: Failed to convert json data to track at step %u.\nJson string: %s\n\n\033[39m", step, json_object.dump(1, '\t').c_str());
-		return std::unique_ptr<track_t>(nullptr);
+		return false;
+	}
+
+	return true;
+}
+
+std::unique_ptr<track_t> track_t::from_json(const json::json &json_object, bool parse_linked_from)
+{
+	auto track = std::make_unique<track_t>();
+	if (!parse_track(*track, json_object, parse_linked_from, decode_context_t())) return std::unique_ptr<track_t>(nullptr);
+	return track;
+}
+
+std::shared_ptr<track_t> track_t::from_json(const json::json &json_object, const decode_context_t &context, bool parse_linked_from)
+{
+	const json::json &json_obj = json_object.contains("item") ? json_object["item"] : json_object;
+
+	if (context.store)
+	{
+		auto stored = context.store->lookup<track_t>(json_obj);
+		if (stored) return stored;
 	}
 
+	auto track = make_entity<track_t>(context.resource);
+	if (!parse_track(*track, json_obj, parse_linked_from, context)) return std::shared_ptr<track_t>(nullptr);
+
+	if (context.store) return context.store->insert(std::move(track), json_obj);
 	return track;
 }
 
@@ -246,7 +275,7 @@ std::unique_ptr<audio_analysis_t::track_t> audio_analysis_t::track_t::from_json(
 {
 	auto track = std::make_unique<audio_analysis_t::track_t>();
 	
-	track->samples = json_obj["samples"];
+	track->samples = json_obj["num_samples"];
 	track->duration = json_obj["duration"];
 	track->sample_md5 = json_obj["sample_md5"];
 	track->offset_seconds = json_obj["offset_seconds"];
@@ -353,7 +382,8 @@ std::unique_ptr<audio_analysis_t::segment_t> audio_analysis_t::segment_t::from_j
 	segment->loudness_max = json_obj["loudness_max"];
 	segment->loudness_max_time = json_obj["loudness_max_time"];
 	segment->loudness_end = json_obj["loudness_end"];
-	segment->start = json_obj["start"];
+	segment->pitches = json_obj["pitches"].get<std::vector<double>>();
+	segment->timbre = json_obj["timbre"].get<std::vector<double>>();
 
 	return segment;
 }
@@ -1,4 +1,8 @@
 #include "curl-util.hpp"
+#include "response-cache.hpp"
+
+#include <atomic>
+#include <mutex>
 
 size_t curl_callback(char *contents, size_t size, size_t nmemb, std::string* output) {
 	size_t realsize = size * nmemb;
@@ -15,6 +19,20 @@ size_t curl_callback(char *contents, size_t size, size_t nmemb, std::string* out
 namespace http
 {
 
+static std::atomic<std::shared_ptr<response_cache_t>> active_response_cache;
+
+void set_response_cache(std::shared_ptr<response_cache_t> cache)
+{
+	active_response_cache.store(std::move(cache));
+}
+
+// curl_easy_init initializes libcurl on first use, which is not thread safe, and requests are made from many threads
+static void init_curl_once()
+{
+	static std::once_flag initialized;
+	std::call_once(initialized, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+}
+
 std::string method_to_string(REQUEST_METHOD method)
 {
 	switch (method)
@@ -64,6 +82,19 @@ std::string url_encode(const std::string &to_encode)
 api_response get(const char *url, const std::string &query_data, const std::string &auth_token) {
 	api_response retval;
 
+	std::shared_ptr<response_cache_t> cache = active_response_cache.load();
+	std::chrono::seconds cache_ttl(0);
+	if (cache && !response_cache_t::is_user_specific(url, query_data)) cache_ttl = cache->ttl_for(url);
+	std::string cache_key;
+	if (cache_ttl.count() > 0) {
+		cache_key = response_cache_t::normalize_key(url, query_data);
+		if (std::optional<std::string> body = cache->get(cache_key)) {
+			retval.code = 200;
+			retval.body = std::move(*body);
+			return retval;
+		}
+	}
+
 	CURLcode ret;
 	CURL *hnd;
 	struct curl_slist *slist1;
@@ -78,6 +109,7 @@ api_response get(const char *url, const std::string &query_data, const std::stri
 
 	full_url += query_data;
 
+	init_curl_once();
 	hnd = curl_easy_init();
 	curl_easy_setopt(hnd, CURLOPT_BUFFERSIZE, 102400L);
 	// curl_easy_setopt(hnd, CURLOPT_VERBOSE, 1);
@@ -103,6 +135,10 @@ api_response get(const char *url, const std::string &query_data, const std::stri
 	if (ret != CURLE_OK) {
 		throw "cURL operation failed";
 	}
+
+	if (cache_ttl.count() > 0 && retval.code == 200) {
+		cache->put(cache_key, retval.body, cache_ttl);
+	}
 	return retval;
 }
 
@@ -120,6 +156,7 @@ api_response post(const char *url, const std::string &post_data, const std::stri
 	slist1 = curl_slist_append(slist1, (auth_header_prefix + auth_header_value).c_str());
 	// slist1 = curl_slist_append(slist1, "Content-Type: application/json");
 
+	init_curl_once();
 	hnd = curl_easy_init();
 	curl_easy_setopt(hnd, CURLOPT_BUFFERSIZE, 102400L);
 	// curl_easy_setopt(hnd, CURLOPT_VERBOSE, 1);
@@ -165,6 +202,7 @@ api_response request(const char *url, REQUEST_METHOD method, const std::string &
 
 	
 
+	init_curl_once();
 	hnd = curl_easy_init();
 	curl_easy_setopt(hnd, CURLOPT_BUFFERSIZE, 102400L);
 	curl_easy_setopt(hnd, CURLOPT_VERBOSE, 1);
@@ -1,5 +1,6 @@
 #include "endpoints/tracks.hpp"
 #include "categories/tracks.hpp"
+#include "categories/ids.hpp"
 
 #include "curl-util.hpp"
 
@@ -11,52 +12,96 @@ namespace spotify_api {
 
 std::unique_ptr<track_t> Track_API::get_track(const std::string &track_id, const std::string &market)
 {
+	entity_cache_t<track_t>::key_t key;
+	bool cacheable = this->cache && entity_cache_t<track_t>::make_key(track_id, market, key);
+	if (cacheable)
+	{
+		if (auto cached = this->cache->find(key)) return std::make_unique<track_t>(*cached);
+	}
+
 	std::string url = API_PREFIX "/tracks/";
 	url += truncate_spotify_uri(track_id);
 	auto response = http::get(url.c_str(), "market=" + market, this->access_token);
 
 	if (response.code != 200) return std::unique_ptr<track_t>(nullptr);
 
-	return track_t::from_json(response.body);
+	auto track = track_t::from_json(response.body);
+	if (cacheable && track) this->cache->insert(key, std::make_shared<const track_t>(*track));
+	return track;
 }
 
 std::vector<std::unique_ptr<track_t>> Track_API::get_tracks(const std::vector<std::string> &track_ids, const std::string &market)
 {
-	std::ostringstream query_data;
-	query_data << "ids=";
-
-	for (size_t i = 0; i < track_ids.size(); ++i)
-	{
-		query_data << truncate_spotify_uri(track_ids[i]);
+	// Duplicates are kept, and invalid IDs get a null, so that the output lines up with the requested IDs.
+	normalized_ids_t ids = normalize_spotify_ids(track_ids, false);
 
-		if (i < (track_ids.size() - 1)) query_data << "\%2C";
-	}
+	// Markets that are not country codes depend on the user, so those responses are not cached
+	int market_index = markets::index_of(market);
+	entity_cache_t<track_t> *cache = (market.empty() || market_index >= 0) ? this->cache.get() : nullptr;
 
-	query_data << "&market" << market;
+	return align_to_inputs(entity_cache_t<track_t>::get_many(cache, ids.ids, static_cast<int16_t>(market_index), 50, [&](std::span<const spotify_id_t> batch)
+	{
+		std::string query_data = "ids=" + join_spotify_ids(std::vector<spotify_id_t>(batch.begin(), batch.end()));
+		if (!market.empty()) query_data += "&market=" + market;
 
-	auto response = http::get(API_PREFIX "/tracks", query_data.str(), this->access_token);
+		auto response = http::get(API_PREFIX "/tracks", query_data, this->access_token);
 
-	std::vector<std::unique_ptr<track_t>> tracks;
-	if (response.code != 200) return tracks;
+		std::vector<std::unique_ptr<track_t>> tracks;
+		if (is_retryable_status(response.code)) throw batch_retry_t(response.code);
+		if (response.code != 200) return tracks;
 
-	json::json tracks_array = json::json::parse(response.body)["tracks"];
-	for (auto track = tracks_array.begin(); track != tracks_array.end(); ++track)
-	{
-		tracks.push_back(track_t::from_json(track.value()));
-	}
-	return tracks;
+		json::json tracks_array = json::json::parse(response.body)["tracks"];
+		for (auto track = tracks_array.begin(); track != tracks_array.end(); ++track)
+		{
+			tracks.push_back(track.value().is_null() ? std::unique_ptr<track_t>(nullptr) : track_t::from_json(track.value()));
+		}
+		return tracks;
+	}), ids);
 }
 
 page_t<std::unique_ptr<track_t>> Track_API::get_saved_tracks(const std::string &market, uint8_t limit, unsigned int offset)
 {
 	std::ostringstream query_data;
-	query_data << "market=" << market << "&limit=" << limit << "&offset=" << offset;
+	// The limit is a uint8_t, which a stream would print as a character
+	query_data << "market=" << market << "&limit=" << static_cast<unsigned int>(limit) << "&offset=" << offset;
 	auto response = http::get(API_PREFIX "/me/tracks", query_data.str(), this->access_token);
 
 	page_t<std::unique_ptr<track_t>> tracks_page;
 	if (response.code != 200) return tracks_page;
-	
-	return page_t<std::unique_ptr<track_t>>::from_json(response.body);
+
+	// Saved tracks come wrapped as {"added_at", "track"}
+	json::json page_json = json::json::parse(response.body);
+	for (auto &item : page_json["items"])
+	{
+		json::json track = std::move(item["track"]);
+		item = std::move(track);
+	}
+	return page_t<std::unique_ptr<track_t>>::from_json(page_json);
+}
+
+// Saved tracks come wrapped as {"added_at", "track"}
+static std::unique_ptr<track_t> saved_track_from_item(const json::json &item)
+{
+	const json::json &track = item.at("track");
+	return track.is_null() ? std::unique_ptr<track_t>(nullptr) : track_t::from_json(track);
+}
+
+all_pages_t<std::unique_ptr<track_t>> Track_API::get_all_saved_tracks(const std::string &market, size_t max_items)
+{
+	std::string query_data = market.empty() ? "" : "market=" + market;
+	return fetch_all_pages<std::unique_ptr<track_t>>(API_PREFIX "/me/tracks", query_data, this->access_token, 50, saved_track_from_item, max_items);
+}
+
+paged_range_t<std::unique_ptr<track_t>> Track_API::iterate_saved_tracks(const std::string &market, size_t prefetch_pages)
+{
+	std::string query_data = market.empty() ? "" : "market=" + market;
+	return paged_range_t<std::unique_ptr<track_t>>(API_PREFIX "/me/tracks", query_data, this->access_token, saved_track_from_item, {50, prefetch_pages});
+}
+
+visit_result_t Track_API::for_each_saved_track(const std::function<bool(std::unique_ptr<track_t> track)> &visit, const std::string &market)
+{
+	std::string query_data = market.empty() ? "" : "market=" + market;
+	return visit_all_pages<std::unique_ptr<track_t>>(API_PREFIX "/me/tracks", query_data, this->access_token, saved_track_from_item, visit, {50, 2});
 }
 
 void Track_API::save_tracks(const std::vector<std::string> &track_ids)
@@ -72,31 +117,27 @@ void Track_API::remove_saved_tracks(const std::vector<std::string> &track_ids)
 	json::json json_ids = {
 		{"ids", truncate_spotify_uris(track_ids, 50)}
 	};
-	(void) http::request(API_PREFIX "/me/tracks", http::REQUEST_METHOD::delete, json_ids.dump(), this->access_token, true);
+	(void) http::request(API_PREFIX "/me/tracks", http::REQUEST_METHOD::METHOD_DELETE, json_ids.dump(), this->access_token, true);
 }
 
 std::vector<bool> Track_API::check_saved_tracks(const std::vector<std::string> &track_ids)
 {
-	std::ostringstream query_data;
-	query_data << "ids=";
+	// Only unique IDs are sent. The answers are then mapped back onto every requested ID,
+	// with invalid IDs and IDs past the 50 ID limit reported as not saved.
+	normalized_ids_t ids = normalize_spotify_ids(track_ids);
+	std::string query_data = "ids=" + join_spotify_ids(ids.ids, "%2C", 0, 50);
 
-	std::vector<std::string> truncated_ids = truncate_spotify_uris(track_ids, 50);
-	for (size_t i = 0; i < truncated_ids.size(); ++i) {
-		query_data << truncated_ids[i];
-		if (i < (truncated_ids.size() - 1))
-		{
-			query_data << "\%2C";
-		}
-	}
-	auto response = http::get(API_PREFIX "/me/tracks/contains", query_data.str(), this->access_token);
+	auto response = http::get(API_PREFIX "/me/tracks/contains", query_data, this->access_token);
 	
 	std::vector<bool> checked_tracks;
 	if (response.code != 200) return checked_tracks;
 
 	json::json json_response = json::json::parse(response.body);
-	for (auto track = json_response.begin(); track != json_response.end(); ++track)
+	checked_tracks.reserve(track_ids.size());
+	for (int64_t position : ids.positions)
 	{
-		checked_tracks.push_back(track.value().get<bool>());
+		bool is_saved = position >= 0 && static_cast<size_t>(position) < json_response.size() && json_response[position].get<bool>();
+		checked_tracks.push_back(is_saved);
 	}
 	return checked_tracks;
 }
@@ -104,7 +145,7 @@ std::vector<bool> Track_API::check_saved_tracks(const std::vector<std::string> &
 std::string filter_to_query_string(recommendation_filter_t filter)
 {
 	std::ostringstream query_string;
-	query_string << "limit=" << std::clamp<u_int>(filter.limit, 1, 100);
+	query_string << "limit=" << std::clamp<u_int>(filter.limit == 0 ? 20 : filter.limit, 1, 100);
 	query_string << "&market=" << filter.market;
 
 	query_string << "&seed_artists=";
@@ -210,28 +251,25 @@ std::unique_ptr<audio_features_t> Track_API::get_audio_features_for_track(const
 
 std::vector<std::unique_ptr<audio_features_t>> Track_API::get_audio_features_for_tracks(const std::vector<std::string> &track_ids)
 {
-	std::ostringstream query_data;
-	query_data << "?ids=";
-	std::vector<std::string> truncated_ids = truncate_spotify_uris(track_ids, 100);
+	normalized_ids_t ids = normalize_spotify_ids(track_ids, false);
 
-	for (size_t i = 0; i < truncated_ids.size(); ++i)
+	return align_to_inputs(multi_get<audio_features_t>(ids.ids, 100, [&](std::span<const spotify_id_t> batch)
 	{
-		query_data << truncated_ids[i];
-		if (i < truncated_ids.size() - 1)
+		std::string query_data = "ids=" + join_spotify_ids(std::vector<spotify_id_t>(batch.begin(), batch.end()));
+		auto response = http::get(API_PREFIX "/audio-features", query_data, this->access_token);
+
+		// Tracks without features come back as null, so the output stays lined up with the IDs
+		std::vector<std::unique_ptr<audio_features_t>> features;
+		if (is_retryable_status(response.code)) throw batch_retry_t(response.code);
+		if (response.code != 200) return features;
+
+		json::json features_json = json::json::parse(response.body)["audio_features"];
+		for (auto feat = features_json.begin(); feat != features_json.end(); ++feat)
 		{
-			query_data << http::url_encode(",");
+			features.push_back(feat.value().is_null() ? std::unique_ptr<audio_features_t>(nullptr) : audio_features_t::from_json(feat.value()));
 		}
-	}
-	auto response = http::get(API_PREFIX "/audio-features", query_data.str(), this->access_token);
-	std::vector<std::unique_ptr<audio_features_t>> features;
-	if (response.code != 200) return features;
-
-	json::json features_json = json::json::parse(response.body)["audio_features"];
-	for (auto feat = features_json.begin(); feat != features_json.end(); ++feat)
-	{
-		features.push_back(audio_features_t::from_json(feat.value()));
-	}
-	return features;
+		return features;
+	}), ids);
 }
 
 std::unique_ptr<audio_analysis_t> Track_API::get_audio_analysis_for_track(const std::string &track_id)
@@ -243,6 +281,15 @@ std::unique_ptr<audio_analysis_t> Track_API::get_audio_analysis_for_track(const
 	return audio_analysis_t::from_json(response.body);
 }
 
+std::unique_ptr<columnar_analysis_t> Track_API::get_columnar_audio_analysis_for_track(const std::string &track_id)
+{
+	std::ostringstream url;
+	url << API_PREFIX << "/audio-analysis/" << truncate_spotify_uri(track_id);
+	auto response = http::get(url.str().c_str(), std::string(), this->access_token);
+	if (response.code != 200) return std::unique_ptr<columnar_analysis_t>(nullptr);
+	return columnar_analysis_t::from_json(response.body);
+}
+
 std::unique_ptr<Track_API::recommendations_t> Track_API::get_recommendations(const recommendation_filter_t &filter)
 {
 	std::string query_data = filter_to_query_string(filter);
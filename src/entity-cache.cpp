@@ -0,0 +1,137 @@
+#include "entity-cache.hpp"
+
+namespace spotify_api
+{
+
+template <class T>
+entity_cache_t<T>::entity_cache_t(size_t capacity, size_t shard_count)
+{
+	if (shard_count == 0) shard_count = 1;
+	this->_shard_capacity = std::max<size_t>(1, (capacity + shard_count - 1) / shard_count);
+	// The usual split for segmented LRU: most of the space goes to entries that proved to be popular
+	this->_protected_capacity = this->_shard_capacity * 4 / 5;
+
+	this->_shards.reserve(shard_count);
+	for (size_t i = 0; i < shard_count; i++) this->_shards.push_back(std::make_unique<shard_t>());
+}
+
+template <class T>
+bool entity_cache_t<T>::make_key(std::string_view id_or_uri, std::string_view market, key_t &key)
+{
+	auto id = spotify_id_t::parse(id_or_uri);
+	if (!id) return false;
+
+	key.id = *id;
+	key.market = -1;
+	if (market.empty()) return true;
+
+	int index = markets::index_of(market);
+	if (index < 0) return false;
+	key.market = static_cast<int16_t>(index);
+	return true;
+}
+
+template <class T>
+std::shared_ptr<const T> entity_cache_t<T>::find(const key_t &key)
+{
+	shard_t &shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+
+	auto position = shard.positions.find(key);
+	if (position == shard.positions.end()) return std::shared_ptr<const T>(nullptr);
+
+	this->promote(shard, position->second);
+	return position->second->entity;
+}
+
+template <class T>
+void entity_cache_t<T>::insert(const key_t &key, std::shared_ptr<const T> entity)
+{
+	if (!entity) return;
+
+	shard_t &shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+
+	auto position = shard.positions.find(key);
+	if (position != shard.positions.end())
+	{
+		position->second->entity = std::move(entity);
+		this->promote(shard, position->second);
+		return;
+	}
+
+	shard.probation.push_front(node_t{key, std::move(entity), false});
+	shard.positions.emplace(key, shard.probation.begin());
+	this->trim(shard);
+}
+
+template <class T>
+void entity_cache_t<T>::promote(shard_t &shard, typename std::list<node_t>::iterator node)
+{
+	// Splicing keeps the iterator stored in `positions` valid
+	std::list<node_t> &source = node->is_protected ? shard.protected_entries : shard.probation;
+	shard.protected_entries.splice(shard.protected_entries.begin(), source, node);
+	node->is_protected = true;
+
+	// The least recently used protected entry gets another chance on probation
+	if (shard.protected_entries.size() > this->_protected_capacity)
+	{
+		auto demoted = std::prev(shard.protected_entries.end());
+		demoted->is_protected = false;
+		shard.probation.splice(shard.probation.begin(), shard.protected_entries, demoted);
+	}
+}
+
+template <class T>
+void entity_cache_t<T>::trim(shard_t &shard)
+{
+	while (shard.probation.size() + shard.protected_entries.size() > this->_shard_capacity)
+	{
+		std::list<node_t> &victims = shard.probation.empty() ? shard.protected_entries : shard.probation;
+		shard.positions.erase(victims.back().key);
+		victims.pop_back();
+	}
+}
+
+template <class T>
+void entity_cache_t<T>::erase(const key_t &key)
+{
+	shard_t &shard = this->shard_of(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+
+	auto position = shard.positions.find(key);
+	if (position == shard.positions.end()) return;
+
+	(position->second->is_protected ? shard.protected_entries : shard.probation).erase(position->second);
+	shard.positions.erase(position);
+}
+
+template <class T>
+void entity_cache_t<T>::clear()
+{
+	for (auto &shard : this->_shards)
+	{
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		shard->positions.clear();
+		shard->probation.clear();
+		shard->protected_entries.clear();
+	}
+}
+
+template <class T>
+size_t entity_cache_t<T>::size() const
+{
+	size_t total = 0;
+	for (auto &shard : this->_shards)
+	{
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		total += shard->positions.size();
+	}
+	return total;
+}
+
+template class entity_cache_t<track_t>;
+template class entity_cache_t<album_t>;
+template class entity_cache_t<artist_t>;
+
+} // namespace spotify_api
@@ -0,0 +1,101 @@
+#include "entity-store.hpp"
+
+#include <mutex>
+#include <optional>
+
+namespace json = nlohmann;
+
+namespace spotify_api
+{
+
+// The simplified objects embedded in other objects are missing some of the fields of the full objects.
+// One field that only the full form has is enough to tell them apart.
+template <class T>
+static int detail_of(const json::json &json_object);
+
+template <>
+int detail_of<track_t>(const json::json &json_object) { return json_object.contains("album") ? 1 : 0; }
+
+template <>
+int detail_of<album_t>(const json::json &json_object) { return json_object.contains("tracks") ? 1 : 0; }
+
+template <>
+int detail_of<artist_t>(const json::json &json_object) { return json_object.contains("popularity") ? 1 : 0; }
+
+static std::optional<spotify_id_t> id_of(const json::json &json_object)
+{
+	auto found = json_object.find("id");
+	if (found == json_object.end() || !found->is_string()) return std::nullopt;
+	return spotify_id_t::from_base62(found->get_ref<const std::string &>());
+}
+
+template <class T>
+std::shared_ptr<T> entity_store_t::lookup(const json::json &json_object) const
+{
+	auto id = id_of(json_object);
+	if (!id) return std::shared_ptr<T>(nullptr);
+
+	std::shared_lock<std::shared_mutex> read_lock(this->_mutex);
+	const table_t<T> &entities = this->table<T>();
+	auto found = entities.find(*id);
+	if (found == entities.end() || found->second.detail < detail_of<T>(json_object)) return std::shared_ptr<T>(nullptr);
+	return found->second.entity;
+}
+
+template <class T>
+std::shared_ptr<T> entity_store_t::insert(std::shared_ptr<T> entity, const json::json &json_object)
+{
+	auto id = id_of(json_object);
+	if (!id || !entity) return entity;
+
+	int detail = detail_of<T>(json_object);
+
+	std::unique_lock<std::shared_mutex> write_lock(this->_mutex);
+	auto inserted = this->table<T>().try_emplace(*id, entry_t<T>{entity, detail});
+	if (inserted.second) return entity;
+
+	entry_t<T> &entry = inserted.first->second;
+	if (detail > entry.detail)
+	{
+		// Swap in the new instance rather than overwrite the stored one, which other threads may be reading
+		entry.entity = std::move(entity);
+		entry.detail = detail;
+	}
+	return entry.entity;
+}
+
+template <class T>
+std::shared_ptr<T> entity_store_t::find(const spotify_id_t &id) const
+{
+	std::shared_lock<std::shared_mutex> read_lock(this->_mutex);
+	const table_t<T> &entities = this->table<T>();
+	auto found = entities.find(id);
+	if (found == entities.end()) return std::shared_ptr<T>(nullptr);
+	return found->second.entity;
+}
+
+size_t entity_store_t::size() const
+{
+	std::shared_lock<std::shared_mutex> read_lock(this->_mutex);
+	return std::apply([](const auto &...tables) { return (tables.size() + ...); }, this->_tables);
+}
+
+void entity_store_t::clear()
+{
+	std::unique_lock<std::shared_mutex> write_lock(this->_mutex);
+	std::apply([](auto &...tables) { (tables.clear(), ...); }, this->_tables);
+}
+
+template std::shared_ptr<track_t> entity_store_t::lookup<track_t>(const json::json &) const;
+template std::shared_ptr<album_t> entity_store_t::lookup<album_t>(const json::json &) const;
+template std::shared_ptr<artist_t> entity_store_t::lookup<artist_t>(const json::json &) const;
+
+template std::shared_ptr<track_t> entity_store_t::insert<track_t>(std::shared_ptr<track_t>, const json::json &);
+template std::shared_ptr<album_t> entity_store_t::insert<album_t>(std::shared_ptr<album_t>, const json::json &);
+template std::shared_ptr<artist_t> entity_store_t::insert<artist_t>(std::shared_ptr<artist_t>, const json::json &);
+
+template std::shared_ptr<track_t> entity_store_t::find<track_t>(const spotify_id_t &) const;
+template std::shared_ptr<album_t> entity_store_t::find<album_t>(const spotify_id_t &) const;
+template std::shared_ptr<artist_t> entity_store_t::find<artist_t>(const spotify_id_t &) const;
+
+} // namespace spotify_api
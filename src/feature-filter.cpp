@@ -0,0 +1,128 @@
+#include "feature-filter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace spotify_api
+{
+
+// Large enough to keep the scores of one block in the L1 cache
+static constexpr size_t block_size = 4096;
+
+feature_filter_t::feature_filter_t(const recommendation_filter_t &filter)
+{
+	this->_lower.fill(-std::numeric_limits<float>::infinity());
+	this->_upper.fill(std::numeric_limits<float>::infinity());
+	this->_target.fill(0.0f);
+	this->_weights.fill(0.0f);
+	this->_limit = filter.limit;
+
+	// Unused doubles are NaN and unused ints are -1, see recommendation_filter_t.
+	// Bounds are scaled but not clamped, so a bound outside the range excludes every row instead of matching the edge.
+	constexpr double unused = std::numeric_limits<double>::quiet_NaN();
+	auto set = [this](feature_matrix_t::feature_t feature, double min, double max, double target) {
+		if (!std::isnan(min)) this->_lower[feature] = feature_matrix_t::scale(feature, min);
+		if (!std::isnan(max)) this->_upper[feature] = feature_matrix_t::scale(feature, max);
+		if (!std::isnan(target))
+		{
+			this->_target[feature] = feature_matrix_t::normalize(feature, target);
+			this->_weights[feature] = 1.0f;
+			this->_has_targets = true;
+		}
+	};
+	auto set_int = [&set](feature_matrix_t::feature_t feature, int min, int max, int target) {
+		set(feature, min < 0 ? unused : min, max < 0 ? unused : max, target < 0 ? unused : target);
+	};
+
+	set(feature_matrix_t::acousticness, filter.min_acousticness, filter.max_acousticness, filter.target_acousticness);
+	set(feature_matrix_t::danceability, filter.min_danceability, filter.max_danceability, filter.target_danceability);
+	set(feature_matrix_t::energy, filter.min_energy, filter.max_energy, filter.target_energy);
+	set(feature_matrix_t::instrumentalness, filter.min_instrumentalness, filter.max_instrumentalness, filter.target_instrumentalness);
+	set_int(feature_matrix_t::key, -1, -1, filter.target_key);
+	set(feature_matrix_t::liveness, filter.min_liveness, filter.max_liveness, filter.target_liveness);
+	set(feature_matrix_t::loudness, unused, unused, filter.target_loudness);
+	set_int(feature_matrix_t::mode, filter.min_mode, filter.max_mode, filter.target_mode);
+	set(feature_matrix_t::speechiness, filter.min_speechiness, filter.max_speechiness, filter.target_speechiness);
+	set(feature_matrix_t::tempo, unused, unused, filter.target_tempo);
+	set(feature_matrix_t::valence, filter.min_valence, filter.max_valence, filter.target_valence);
+
+	if (filter.min_duration_ms >= 0) this->_min_duration_ms = static_cast<uint32_t>(filter.min_duration_ms);
+	if (filter.max_duration_ms >= 0) this->_max_duration_ms = static_cast<uint32_t>(filter.max_duration_ms);
+	// Key, loudness and tempo saturate when normalized (a key of -1 becomes 0, tempos above 250 BPM become 1),
+	// so their bounds are checked against the raw columns
+	if (filter.min_key >= 0) this->_min_key = static_cast<int8_t>(std::min(filter.min_key, 127));
+	if (filter.max_key >= 0) this->_max_key = static_cast<int8_t>(std::min(filter.max_key, 127));
+	if (!std::isnan(filter.min_loudness)) this->_min_loudness = static_cast<float>(filter.min_loudness);
+	if (!std::isnan(filter.max_loudness)) this->_max_loudness = static_cast<float>(filter.max_loudness);
+	if (!std::isnan(filter.min_tempo)) this->_min_tempo = static_cast<float>(filter.min_tempo);
+	if (!std::isnan(filter.max_tempo)) this->_max_tempo = static_cast<float>(filter.max_tempo);
+	if (filter.min_time_signature >= 0) this->_min_time_signature = static_cast<uint8_t>(std::min(filter.min_time_signature, 255));
+	if (filter.max_time_signature >= 0) this->_max_time_signature = static_cast<uint8_t>(std::min(filter.max_time_signature, 255));
+}
+
+void feature_filter_t::apply_extra_bounds(const feature_matrix_t &matrix, size_t first, std::vector<float> &scores) const
+{
+	const uint32_t *durations = matrix.durations_ms().data() + first;
+	const uint8_t *time_signatures = matrix.time_signatures().data() + first;
+	const int8_t *keys = matrix.keys().data() + first;
+	const float *loudness = matrix.loudness_db().data() + first;
+	const float *tempos = matrix.tempos().data() + first;
+	const float infinity = std::numeric_limits<float>::infinity();
+
+	// Written without branches so the compiler can vectorize it
+	for (size_t i = 0; i < scores.size(); i++)
+	{
+		bool inside = (durations[i] >= this->_min_duration_ms) & (durations[i] <= this->_max_duration_ms)
+			& (time_signatures[i] >= this->_min_time_signature) & (time_signatures[i] <= this->_max_time_signature)
+			& (keys[i] >= this->_min_key) & (keys[i] <= this->_max_key)
+			& (loudness[i] >= this->_min_loudness) & (loudness[i] <= this->_max_loudness)
+			& (tempos[i] >= this->_min_tempo) & (tempos[i] <= this->_max_tempo);
+		scores[i] = inside ? scores[i] : infinity;
+	}
+}
+
+bool feature_filter_t::matches(const feature_matrix_t &matrix, size_t index) const
+{
+	std::vector<float> score(1);
+	analysis_kernels::bounded_distances(this->_lower, this->_upper, this->_target, this->_weights, matrix.rows().subspan(index, 1), score);
+	this->apply_extra_bounds(matrix, index, score);
+	return std::isfinite(score[0]);
+}
+
+std::vector<feature_filter_t::candidate_t> feature_filter_t::apply(const feature_matrix_t &matrix, size_t limit) const
+{
+	std::vector<candidate_t> candidates;
+	std::vector<float> scores;
+	std::span<const feature_matrix_t::row_t> rows = matrix.rows();
+
+	for (size_t first = 0; first < rows.size(); first += block_size)
+	{
+		std::span<const feature_matrix_t::row_t> block = rows.subspan(first, std::min(block_size, rows.size() - first));
+		scores.resize(block.size());
+		analysis_kernels::bounded_distances(this->_lower, this->_upper, this->_target, this->_weights, block, scores);
+		this->apply_extra_bounds(matrix, first, scores);
+
+		for (size_t i = 0; i < scores.size(); i++)
+		{
+			if (std::isfinite(scores[i])) candidates.push_back(candidate_t{first + i, scores[i]});
+		}
+	}
+
+	// Equal scores keep matrix order, so a filter without targets returns rows in the order they were added
+	auto better = [](const candidate_t &lhs, const candidate_t &rhs) {
+		return lhs.score < rhs.score || (lhs.score == rhs.score && lhs.index < rhs.index);
+	};
+	if (limit > 0 && candidates.size() > limit)
+	{
+		std::partial_sort(candidates.begin(), candidates.begin() + limit, candidates.end(), better);
+		candidates.resize(limit);
+	}
+	else
+	{
+		std::sort(candidates.begin(), candidates.end(), better);
+	}
+	return candidates;
+}
+
+} // namespace spotify_api
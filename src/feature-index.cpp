@@ -0,0 +1,225 @@
+#include "feature-index.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace spotify_api
+{
+
+// Grows geometrically, since reserving exactly the new size would reallocate on every call when rows are added in batches
+template <class T>
+static void reserve_more(std::vector<T> &vector, size_t additional)
+{
+	size_t needed = vector.size() + additional;
+	if (needed > vector.capacity()) vector.reserve(std::max(needed, 2 * vector.capacity()));
+}
+
+static float clamp_unit(double value)
+{
+	return static_cast<float>(std::clamp(value, 0.0, 1.0));
+}
+
+float feature_matrix_t::scale(feature_t feature, double value)
+{
+	// Loudness is typically between -60 and 0 dB, and tempo rarely goes above 250 BPM.
+	// A key of -1 means no key was detected.
+	switch (feature)
+	{
+		case key: return static_cast<float>(value / 11.0);
+		case loudness: return static_cast<float>((value + 60.0) / 60.0);
+		case tempo: return static_cast<float>(value / 250.0);
+		default: return static_cast<float>(value);
+	}
+}
+
+float feature_matrix_t::normalize(feature_t feature, double value)
+{
+	return clamp_unit(scale(feature, value));
+}
+
+feature_matrix_t::row_t feature_matrix_t::normalize(const audio_features_t &features)
+{
+	return row_t{
+		normalize(acousticness, features.acousticness),
+		normalize(danceability, features.danceability),
+		normalize(energy, features.energy),
+		normalize(instrumentalness, features.instrumentalness),
+		normalize(key, features.key),
+		normalize(liveness, features.liveness),
+		normalize(loudness, features.loudness),
+		normalize(mode, features.mode),
+		normalize(speechiness, features.speechiness),
+		normalize(tempo, features.tempo),
+		normalize(valence, features.valence),
+		0.0f
+	};
+}
+
+bool feature_matrix_t::add(const audio_features_t &features)
+{
+	auto id = spotify_id_t::from_base62(features.id);
+	if (!id) return false;
+
+	auto inserted = this->_positions.try_emplace(*id, this->_rows.size());
+	if (!inserted.second)
+	{
+		size_t index = inserted.first->second;
+		this->_rows[index] = normalize(features);
+		this->_durations_ms[index] = features.duration_ms;
+		this->_time_signatures[index] = static_cast<uint8_t>(features.time_signature);
+		this->_keys[index] = static_cast<int8_t>(features.key);
+		this->_loudness_db[index] = static_cast<float>(features.loudness);
+		this->_tempos[index] = static_cast<float>(features.tempo);
+		return true;
+	}
+
+	this->_rows.push_back(normalize(features));
+	this->_ids.push_back(*id);
+	this->_durations_ms.push_back(features.duration_ms);
+	this->_time_signatures.push_back(static_cast<uint8_t>(features.time_signature));
+	this->_keys.push_back(static_cast<int8_t>(features.key));
+	this->_loudness_db.push_back(static_cast<float>(features.loudness));
+	this->_tempos.push_back(static_cast<float>(features.tempo));
+	return true;
+}
+
+void feature_matrix_t::add(const std::vector<std::unique_ptr<audio_features_t>> &features)
+{
+	reserve_more(this->_rows, features.size());
+	reserve_more(this->_ids, features.size());
+	reserve_more(this->_durations_ms, features.size());
+	reserve_more(this->_time_signatures, features.size());
+	reserve_more(this->_keys, features.size());
+	reserve_more(this->_loudness_db, features.size());
+	reserve_more(this->_tempos, features.size());
+	for (const auto &entry : features)
+	{
+		if (entry) this->add(*entry);
+	}
+}
+
+std::optional<size_t> feature_matrix_t::find(const spotify_id_t &id) const
+{
+	auto found = this->_positions.find(id);
+	if (found == this->_positions.end()) return std::nullopt;
+	return found->second;
+}
+
+
+static size_t nearest(const feature_matrix_t::row_t &row, std::span<const feature_matrix_t::row_t> centroids, std::vector<float> &distances)
+{
+	analysis_kernels::distances(row, centroids, distances);
+	return static_cast<size_t>(std::min_element(distances.begin(), distances.begin() + centroids.size()) - distances.begin());
+}
+
+feature_index_t::feature_index_t(const feature_matrix_t &matrix, size_t list_count, unsigned int iterations)
+{
+	std::span<const feature_matrix_t::row_t> rows = matrix.rows();
+	if (rows.empty()) return;
+
+	if (list_count == 0) list_count = static_cast<size_t>(std::lround(std::sqrt(static_cast<double>(rows.size()))));
+	list_count = std::clamp<size_t>(list_count, 1, rows.size());
+
+	// Seed the centroids with distinct rows, picked with a fixed seed so builds are reproducible
+	std::vector<size_t> order(rows.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::shuffle(order.begin(), order.end(), std::mt19937(0));
+	this->_centroids.reserve(list_count);
+	for (size_t i = 0; i < list_count; i++) this->_centroids.push_back(rows[order[i]]);
+
+	std::vector<uint32_t> assignments(rows.size());
+	std::vector<float> distances(list_count);
+	std::vector<std::array<double, columnar_analysis_t::vector_size>> sums(list_count);
+	std::vector<size_t> counts(list_count);
+
+	for (unsigned int iteration = 0; iteration <= iterations; iteration++)
+	{
+		for (size_t i = 0; i < rows.size(); i++)
+		{
+			assignments[i] = static_cast<uint32_t>(nearest(rows[i], this->_centroids, distances));
+		}
+		// The last pass only assigns rows to the final centroids
+		if (iteration == iterations) break;
+
+		std::fill(sums.begin(), sums.end(), std::array<double, columnar_analysis_t::vector_size>{});
+		std::fill(counts.begin(), counts.end(), 0);
+		for (size_t i = 0; i < rows.size(); i++)
+		{
+			auto &sum = sums[assignments[i]];
+			for (size_t j = 0; j < sum.size(); j++) sum[j] += rows[i][j];
+			counts[assignments[i]]++;
+		}
+		// A list that lost all of its rows keeps its old centroid
+		for (size_t list = 0; list < list_count; list++)
+		{
+			if (counts[list] == 0) continue;
+			for (size_t j = 0; j < sums[list].size(); j++)
+			{
+				this->_centroids[list][j] = static_cast<float>(sums[list][j] / static_cast<double>(counts[list]));
+			}
+		}
+	}
+
+	// Group the rows by list so every list can be scanned as one contiguous block
+	this->_offsets.assign(list_count + 1, 0);
+	for (uint32_t list : assignments) this->_offsets[list + 1]++;
+	std::partial_sum(this->_offsets.begin(), this->_offsets.end(), this->_offsets.begin());
+
+	this->_rows.resize(rows.size());
+	this->_indexes.resize(rows.size());
+	std::vector<size_t> cursors(this->_offsets.begin(), this->_offsets.end() - 1);
+	for (size_t i = 0; i < rows.size(); i++)
+	{
+		size_t position = cursors[assignments[i]]++;
+		this->_rows[position] = rows[i];
+		this->_indexes[position] = i;
+	}
+}
+
+std::vector<feature_index_t::neighbor_t> feature_index_t::search(const feature_matrix_t::row_t &query, size_t count, size_t probe_count, size_t exclude) const
+{
+	std::vector<neighbor_t> neighbors;
+	if (this->_centroids.empty() || count == 0) return neighbors;
+
+	std::vector<float> distances(this->_centroids.size());
+	analysis_kernels::distances(query, this->_centroids, distances);
+
+	std::vector<size_t> lists(this->_centroids.size());
+	std::iota(lists.begin(), lists.end(), 0);
+	probe_count = std::clamp<size_t>(probe_count, 1, lists.size());
+	std::partial_sort(lists.begin(), lists.begin() + probe_count, lists.end(), [&distances](size_t lhs, size_t rhs) {
+		return distances[lhs] < distances[rhs];
+	});
+
+	for (size_t probe = 0; probe < probe_count; probe++)
+	{
+		size_t first = this->_offsets[lists[probe]];
+		size_t last = this->_offsets[lists[probe] + 1];
+		std::span<const feature_matrix_t::row_t> block(this->_rows.data() + first, last - first);
+
+		if (distances.size() < block.size()) distances.resize(block.size());
+		analysis_kernels::distances(query, block, distances);
+		for (size_t i = 0; i < block.size(); i++)
+		{
+			if (this->_indexes[first + i] == exclude) continue;
+			neighbors.push_back(neighbor_t{this->_indexes[first + i], distances[i]});
+		}
+	}
+
+	auto closer = [](const neighbor_t &lhs, const neighbor_t &rhs) { return lhs.distance < rhs.distance; };
+	if (neighbors.size() > count)
+	{
+		std::partial_sort(neighbors.begin(), neighbors.begin() + count, neighbors.end(), closer);
+		neighbors.resize(count);
+	}
+	else
+	{
+		std::sort(neighbors.begin(), neighbors.end(), closer);
+	}
+	return neighbors;
+}
+
+} // namespace spotify_api
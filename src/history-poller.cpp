@@ -0,0 +1,193 @@
+#include "history-poller.hpp"
+#include "endpoints/common.hpp"
+#include "curl-util.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#include <nlohmann/json.hpp>
+
+namespace json = nlohmann;
+
+namespace spotify_api
+{
+
+namespace
+{
+	/// The largest page /me/player/recently-played returns
+	constexpr int page_size = 50;
+
+	/// How long plays are remembered for deduplication. Plays older than the cursor can not come back,
+	/// so this only has to cover plays with the same timestamp on both sides of a poll.
+	constexpr int64_t dedup_window_ms = 60 * 60 * 1000;
+
+	std::string play_key(const recently_played_poller_t::play_t &play) { return play.played_at + ' ' + play.track_uri; }
+} // namespace
+
+std::optional<int64_t> recently_played_poller_t::parse_timestamp(std::string_view timestamp)
+{
+	int year, month, day, hour, minute;
+	double second;
+	char zone = 0;
+	std::string text(timestamp);
+	if (std::sscanf(text.c_str(), "%d-%d-%dT%d:%d:%lf%c", &year, &month, &day, &hour, &minute, &second, &zone) < 6) return std::nullopt;
+	if (zone != 0 && zone != 'Z') return std::nullopt;
+
+	std::chrono::year_month_day date{std::chrono::year(year), std::chrono::month(month), std::chrono::day(day)};
+	if (!date.ok()) return std::nullopt;
+
+	int64_t days = std::chrono::sys_days(date).time_since_epoch().count();
+	return ((days * 24 + hour) * 60 + minute) * 60000 + static_cast<int64_t>(second * 1000 + 0.5);
+}
+
+std::unique_ptr<recently_played_poller_t> recently_played_poller_t::open(const std::filesystem::path &log_path)
+{
+	auto poller = std::make_unique<recently_played_poller_t>();
+
+	for (const play_t &play : read_log(log_path))
+	{
+		poller->_play_count++;
+		poller->_cursor = std::max(poller->_cursor, play.played_at_ms);
+		poller->_seen_order.emplace_back(play.played_at_ms, play_key(play));
+	}
+	poller->forget_before(poller->_cursor - dedup_window_ms);
+	for (const auto &[time, key] : poller->_seen_order) poller->_seen.insert(key);
+
+	poller->_log = std::fopen(log_path.string().c_str(), "ab");
+	if (!poller->_log)
+	{
+		std::cerr << "Could not open the listening history log " << log_path << std::endl;
+		return nullptr;
+	}
+	return poller;
+}
+
+recently_played_poller_t::~recently_played_poller_t()
+{
+	if (this->_log) std::fclose(this->_log);
+}
+
+std::vector<recently_played_poller_t::play_t> recently_played_poller_t::read_log(const std::filesystem::path &log_path)
+{
+	std::vector<play_t> plays;
+	std::ifstream file(log_path);
+
+	// A crash while appending can only leave the last line incomplete, which fails to parse and is skipped
+	std::string line;
+	while (std::getline(file, line))
+	{
+		json::json entry = json::json::parse(line, nullptr, false);
+		if (entry.is_discarded() || !entry.is_object()) continue;
+
+		play_t play;
+		play.played_at = entry.value("played_at", "");
+		play.track_uri = entry.value("track", "");
+		play.context_uri = entry.value("context", "");
+		auto time = parse_timestamp(play.played_at);
+		if (!time || play.track_uri.empty()) continue;
+
+		play.played_at_ms = *time;
+		plays.push_back(std::move(play));
+	}
+	return plays;
+}
+
+bool recently_played_poller_t::record(const play_t &play)
+{
+	std::string key = play_key(play);
+	if (!this->_seen.insert(key).second) return false;
+	this->_seen_order.emplace_back(play.played_at_ms, std::move(key));
+
+	if (this->_log)
+	{
+		json::json entry = {{"played_at", play.played_at}, {"track", play.track_uri}};
+		if (!play.context_uri.empty()) entry["context"] = play.context_uri;
+
+		std::string line = entry.dump() + '\n';
+		if (std::fwrite(line.data(), 1, line.size(), this->_log) != line.size())
+		{
+			std::cerr << "Could not write to the listening history log" << std::endl;
+		}
+	}
+
+	this->_play_count++;
+	return true;
+}
+
+void recently_played_poller_t::forget_before(int64_t time_ms)
+{
+	while (!this->_seen_order.empty() && this->_seen_order.front().first < time_ms)
+	{
+		this->_seen.erase(this->_seen_order.front().second);
+		this->_seen_order.pop_front();
+	}
+}
+
+recently_played_poller_t::result_t recently_played_poller_t::poll(const std::string &access_token)
+{
+	result_t result;
+
+	while (true)
+	{
+		std::string query_data = "limit=" + std::to_string(page_size) + "&after=" + std::to_string(this->_cursor);
+		auto response = http::get(API_PREFIX "/me/player/recently-played", query_data, access_token);
+		result.requests++;
+		if (response.code != 200)
+		{
+			result.succeeded = false;
+			break;
+		}
+
+		json::json page = json::json::parse(response.body, nullptr, false);
+		if (page.is_discarded() || !page.contains("items"))
+		{
+			result.succeeded = false;
+			break;
+		}
+
+		std::vector<play_t> plays;
+		for (const auto &item : page["items"])
+		{
+			play_t play;
+			play.played_at = item.value("played_at", "");
+			auto time = parse_timestamp(play.played_at);
+			if (!time || !item.contains("track") || !item["track"].is_object()) continue;
+
+			play.played_at_ms = *time;
+			play.track_uri = item["track"].value("uri", "");
+			if (item.contains("context") && item["context"].is_object()) play.context_uri = item["context"].value("uri", "");
+			play.track = track_t::from_json(item["track"]);
+			plays.push_back(std::move(play));
+		}
+
+		// Spotify lists the newest play first, the log is kept oldest first
+		std::sort(plays.begin(), plays.end(), [](const play_t &a, const play_t &b) { return a.played_at_ms < b.played_at_ms; });
+
+		int64_t newest = this->_cursor;
+		for (play_t &play : plays)
+		{
+			newest = std::max(newest, play.played_at_ms);
+			if (this->record(play)) result.plays.push_back(std::move(play));
+		}
+		if (this->_log) std::fflush(this->_log);
+
+		// The "after" cursor is the time of the newest play in the page, sent as a string
+		if (page.contains("cursors") && page["cursors"].is_object() && page["cursors"].contains("after") && page["cursors"]["after"].is_string())
+		{
+			newest = std::max(newest, static_cast<int64_t>(std::stoll(page["cursors"]["after"].get<std::string>())));
+		}
+
+		// Stop when the page was not full, or when the cursor would not move forward
+		bool full_page = page["items"].size() >= static_cast<size_t>(page_size);
+		if (newest <= this->_cursor) break;
+		this->_cursor = newest;
+		if (!full_page) break;
+	}
+
+	this->forget_before(this->_cursor - dedup_window_ms);
+	return result;
+}
+
+} // namespace spotify_api
@@ -0,0 +1,272 @@
+#include "library-sync.hpp"
+#include "endpoints/common.hpp"
+#include "curl-util.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <unordered_set>
+
+namespace json = nlohmann;
+
+namespace spotify_api
+{
+
+namespace
+{
+	/// The largest page /me/tracks and /me/albums return
+	constexpr size_t page_size = 50;
+
+	template <class T>
+	struct saved_endpoint_t;
+
+	template <>
+	struct saved_endpoint_t<track_t>
+	{
+		static constexpr const char *url = API_PREFIX "/me/tracks";
+		static constexpr const char *key = "track";
+	};
+
+	template <>
+	struct saved_endpoint_t<album_t>
+	{
+		static constexpr const char *url = API_PREFIX "/me/albums";
+		static constexpr const char *key = "album";
+	};
+
+	constexpr int state_version = 1;
+} // namespace
+
+template <class T>
+typename library_sync_t<T>::page_result_t library_sync_t<T>::fetch_page(const std::string &access_token, const std::string &market, size_t offset)
+{
+	page_result_t page;
+
+	std::string query_data = "limit=" + std::to_string(page_size) + "&offset=" + std::to_string(offset);
+	if (!market.empty()) query_data += "&market=" + market;
+
+	auto response = http::get(saved_endpoint_t<T>::url, query_data, access_token);
+	if (response.code != 200) return page;
+
+	try
+	{
+		json::json page_json = json::json::parse(response.body);
+		page.total = page_json.at("total").get<int>();
+		page.has_next = !page_json["next"].is_null();
+
+		const json::json &items = page_json.at("items");
+		page.entries.reserve(items.size());
+		for (const auto &item : items)
+		{
+			const json::json &object = item.at(saved_endpoint_t<T>::key);
+			auto id = spotify_id_t::from_base62(object.value("id", ""));
+			if (!id) continue;
+
+			page.entries.push_back(entry_t{*id, item.value("added_at", ""), std::shared_ptr<const T>(T::from_json(object))});
+		}
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << "Failed to read a page of " << saved_endpoint_t<T>::url << ": " << e.what() << std::endl;
+		return page;
+	}
+
+	page.succeeded = true;
+	return page;
+}
+
+template <class T>
+typename library_sync_t<T>::result_t library_sync_t<T>::sync(const std::string &access_token, const std::string &market, bool force_reconcile)
+{
+	result_t result;
+
+	bool reconcile_due = std::chrono::system_clock::now() - this->_last_reconcile >= this->reconcile_interval;
+	if (!force_reconcile && !reconcile_due && !this->_entries.empty())
+	{
+		if (this->update(access_token, market, result) || !result.succeeded) return result;
+	}
+
+	result.succeeded = this->reconcile(access_token, market, result);
+	return result;
+}
+
+/**
+ * Reads pages newest first until reaching an item that is already mirrored, then merges the new items in.
+ * Returns false without changing anything if the merged mirror does not add up to the total Spotify reports,
+ * which means that items were removed (or that the request failed) and the library has to be reconciled.
+ */
+template <class T>
+bool library_sync_t<T>::update(const std::string &access_token, const std::string &market, result_t &result)
+{
+	std::vector<entry_t> fresh;
+	std::unordered_set<spotify_id_t> fresh_ids;
+	int total = 0;
+
+	for (size_t offset = 0;; offset += page_size)
+	{
+		page_result_t page = fetch_page(access_token, market, offset);
+		result.requests++;
+		if (!page.succeeded)
+		{
+			result.succeeded = false;
+			return false;
+		}
+		total = page.total;
+
+		bool reached_known = false;
+		for (entry_t &entry : page.entries)
+		{
+			// A saved item that was removed and saved again comes back with a new added_at
+			auto known = this->_positions.find(entry.id);
+			if (known != this->_positions.end() && this->_entries[known->second].added_at == entry.added_at)
+			{
+				reached_known = true;
+				break;
+			}
+			if (fresh_ids.insert(entry.id).second) fresh.push_back(std::move(entry));
+		}
+
+		if (reached_known || !page.has_next) break;
+	}
+
+	size_t kept = 0;
+	for (const entry_t &entry : this->_entries) kept += !fresh_ids.contains(entry.id);
+	if (fresh.size() + kept != static_cast<size_t>(total)) return false;
+
+	std::vector<entry_t> merged = fresh;
+	merged.reserve(fresh.size() + kept);
+	for (entry_t &entry : this->_entries)
+	{
+		if (!fresh_ids.contains(entry.id)) merged.push_back(std::move(entry));
+	}
+
+	this->_entries = std::move(merged);
+	this->rebuild_positions();
+	result.added = std::move(fresh);
+	return true;
+}
+
+template <class T>
+bool library_sync_t<T>::reconcile(const std::string &access_token, const std::string &market, result_t &result)
+{
+	result.reconciled = true;
+
+	std::vector<entry_t> library;
+	std::unordered_set<spotify_id_t> library_ids;
+	for (size_t offset = 0;; offset += page_size)
+	{
+		page_result_t page = fetch_page(access_token, market, offset);
+		result.requests++;
+		if (!page.succeeded) return false;
+
+		// Items saved while paging shift the later pages, so the same item can show up twice
+		for (entry_t &entry : page.entries)
+		{
+			if (library_ids.insert(entry.id).second) library.push_back(std::move(entry));
+		}
+		if (!page.has_next || page.entries.empty()) break;
+	}
+
+	for (const entry_t &entry : library)
+	{
+		auto known = this->_positions.find(entry.id);
+		if (known == this->_positions.end() || this->_entries[known->second].added_at != entry.added_at) result.added.push_back(entry);
+	}
+	for (const entry_t &entry : this->_entries)
+	{
+		if (!library_ids.contains(entry.id)) result.removed.push_back(entry.id);
+	}
+
+	this->_entries = std::move(library);
+	this->rebuild_positions();
+	this->_last_reconcile = std::chrono::system_clock::now();
+	return true;
+}
+
+template <class T>
+void library_sync_t<T>::rebuild_positions()
+{
+	this->_positions.clear();
+	this->_positions.reserve(this->_entries.size());
+	for (size_t i = 0; i < this->_entries.size(); i++) this->_positions.emplace(this->_entries[i].id, i);
+}
+
+template <class T>
+bool library_sync_t<T>::save(const std::filesystem::path &path) const
+{
+	json::json entries = json::json::array();
+	for (const entry_t &entry : this->_entries) entries.push_back({entry.id.to_string(), entry.added_at});
+
+	json::json state = {
+		{"version", state_version},
+		{"last_reconcile", std::chrono::duration_cast<std::chrono::seconds>(this->_last_reconcile.time_since_epoch()).count()},
+		{"entries", std::move(entries)},
+	};
+
+	// Write next to the old file and swap them, so a crash never leaves half a state behind
+	std::filesystem::path temporary = path;
+	temporary += ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		file << state.dump();
+		if (!file.good())
+		{
+			std::cerr << "Could not write the sync state to " << temporary << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error)
+	{
+		std::cerr << "Could not replace the sync state at " << path << ": " << error.message() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+template <class T>
+bool library_sync_t<T>::load(const std::filesystem::path &path)
+{
+	std::vector<entry_t> entries;
+	std::chrono::system_clock::time_point last_reconcile;
+
+	try
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			std::cerr << "Could not open the sync state at " << path << std::endl;
+			return false;
+		}
+
+		json::json state = json::json::parse(file);
+		if (state.at("version").get<int>() != state_version)
+		{
+			std::cerr << "Unsupported sync state version in " << path << std::endl;
+			return false;
+		}
+
+		last_reconcile = std::chrono::system_clock::time_point(std::chrono::seconds(state.at("last_reconcile").get<int64_t>()));
+		for (const auto &entry : state.at("entries"))
+		{
+			auto id = spotify_id_t::from_base62(entry.at(0).get<std::string>());
+			if (id) entries.push_back(entry_t{*id, entry.at(1).get<std::string>(), nullptr});
+		}
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << "Could not read the sync state at " << path << ": " << e.what() << std::endl;
+		return false;
+	}
+
+	this->_entries = std::move(entries);
+	this->_last_reconcile = last_reconcile;
+	this->rebuild_positions();
+	return true;
+}
+
+template class library_sync_t<track_t>;
+template class library_sync_t<album_t>;
+
+} // namespace spotify_api
@@ -0,0 +1,50 @@
+#include "multi-get.hpp"
+
+#include <chrono>
+
+namespace spotify_api
+{
+
+static std::atomic<size_t> parallelism = 4;
+
+size_t multi_get_parallelism()
+{
+	return parallelism.load(std::memory_order_relaxed);
+}
+
+void set_multi_get_parallelism(size_t value)
+{
+	parallelism.store(std::max<size_t>(value, 1), std::memory_order_relaxed);
+}
+
+static constexpr std::chrono::milliseconds first_delay(500);
+static constexpr std::chrono::milliseconds max_delay(8000);
+
+static int64_t now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void request_backoff_t::wait() const
+{
+	int64_t remaining = this->_resume_at_ns.load() - now_ns();
+	if (remaining > 0) std::this_thread::sleep_for(std::chrono::nanoseconds(remaining));
+}
+
+void request_backoff_t::failed()
+{
+	int failures = std::min(this->_failures++, 4);
+	std::chrono::nanoseconds delay = std::min<std::chrono::nanoseconds>(first_delay * (1 << failures), max_delay);
+	int64_t resume_at = now_ns() + delay.count();
+
+	// Only ever push the resume time later
+	int64_t current = this->_resume_at_ns.load();
+	while (current < resume_at && !this->_resume_at_ns.compare_exchange_weak(current, resume_at));
+}
+
+void request_backoff_t::succeeded()
+{
+	this->_failures = 0;
+}
+
+} // namespace spotify_api
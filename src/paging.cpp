@@ -0,0 +1,50 @@
+#include "paging.hpp"
+#include "curl-util.hpp"
+
+#include <iostream>
+
+namespace spotify_api
+{
+
+std::optional<nlohmann::json> fetch_page_json(const std::string &url, const std::string &query_data, const std::string &access_token, request_backoff_t &backoff, const char *page_key)
+{
+	for (int attempt = 0; attempt < max_request_attempts; attempt++)
+	{
+		backoff.wait();
+
+		http::api_response response;
+		try
+		{
+			response = http::get(url.c_str(), query_data, access_token);
+		}
+		catch (const char *error)
+		{
+			std::cerr << "Failed to request " << url << ": " << error << std::endl;
+			backoff.failed();
+			continue;
+		}
+
+		// Rate limited, or a server error that may go away
+		if (is_retryable_status(response.code))
+		{
+			backoff.failed();
+			continue;
+		}
+		if (response.code != 200)
+		{
+			std::cerr << "Failed to request " << url << ": " << response.code << std::endl;
+			return std::nullopt;
+		}
+
+		backoff.succeeded();
+		nlohmann::json page = nlohmann::json::parse(response.body, nullptr, false);
+		if (page_key != nullptr && page.is_object()) page = page.value(page_key, nlohmann::json());
+		if (!page.is_object()) return std::nullopt;
+		return page;
+	}
+
+	std::cerr << "Giving up on " << url << " after " << max_request_attempts << " attempts" << std::endl;
+	return std::nullopt;
+}
+
+} // namespace spotify_api
@@ -0,0 +1,69 @@
+#include "playback-progress.hpp"
+
+#include <algorithm>
+
+namespace spotify_api
+{
+
+void playback_progress_t::update(int64_t progress_ms, int64_t duration_ms, bool is_playing, steady_clock_t::time_point received)
+{
+	this->_duration_ms = std::max<int64_t>(duration_ms, 0);
+	this->_progress_ms = std::clamp<int64_t>(progress_ms, 0, this->_duration_ms);
+	this->_is_playing = is_playing;
+	this->_anchor = received;
+}
+
+void playback_progress_t::update(const playback_state_t &state, steady_clock_t::time_point received)
+{
+	if (!state.item)
+	{
+		this->clear();
+		return;
+	}
+	this->update(state.progress_ms, state.item->duration_ms, state.is_playing, received);
+}
+
+int64_t playback_progress_t::position_ms(steady_clock_t::time_point now) const
+{
+	if (!this->has_track()) return 0;
+	if (!this->_is_playing) return this->_progress_ms;
+
+	int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - this->_anchor).count();
+	return std::clamp<int64_t>(this->_progress_ms + elapsed, this->_progress_ms, this->_duration_ms);
+}
+
+double playback_progress_t::fraction(steady_clock_t::time_point now) const
+{
+	if (this->_duration_ms <= 0) return 0;
+	return static_cast<double>(this->position_ms(now)) / this->_duration_ms;
+}
+
+std::optional<playback_progress_t::steady_clock_t::time_point> playback_progress_t::track_end() const
+{
+	if (!this->is_playing()) return std::nullopt;
+	return this->_anchor + std::chrono::milliseconds(this->_duration_ms - this->_progress_ms);
+}
+
+void playback_progress_t::pause(steady_clock_t::time_point now)
+{
+	if (!this->is_playing()) return;
+	this->_progress_ms = this->position_ms(now);
+	this->_is_playing = false;
+	this->_anchor = now;
+}
+
+void playback_progress_t::resume(steady_clock_t::time_point now)
+{
+	if (!this->has_track() || this->_is_playing) return;
+	this->_is_playing = true;
+	this->_anchor = now;
+}
+
+void playback_progress_t::seek(int64_t position_ms, steady_clock_t::time_point now)
+{
+	if (!this->has_track()) return;
+	this->_progress_ms = std::clamp<int64_t>(position_ms, 0, this->_duration_ms);
+	this->_anchor = now;
+}
+
+} // namespace spotify_api
@@ -0,0 +1,253 @@
+#include "playback-watcher.hpp"
+#include "endpoints/common.hpp"
+#include "curl-util.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace json = nlohmann;
+
+namespace spotify_api
+{
+
+playback_watcher_t::snapshot_t playback_watcher_t::snapshot_t::from_json(const json::json &json_obj, steady_clock_t::time_point received)
+{
+	snapshot_t snapshot;
+	snapshot.received = received;
+	if (!json_obj.is_object()) return snapshot;
+
+	snapshot.active = true;
+	snapshot.is_playing = json_obj.value("is_playing", false);
+	if (json_obj.contains("progress_ms") && json_obj["progress_ms"].is_number()) snapshot.progress_ms = json_obj["progress_ms"].get<int64_t>();
+	snapshot.shuffle_state = json_obj.value("shuffle_state", false);
+	snapshot.repeat_state = json_obj.value("repeat_state", "off");
+
+	// Null during ads, and for episodes unless they were asked for with additional_types
+	if (json_obj.contains("item") && json_obj["item"].is_object())
+	{
+		snapshot.track_uri = json_obj["item"].value("uri", "");
+		snapshot.duration_ms = json_obj["item"].value("duration_ms", 0);
+	}
+	if (json_obj.contains("context") && json_obj["context"].is_object()) snapshot.context_uri = json_obj["context"].value("uri", "");
+	if (json_obj.contains("device") && json_obj["device"].is_object())
+	{
+		const json::json &device = json_obj["device"];
+		if (device.contains("id") && device["id"].is_string()) snapshot.device_id = device["id"].get<std::string>();
+		if (device.contains("volume_percent") && device["volume_percent"].is_number()) snapshot.volume_percent = device["volume_percent"].get<int>();
+	}
+	return snapshot;
+}
+
+playback_watcher_t::~playback_watcher_t()
+{
+	this->stop();
+}
+
+playback_watcher_t::result_t playback_watcher_t::poll(const std::string &access_token)
+{
+	return this->poll(access_token, steady_clock_t::now());
+}
+
+playback_watcher_t::result_t playback_watcher_t::poll(const std::string &access_token, steady_clock_t::time_point now)
+{
+	result_t result;
+
+	// 204 means that nothing is playing on any device
+	http::api_response response{0, ""};
+	try
+	{
+		response = http::get(API_PREFIX "/me/player", std::string(""), access_token);
+	}
+	catch (const char *error)
+	{
+		// A network error counts as a failed poll, like an error response
+		std::cerr << "Failed to poll the playback state: " << error << std::endl;
+	}
+	json::json state_json;
+	if (response.code == 200)
+	{
+		state_json = json::json::parse(response.body, nullptr, false);
+		if (state_json.is_discarded()) response.code = 0;
+	}
+
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	if (response.code != 200 && response.code != 204)
+	{
+		this->_failed = true;
+		result.succeeded = false;
+		return result;
+	}
+
+	snapshot_t current = snapshot_t::from_json(state_json, now);
+	this->compare(this->_state, current, state_json, result.events);
+	if (current.active && !current.track_uri.empty()) this->_progress.update(current.progress_ms, current.duration_ms, current.is_playing, now);
+	else this->_progress.clear();
+	this->_state = std::move(current);
+	this->_failed = false;
+	return result;
+}
+
+void playback_watcher_t::compare(const snapshot_t &previous, const snapshot_t &current, const json::json &json_obj, std::vector<event_t> &events) const
+{
+	auto emit = [&](event_type_t type) { events.push_back(event_t{type, previous, current, nullptr}); };
+	auto decode_track = [&]() -> std::shared_ptr<track_t> {
+		if (!json_obj.contains("item") || !json_obj["item"].is_object() || json_obj["item"].value("type", "") != "track") return nullptr;
+		return track_t::from_json(json_obj["item"]);
+	};
+
+	if (!previous.active && !current.active) return;
+	if (!current.active)
+	{
+		emit(event_type_t::STOPPED);
+		return;
+	}
+	if (!previous.active)
+	{
+		emit(event_type_t::STARTED);
+		events.back().track = decode_track();
+		return;
+	}
+
+	if (previous.device_id != current.device_id) emit(event_type_t::DEVICE_CHANGED);
+	else if (previous.volume_percent != current.volume_percent) emit(event_type_t::VOLUME_CHANGED);
+
+	if (previous.context_uri != current.context_uri) emit(event_type_t::CONTEXT_CHANGED);
+
+	if (previous.track_uri != current.track_uri)
+	{
+		emit(event_type_t::TRACK_CHANGED);
+		events.back().track = decode_track();
+	}
+	else
+	{
+		// The progress moves on for as long as the track played between the two polls, which is somewhere
+		// between not at all and the whole time when it was paused or resumed in between
+		int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(current.received - previous.received).count();
+		int64_t latest = previous.is_playing || current.is_playing ? previous.progress_ms + std::max<int64_t>(elapsed, 0) : previous.progress_ms;
+		int64_t earliest = previous.is_playing && current.is_playing ? latest : previous.progress_ms;
+		int64_t tolerance = this->options.seek_tolerance.count();
+		if (current.progress_ms < earliest - tolerance || current.progress_ms > latest + tolerance) emit(event_type_t::SEEKED);
+	}
+
+	if (previous.is_playing && !current.is_playing) emit(event_type_t::PAUSED);
+	else if (!previous.is_playing && current.is_playing) emit(event_type_t::RESUMED);
+
+	if (previous.shuffle_state != current.shuffle_state) emit(event_type_t::SHUFFLE_CHANGED);
+	if (previous.repeat_state != current.repeat_state) emit(event_type_t::REPEAT_CHANGED);
+}
+
+std::chrono::milliseconds playback_watcher_t::next_interval() const
+{
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	const snapshot_t &state = this->_state;
+	// Measured against the clock rather than the last state, which does not move on while polls fail
+	// and falls behind while event handlers run
+	auto now = steady_clock_t::now();
+	if (now < this->_fast_until) return this->options.fast_interval;
+	if (this->_failed || !state.active) return this->options.idle_interval;
+	if (!state.is_playing) return this->options.paused_interval;
+
+	// Wake up just after the track ends, to report the next one without waiting for a whole interval
+	auto track_end = this->_progress.track_end();
+	if (track_end)
+	{
+		auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(*track_end - now) + this->options.track_end_margin;
+		return std::clamp(remaining, this->options.fast_interval, this->options.playing_interval);
+	}
+	return this->options.playing_interval;
+}
+
+playback_watcher_t::snapshot_t playback_watcher_t::last_state() const
+{
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	return this->_state;
+}
+
+playback_progress_t playback_watcher_t::progress() const
+{
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	return this->_progress;
+}
+
+void playback_watcher_t::notify_command()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		this->_fast_until = steady_clock_t::now() + this->options.command_window;
+		this->_woken = true;
+	}
+	this->_wake.notify_all();
+}
+
+bool playback_watcher_t::start(const std::string &access_token, std::function<void(const event_t &)> on_event)
+{
+	if (this->_thread.joinable()) return false;
+
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		this->_access_token = access_token;
+		this->_stopping = false;
+	}
+	this->_thread = std::thread(&playback_watcher_t::run_loop, this, std::move(on_event));
+	return true;
+}
+
+void playback_watcher_t::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		this->_stopping = true;
+	}
+	this->_wake.notify_all();
+	if (this->_thread.joinable()) this->_thread.join();
+}
+
+void playback_watcher_t::set_access_token(const std::string &access_token)
+{
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	this->_access_token = access_token;
+}
+
+void playback_watcher_t::run_loop(std::function<void(const event_t &)> on_event)
+{
+	while (true)
+	{
+		std::string access_token;
+		{
+			std::lock_guard<std::mutex> lock(this->_mutex);
+			if (this->_stopping) return;
+			access_token = this->_access_token;
+			this->_woken = false;
+		}
+
+		result_t result;
+		try
+		{
+			result = this->poll(access_token);
+		}
+		catch (...)
+		{
+			std::cerr << "Playback poll failed" << std::endl;
+			std::lock_guard<std::mutex> lock(this->_mutex);
+			this->_failed = true;
+		}
+		for (const event_t &event : result.events)
+		{
+			try
+			{
+				on_event(event);
+			}
+			catch (const std::exception &e)
+			{
+				std::cerr << "Playback event handler failed: " << e.what() << std::endl;
+			}
+		}
+
+		auto interval = this->next_interval();
+		std::unique_lock<std::mutex> lock(this->_mutex);
+		this->_wake.wait_for(lock, interval, [this] { return this->_stopping || this->_woken; });
+	}
+}
+
+} // namespace spotify_api
@@ -0,0 +1,329 @@
+#include "player-commands.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace spotify_api
+{
+
+player_command_coalescer_t::player_command_coalescer_t(const std::string &access_token):
+	player_command_coalescer_t(access_token, options_t())
+{
+}
+
+player_command_coalescer_t::player_command_coalescer_t(const std::string &access_token, options_t options):
+	_options(std::move(options)), _access_token(access_token)
+{
+	size_t threads = std::max<size_t>(this->_options.threads, 1);
+	for (size_t i = 0; i < threads; i++) this->_threads.emplace_back(&player_command_coalescer_t::send_loop, this);
+}
+
+player_command_coalescer_t::~player_command_coalescer_t()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		this->_stopping = true;
+	}
+	this->_schedule_signal.notify_all();
+	for (std::thread &thread : this->_threads) thread.join();
+}
+
+void player_command_coalescer_t::set_volume(int volume_percent, const std::string &device_id)
+{
+	this->submit(command_type_t::VOLUME, device_id, std::clamp(volume_percent, 0, 100));
+}
+
+void player_command_coalescer_t::seek_to_position(int position_ms, const std::string &device_id)
+{
+	this->submit(command_type_t::SEEK, device_id, std::max(position_ms, 0));
+}
+
+void player_command_coalescer_t::set_shuffle(bool state, const std::string &device_id)
+{
+	this->submit(command_type_t::SHUFFLE, device_id, state);
+}
+
+void player_command_coalescer_t::set_repeat_mode(Player_API::REPEAT_MODE state, const std::string &device_id)
+{
+	this->submit(command_type_t::REPEAT, device_id, static_cast<int>(state));
+}
+
+void player_command_coalescer_t::set_access_token(const std::string &access_token)
+{
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	this->_access_token = access_token;
+}
+
+void player_command_coalescer_t::flush()
+{
+	std::unique_lock<std::mutex> lock(this->_mutex);
+	this->_idle_signal.wait(lock, [this] { return this->_schedule.empty() && this->_in_flight == 0; });
+}
+
+player_command_coalescer_t::stats_t player_command_coalescer_t::stats() const
+{
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	return this->_stats;
+}
+
+void player_command_coalescer_t::submit(command_type_t type, const std::string &device_id, int value)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		key_t key(type, device_id);
+		slot_t &slot = this->_slots[key];
+
+		this->_stats.submitted++;
+		if (slot.pending && !slot.retrying) this->_stats.coalesced++;
+		slot.pending = value;
+		slot.retrying = false;
+
+		// A slot in flight is scheduled again when its request returns
+		if (slot.in_flight || slot.scheduled) return;
+		this->schedule(key, slot, slot.last_sent + this->_options.min_interval);
+	}
+	this->_schedule_signal.notify_one();
+}
+
+void player_command_coalescer_t::schedule(const key_t &key, slot_t &slot, std::chrono::steady_clock::time_point not_before)
+{
+	slot.scheduled = true;
+	this->_schedule.emplace(std::max(not_before, std::chrono::steady_clock::now()), key);
+}
+
+void player_command_coalescer_t::send_loop()
+{
+	std::unique_lock<std::mutex> lock(this->_mutex);
+	while (true)
+	{
+		if (this->_stopping) return;
+		if (this->_schedule.empty())
+		{
+			this->_schedule_signal.wait(lock);
+			continue;
+		}
+
+		auto next = this->_schedule.begin();
+		if (next->first > std::chrono::steady_clock::now())
+		{
+			this->_schedule_signal.wait_until(lock, next->first);
+			continue;
+		}
+
+		key_t key = next->second;
+		this->_schedule.erase(next);
+		slot_t &slot = this->_slots[key];
+		int value = *slot.pending;
+		bool retry = slot.retrying;
+		slot.pending.reset();
+		slot.retrying = false;
+		slot.scheduled = false;
+		slot.in_flight = true;
+		this->_in_flight++;
+		std::string access_token = this->_access_token;
+
+		lock.unlock();
+		// http::request throws a const char* on network errors, which counts as a failed command
+		bool succeeded = false;
+		try
+		{
+			succeeded = this->send(key.first, key.second, value, access_token);
+		}
+		catch (...)
+		{
+			std::cerr << "Player command failed to send" << std::endl;
+		}
+		try
+		{
+			if (this->_options.on_sent) this->_options.on_sent(key.first, key.second, succeeded);
+		}
+		catch (...)
+		{
+			std::cerr << "Player command callback failed" << std::endl;
+		}
+		lock.lock();
+
+		slot.in_flight = false;
+		slot.last_sent = std::chrono::steady_clock::now();
+		this->_in_flight--;
+		this->_stats.sent++;
+		if (!succeeded)
+		{
+			this->_stats.failed++;
+			// Retry once, unless a newer value came in meanwhile
+			if (!retry && !slot.pending)
+			{
+				slot.pending = value;
+				slot.retrying = true;
+				this->schedule(key, slot, slot.last_sent + this->_options.retry_delay);
+			}
+		}
+		if (slot.pending && !slot.scheduled) this->schedule(key, slot, slot.last_sent + this->_options.min_interval);
+
+		this->_schedule_signal.notify_one();
+		this->_idle_signal.notify_all();
+	}
+}
+
+bool player_command_coalescer_t::send(command_type_t type, const std::string &device_id, int value, const std::string &access_token) const
+{
+	Player_API player(access_token);
+	switch (type)
+	{
+	using enum command_type_t;
+	case VOLUME:
+		return player.set_volume(value, device_id);
+
+	case SEEK:
+		return player.seek_to_position(value, device_id);
+
+	case SHUFFLE:
+		return player.set_shuffle(value != 0, device_id);
+
+	case REPEAT:
+		return player.set_repeat_mode(static_cast<Player_API::REPEAT_MODE>(value), device_id);
+	}
+	return false;
+}
+
+player_command_queue_t::player_command_queue_t(const std::string &access_token, size_t threads):
+	_access_token(access_token)
+{
+	threads = std::max<size_t>(threads, 1);
+	for (size_t i = 0; i < threads; i++) this->_threads.emplace_back(&player_command_queue_t::send_loop, this);
+}
+
+player_command_queue_t::~player_command_queue_t()
+{
+	this->flush();
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		this->_stopping = true;
+	}
+	this->_ready_signal.notify_all();
+	for (std::thread &thread : this->_threads) thread.join();
+}
+
+std::future<bool> player_command_queue_t::start_or_resume_playback(const std::string &context_uri, const std::vector<std::string> &uris, int offset, int position_ms, const std::string &device_id, callback_t on_done)
+{
+	return this->enqueue(device_id, [=](Player_API &player) { return player.start_or_resume_playback(context_uri, uris, offset, position_ms, device_id); }, std::move(on_done));
+}
+
+std::future<bool> player_command_queue_t::pause_playback(const std::string &device_id, callback_t on_done)
+{
+	return this->enqueue(device_id, [=](Player_API &player) { return player.pause_playback(device_id); }, std::move(on_done));
+}
+
+std::future<bool> player_command_queue_t::skip_to_next(const std::string &device_id, callback_t on_done)
+{
+	return this->enqueue(device_id, [=](Player_API &player) { return player.skip_to_next(device_id); }, std::move(on_done));
+}
+
+std::future<bool> player_command_queue_t::skip_to_previous(const std::string &device_id, callback_t on_done)
+{
+	return this->enqueue(device_id, [=](Player_API &player) { return player.skip_to_previous(device_id); }, std::move(on_done));
+}
+
+std::future<bool> player_command_queue_t::add_item_to_playback_queue(const std::string &item_uri, const std::string &device_id, callback_t on_done)
+{
+	return this->enqueue(device_id, [=](Player_API &player) { return player.add_item_to_playback_queue(item_uri, device_id); }, std::move(on_done));
+}
+
+std::future<bool> player_command_queue_t::enqueue(const std::string &device_id, std::function<bool(Player_API &)> command, callback_t on_done)
+{
+	std::future<bool> result;
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		device_queue_t &device = this->_devices[device_id];
+		device.commands.push_back(command_t{std::move(command), std::promise<bool>(), std::move(on_done)});
+		result = device.commands.back().result.get_future();
+		this->_pending++;
+
+		// A device with a command in flight is made ready again when it returns
+		if (device.scheduled) return result;
+		device.scheduled = true;
+		this->_ready.push_back(device_id);
+	}
+	this->_ready_signal.notify_one();
+	return result;
+}
+
+void player_command_queue_t::set_access_token(const std::string &access_token)
+{
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	this->_access_token = access_token;
+}
+
+size_t player_command_queue_t::pending() const
+{
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	return this->_pending;
+}
+
+void player_command_queue_t::flush()
+{
+	std::unique_lock<std::mutex> lock(this->_mutex);
+	this->_idle_signal.wait(lock, [this] { return this->_pending == 0; });
+}
+
+void player_command_queue_t::send_loop()
+{
+	std::unique_lock<std::mutex> lock(this->_mutex);
+	while (true)
+	{
+		this->_ready_signal.wait(lock, [this] { return this->_stopping || !this->_ready.empty(); });
+		if (this->_ready.empty()) return;
+
+		std::string device_id = std::move(this->_ready.front());
+		this->_ready.pop_front();
+
+		// The device stays scheduled while its command is in flight, so no other thread sends it the next one
+		command_t command = std::move(this->_devices[device_id].commands.front());
+		this->_devices[device_id].commands.pop_front();
+		Player_API player(this->_access_token);
+
+		lock.unlock();
+		bool succeeded = false;
+		try
+		{
+			succeeded = command.send(player);
+		}
+		catch (const std::exception &e)
+		{
+			std::cerr << "Player command failed: " << e.what() << std::endl;
+		}
+		catch (...)
+		{
+			// http::request and http::post throw a const char* on network errors
+			std::cerr << "Player command failed to send" << std::endl;
+		}
+		command.result.set_value(succeeded);
+		try
+		{
+			if (command.on_done) command.on_done(succeeded);
+		}
+		catch (const std::exception &e)
+		{
+			std::cerr << "Player command callback failed: " << e.what() << std::endl;
+		}
+		catch (...)
+		{
+			std::cerr << "Player command callback failed" << std::endl;
+		}
+		lock.lock();
+
+		// Go to the back of the line, so that one busy device does not hold up the others
+		device_queue_t &device = this->_devices[device_id];
+		if (device.commands.empty()) this->_devices.erase(device_id);
+		else
+		{
+			this->_ready.push_back(device_id);
+			this->_ready_signal.notify_one();
+		}
+
+		this->_pending--;
+		this->_idle_signal.notify_all();
+	}
+}
+
+} // namespace spotify_api
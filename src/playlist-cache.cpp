@@ -0,0 +1,95 @@
+#include "playlist-cache.hpp"
+
+#include <mutex>
+
+#include "categories/albums.hpp"
+#include "categories/artists.hpp"
+
+namespace spotify_api
+{
+
+static void copy_artists(std::vector<std::shared_ptr<artist_t>> &artists)
+{
+	for (auto &artist : artists)
+	{
+		if (artist) artist = std::make_shared<artist_t>(*artist);
+	}
+}
+
+static std::shared_ptr<track_t> copy_track(const std::shared_ptr<track_t> &track)
+{
+	if (!track) return track;
+
+	auto copy = std::make_shared<track_t>(*track);
+	if (copy->album)
+	{
+		copy->album = std::make_shared<album_t>(*copy->album);
+		copy_artists(copy->album->artists);
+	}
+	copy_artists(copy->artists);
+	if (copy->linked_from && *copy->linked_from) copy->linked_from = copy_track(*copy->linked_from);
+	return copy;
+}
+
+std::unique_ptr<playlist_t> playlist_cache_t::copy(const playlist_t &playlist)
+{
+	auto copy = std::make_unique<playlist_t>(playlist);
+	for (auto &track : copy->tracks.items) track = copy_track(track);
+	return copy;
+}
+
+std::shared_ptr<const playlist_t> playlist_cache_t::find(const std::string &playlist_id, const std::string &market) const
+{
+	std::shared_lock<std::shared_mutex> read_lock(this->_mutex);
+	auto found = this->_playlists.find(playlist_id);
+	if (found == this->_playlists.end()) return std::shared_ptr<const playlist_t>(nullptr);
+	auto in_market = found->second.find(market);
+	if (in_market == found->second.end()) return std::shared_ptr<const playlist_t>(nullptr);
+	return in_market->second;
+}
+
+void playlist_cache_t::insert(const playlist_t &playlist, const std::string &market)
+{
+	if (playlist.id.empty()) return;
+
+	// Copied before taking the lock, the playlist may have thousands of tracks
+	std::shared_ptr<const playlist_t> stored = copy(playlist);
+
+	std::unique_lock<std::shared_mutex> write_lock(this->_mutex);
+	this->_playlists[stored->id][market] = std::move(stored);
+}
+
+void playlist_cache_t::erase(const std::string &playlist_id)
+{
+	std::unique_lock<std::shared_mutex> write_lock(this->_mutex);
+	this->_playlists.erase(playlist_id);
+}
+
+void playlist_cache_t::clear()
+{
+	std::unique_lock<std::shared_mutex> write_lock(this->_mutex);
+	this->_playlists.clear();
+}
+
+std::vector<std::shared_ptr<const playlist_t>> playlist_cache_t::playlists(const std::string &market) const
+{
+	std::shared_lock<std::shared_mutex> read_lock(this->_mutex);
+	std::vector<std::shared_ptr<const playlist_t>> output;
+	output.reserve(this->_playlists.size());
+	for (const auto &[id, markets] : this->_playlists)
+	{
+		auto in_market = markets.find(market);
+		if (in_market != markets.end()) output.push_back(in_market->second);
+	}
+	return output;
+}
+
+size_t playlist_cache_t::size() const
+{
+	std::shared_lock<std::shared_mutex> read_lock(this->_mutex);
+	size_t size = 0;
+	for (const auto &[id, markets] : this->_playlists) size += markets.size();
+	return size;
+}
+
+} // namespace spotify_api
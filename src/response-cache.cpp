@@ -0,0 +1,581 @@
+#include "response-cache.hpp"
+#include "categories/markets.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <zlib.h>
+
+namespace http
+{
+
+namespace
+{
+	constexpr uint32_t record_magic = 0x43525053; // "SPRC"
+	constexpr uint32_t tombstone_flag = 1;
+
+	/// Every record starts with this header, followed by the key and the compressed body.
+	struct record_header_t
+	{
+		uint32_t magic;
+		/// The CRC-32 of everything after this field, up to the end of the record
+		uint32_t checksum;
+		uint32_t key_size;
+		uint32_t value_size;
+		/// The size of the body before compression
+		uint32_t raw_size;
+		uint32_t flags;
+		/// Unix time in seconds
+		int64_t expires_at;
+	};
+
+	constexpr size_t checksum_offset = offsetof(record_header_t, checksum) + sizeof(uint32_t);
+
+	/// How much compaction copies before letting requests take the lock
+	constexpr uint64_t compaction_chunk_bytes = 256 << 10;
+
+	int64_t now()
+	{
+		return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	uint32_t checksum(const char *data, size_t size)
+	{
+		return crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef *>(data), size);
+	}
+
+	std::string make_record(const std::string &key, const std::string &value, uint32_t raw_size, int64_t expires_at, uint32_t flags)
+	{
+		record_header_t header = {record_magic, 0, static_cast<uint32_t>(key.size()), static_cast<uint32_t>(value.size()), raw_size, flags, expires_at};
+
+		std::string record(sizeof(header) + key.size() + value.size(), '\0');
+		std::memcpy(record.data(), &header, sizeof(header));
+		std::memcpy(record.data() + sizeof(header), key.data(), key.size());
+		std::memcpy(record.data() + sizeof(header) + key.size(), value.data(), value.size());
+
+		header.checksum = checksum(record.data() + checksum_offset, record.size() - checksum_offset);
+		std::memcpy(record.data(), &header, sizeof(header));
+		return record;
+	}
+
+	/**
+	 * @brief Checks the record at the start of `data`.
+	 * @returns The size of the record, or 0 if it is incomplete or corrupt
+	 */
+	size_t parse_record(const char *data, size_t size, record_header_t &header)
+	{
+		if (size < sizeof(header)) return 0;
+		std::memcpy(&header, data, sizeof(header));
+		if (header.magic != record_magic) return 0;
+
+		uint64_t record_size = sizeof(header) + uint64_t(header.key_size) + header.value_size;
+		if (record_size > size) return 0;
+		if (checksum(data + checksum_offset, record_size - checksum_offset) != header.checksum) return 0;
+		return record_size;
+	}
+
+	bool read_file(std::FILE *file, uint64_t offset, size_t size, std::string &output)
+	{
+		output.resize(size);
+		if (std::fseek(file, static_cast<long>(offset), SEEK_SET) != 0) return false;
+		return std::fread(output.data(), 1, size, file) == size;
+	}
+
+	// Splits a URL into its path and its query string, dropping the scheme and the host
+	std::pair<std::string_view, std::string_view> split_url(std::string_view url)
+	{
+		size_t scheme_end = url.find("://");
+		if (scheme_end != std::string_view::npos)
+		{
+			size_t path_start = url.find('/', scheme_end + 3);
+			url = (path_start == std::string_view::npos) ? std::string_view("/") : url.substr(path_start);
+		}
+
+		size_t query_start = url.find('?');
+		if (query_start == std::string_view::npos) return {url, {}};
+		return {url.substr(0, query_start), url.substr(query_start + 1)};
+	}
+
+	void split_parameters(std::string_view query, std::vector<std::string_view> &parameters)
+	{
+		while (!query.empty())
+		{
+			size_t end = query.find('&');
+			std::string_view parameter = query.substr(0, end);
+			while (!parameter.empty() && parameter.front() == '?') parameter.remove_prefix(1);
+			if (!parameter.empty()) parameters.push_back(parameter);
+			if (end == std::string_view::npos) break;
+			query.remove_prefix(end + 1);
+		}
+	}
+} // namespace
+
+response_cache_t::response_cache_t(const options_t &options) : _options(options) {}
+
+std::unique_ptr<response_cache_t> response_cache_t::open(const options_t &options)
+{
+	std::error_code error;
+	std::filesystem::create_directories(options.directory, error);
+	if (error)
+	{
+		std::cerr << "Could not create the response cache directory " << options.directory << ": " << error.message() << std::endl;
+		return nullptr;
+	}
+
+	std::unique_ptr<response_cache_t> cache(new response_cache_t(options));
+	if (!cache->load()) return nullptr;
+
+	cache->_compaction_thread = std::thread(&response_cache_t::compaction_loop, cache.get());
+	return cache;
+}
+
+response_cache_t::~response_cache_t()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		this->_stopping = true;
+	}
+	this->_compaction_signal.notify_all();
+	if (this->_compaction_thread.joinable()) this->_compaction_thread.join();
+
+	for (auto &[id, segment] : this->_segments)
+	{
+		if (segment.file) std::fclose(segment.file);
+	}
+}
+
+std::filesystem::path response_cache_t::segment_path(uint32_t id) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "segment-%08u.log", id);
+	return this->_options.directory / name;
+}
+
+bool response_cache_t::load()
+{
+	std::vector<uint32_t> ids;
+	std::error_code error;
+	for (const auto &file : std::filesystem::directory_iterator(this->_options.directory, error))
+	{
+		unsigned int id;
+		if (std::sscanf(file.path().filename().string().c_str(), "segment-%u.log", &id) == 1) ids.push_back(id);
+	}
+	if (error)
+	{
+		std::cerr << "Could not read the response cache directory " << this->_options.directory << ": " << error.message() << std::endl;
+		return false;
+	}
+
+	// Later segments replace the entries of earlier ones, so they have to be replayed in order
+	std::sort(ids.begin(), ids.end());
+	for (uint32_t id : ids)
+	{
+		if (!this->load_segment(id)) return false;
+	}
+
+	return this->open_active_segment(ids.empty() ? 1 : ids.back());
+}
+
+bool response_cache_t::load_segment(uint32_t id)
+{
+	std::filesystem::path path = this->segment_path(id);
+	std::FILE *file = std::fopen(path.string().c_str(), "rb");
+	if (!file)
+	{
+		std::cerr << "Could not open response cache segment " << path << std::endl;
+		return false;
+	}
+
+	std::error_code error;
+	uint64_t file_size = std::filesystem::file_size(path, error);
+	std::string data;
+	if (error || !read_file(file, 0, file_size, data))
+	{
+		std::cerr << "Could not read response cache segment " << path << std::endl;
+		std::fclose(file);
+		return false;
+	}
+
+	segment_t &segment = this->_segments[id];
+	segment.file = file;
+
+	int64_t current_time = now();
+	uint64_t offset = 0;
+	record_header_t header;
+	while (size_t record_size = parse_record(data.data() + offset, data.size() - offset, header))
+	{
+		std::string key(data.data() + offset + sizeof(header), header.key_size);
+
+		auto existing = this->_entries.find(key);
+		if (existing != this->_entries.end()) this->remove(existing, false);
+
+		if (!(header.flags & tombstone_flag) && header.expires_at > current_time)
+		{
+			this->_recency.push_front(key);
+			this->_entries.emplace(std::move(key), entry_t{id, offset, static_cast<uint32_t>(record_size), header.expires_at, this->_recency.begin()});
+			segment.live_bytes += record_size;
+			this->_live_bytes += record_size;
+		}
+
+		offset += record_size;
+	}
+
+	// Anything after the last valid record was being written when the process stopped
+	if (offset < data.size())
+	{
+		std::cerr << "Dropping " << (data.size() - offset) << " damaged bytes from response cache segment " << path << std::endl;
+		std::fclose(file);
+		std::filesystem::resize_file(path, offset, error);
+		segment.file = std::fopen(path.string().c_str(), "rb");
+		if (error || !segment.file) return false;
+	}
+
+	segment.size = offset;
+	this->_disk_bytes += offset;
+	return true;
+}
+
+bool response_cache_t::open_active_segment(uint32_t id)
+{
+	segment_t &segment = this->_segments[id];
+	if (segment.file) std::fclose(segment.file);
+
+	// Appending always writes at the end of the file, whatever position the reads left it at
+	segment.file = std::fopen(this->segment_path(id).string().c_str(), "a+b");
+	if (!segment.file)
+	{
+		std::cerr << "Could not open response cache segment " << this->segment_path(id) << std::endl;
+		this->_segments.erase(id);
+		return false;
+	}
+
+	this->_active = id;
+	return true;
+}
+
+std::string response_cache_t::normalize_key(const std::string &url, const std::string &query_data)
+{
+	auto [path, url_query] = split_url(url);
+
+	std::vector<std::string_view> parameters;
+	split_parameters(url_query, parameters);
+	split_parameters(query_data, parameters);
+	std::sort(parameters.begin(), parameters.end());
+
+	std::string key(path);
+	for (size_t i = 0; i < parameters.size(); i++)
+	{
+		key += (i == 0) ? '?' : '&';
+		key += parameters[i];
+	}
+	return key;
+}
+
+bool response_cache_t::is_user_specific(const std::string &url, const std::string &query_data)
+{
+	std::vector<std::string_view> parameters;
+	split_parameters(split_url(url).second, parameters);
+	split_parameters(query_data, parameters);
+
+	for (std::string_view parameter : parameters)
+	{
+		if (!parameter.starts_with("market=")) continue;
+		std::string_view market = parameter.substr(7);
+		if (!market.empty() && spotify_api::markets::index_of(market) < 0) return true;
+	}
+	return false;
+}
+
+std::chrono::seconds response_cache_t::ttl_for(const std::string &url) const
+{
+	std::string_view path = split_url(url).first;
+	if (path.starts_with("/v1/")) path.remove_prefix(3);
+
+	size_t best_length = 0;
+	std::chrono::seconds ttl(0);
+	for (const auto &[prefix, prefix_ttl] : this->_options.ttls)
+	{
+		if (!path.starts_with(prefix) || prefix.size() < best_length) continue;
+		if (path.size() != prefix.size() && path[prefix.size()] != '/') continue;
+
+		best_length = prefix.size();
+		ttl = prefix_ttl;
+	}
+	return ttl;
+}
+
+std::optional<std::string> response_cache_t::get(const std::string &key)
+{
+	std::string record;
+	uint32_t raw_size;
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+
+		auto entry = this->_entries.find(key);
+		if (entry == this->_entries.end()) return std::nullopt;
+
+		// Expired records are skipped when the segment is replayed, so they need no tombstone
+		if (entry->second.expires_at <= now())
+		{
+			this->remove(entry, false);
+			return std::nullopt;
+		}
+
+		record_header_t header;
+		std::FILE *file = this->_segments[entry->second.segment].file;
+		if (!read_file(file, entry->second.offset, entry->second.record_size, record) || !parse_record(record.data(), record.size(), header))
+		{
+			std::cerr << "Response cache entry " << key << " is damaged" << std::endl;
+			this->remove(entry, true);
+			return std::nullopt;
+		}
+		raw_size = header.raw_size;
+
+		this->_recency.splice(this->_recency.begin(), this->_recency, entry->second.position);
+	}
+
+	// Decompress outside the lock
+	std::string body(raw_size, '\0');
+	uLongf body_size = raw_size;
+	size_t value_offset = sizeof(record_header_t) + key.size();
+	if (uncompress(reinterpret_cast<Bytef *>(body.data()), &body_size, reinterpret_cast<const Bytef *>(record.data() + value_offset), record.size() - value_offset) != Z_OK
+		|| body_size != raw_size)
+	{
+		std::cerr << "Could not decompress response cache entry " << key << std::endl;
+		return std::nullopt;
+	}
+	return body;
+}
+
+void response_cache_t::put(const std::string &key, const std::string &body, std::chrono::seconds ttl)
+{
+	if (ttl.count() <= 0) return;
+
+	// Compress outside the lock
+	uLongf compressed_size = compressBound(body.size());
+	std::string compressed(compressed_size, '\0');
+	if (compress2(reinterpret_cast<Bytef *>(compressed.data()), &compressed_size, reinterpret_cast<const Bytef *>(body.data()), body.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+	{
+		std::cerr << "Could not compress response cache entry " << key << std::endl;
+		return;
+	}
+	compressed.resize(compressed_size);
+
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	auto existing = this->_entries.find(key);
+	if (existing != this->_entries.end()) this->remove(existing, false);
+
+	int64_t expires_at = now() + ttl.count();
+	std::string record = make_record(key, compressed, static_cast<uint32_t>(body.size()), expires_at, 0);
+	if (!this->append(record)) return;
+
+	// Appending may have started a new segment, so the position is only known afterwards
+	segment_t &segment = this->_segments[this->_active];
+	this->_recency.push_front(key);
+	this->_entries.emplace(key, entry_t{this->_active, segment.size - record.size(), static_cast<uint32_t>(record.size()), expires_at, this->_recency.begin()});
+	segment.live_bytes += record.size();
+	this->_live_bytes += record.size();
+
+	this->evict();
+	if (this->needs_compaction()) this->_compaction_signal.notify_one();
+}
+
+void response_cache_t::erase(const std::string &key)
+{
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	auto entry = this->_entries.find(key);
+	if (entry != this->_entries.end()) this->remove(entry, true);
+}
+
+bool response_cache_t::append(const std::string &record)
+{
+	// Start a new segment when the active one is full
+	if (this->_segments[this->_active].size > 0 && this->_segments[this->_active].size + record.size() > this->_options.segment_bytes)
+	{
+		if (!this->open_active_segment(this->_active + 1)) return false;
+	}
+
+	segment_t &segment = this->_segments[this->_active];
+	// get() may have read from this file last, and a write may only follow a read after a call that positions the stream
+	if (std::fseek(segment.file, 0, SEEK_END) != 0 || std::fwrite(record.data(), 1, record.size(), segment.file) != record.size()
+		|| std::fflush(segment.file) != 0)
+	{
+		std::cerr << "Could not write to response cache segment " << this->segment_path(this->_active) << std::endl;
+		return false;
+	}
+
+	segment.size += record.size();
+	this->_disk_bytes += record.size();
+	return true;
+}
+
+void response_cache_t::remove(std::unordered_map<std::string, entry_t>::iterator entry, bool write_tombstone)
+{
+	this->_segments[entry->second.segment].live_bytes -= entry->second.record_size;
+	this->_live_bytes -= entry->second.record_size;
+	this->_recency.erase(entry->second.position);
+
+	if (write_tombstone) this->append(make_record(entry->first, std::string(), 0, 0, tombstone_flag));
+	this->_entries.erase(entry);
+}
+
+void response_cache_t::evict()
+{
+	while (this->_live_bytes > this->_options.max_bytes && !this->_recency.empty())
+	{
+		this->remove(this->_entries.find(this->_recency.back()), true);
+	}
+}
+
+bool response_cache_t::needs_compaction() const
+{
+	if (this->_segments.size() < 2) return false;
+	return this->_disk_bytes - this->_live_bytes > this->_options.compaction_ratio * this->_disk_bytes;
+}
+
+bool response_cache_t::compact_oldest(std::unique_lock<std::mutex> &lock)
+{
+	auto oldest = this->_segments.begin();
+	if (oldest == this->_segments.end() || oldest->first == this->_active) return false;
+
+	uint32_t id = oldest->first;
+	segment_t &segment = oldest->second;
+
+	// The segment is read through its own handle without the lock, so requests are not held up for the whole read.
+	// Only the active segment is written to, and only compaction removes segments, so it stays as it is meanwhile.
+	std::string data;
+	if (segment.live_bytes > 0)
+	{
+		uint64_t size = segment.size;
+		lock.unlock();
+		std::FILE *file = std::fopen(this->segment_path(id).string().c_str(), "rb");
+		bool read = file && read_file(file, 0, size, data);
+		if (file) std::fclose(file);
+		lock.lock();
+
+		if (!read)
+		{
+			std::cerr << "Could not read response cache segment " << this->segment_path(id) << std::endl;
+			return false;
+		}
+	}
+
+	// Copy the records that are still live to the active segment. Tombstones are dropped:
+	// every record they could hide is in this segment or in an older one that is already gone.
+	// The lock is released after every chunk, so requests can go in between.
+	int64_t current_time = now();
+	uint64_t offset = 0;
+	uint64_t chunk = 0;
+	record_header_t header;
+	while (size_t record_size = parse_record(data.data() + offset, data.size() - offset, header))
+	{
+		// Entries that were replaced or removed while the lock was released no longer point to this record
+		auto entry = this->_entries.find(std::string(data.data() + offset + sizeof(header), header.key_size));
+		if (entry != this->_entries.end() && entry->second.segment == id && entry->second.offset == offset)
+		{
+			if (entry->second.expires_at <= current_time)
+			{
+				this->remove(entry, false);
+			}
+			else
+			{
+				std::string record = data.substr(offset, record_size);
+				if (!this->append(record)) return false;
+
+				entry->second.segment = this->_active;
+				entry->second.offset = this->_segments[this->_active].size - record_size;
+				this->_segments[this->_active].live_bytes += record_size;
+				segment.live_bytes -= record_size;
+				chunk += record_size;
+			}
+		}
+		offset += record_size;
+
+		if (chunk >= compaction_chunk_bytes)
+		{
+			chunk = 0;
+			lock.unlock();
+			std::this_thread::yield();
+			lock.lock();
+			// The records that were not copied yet stay where they are, so stopping here loses nothing
+			if (this->_stopping) return false;
+		}
+	}
+
+	// Once the segment is gone, the tombstones for its records are dropped when newer segments are compacted.
+	// If the file stayed, the next load would bring those records back, so the segment is kept until it can be deleted.
+	std::fclose(segment.file);
+	std::error_code error;
+	std::filesystem::remove(this->segment_path(id), error);
+	if (error)
+	{
+		std::cerr << "Could not delete response cache segment " << this->segment_path(id) << ": " << error.message() << std::endl;
+		segment.file = std::fopen(this->segment_path(id).string().c_str(), "rb");
+		return false;
+	}
+
+	this->_disk_bytes -= segment.size;
+	this->_segments.erase(id);
+	return true;
+}
+
+void response_cache_t::compact()
+{
+	std::lock_guard<std::mutex> compaction_lock(this->_compaction_mutex);
+	std::unique_lock<std::mutex> lock(this->_mutex);
+
+	// Segments started while compacting only hold records copied from older ones
+	uint32_t last = this->_active;
+	while (!this->_segments.empty() && this->_segments.begin()->first < last && this->compact_oldest(lock)) {}
+}
+
+void response_cache_t::compaction_loop()
+{
+	std::unique_lock<std::mutex> lock(this->_mutex);
+	while (true)
+	{
+		this->_compaction_signal.wait(lock, [this] { return this->_stopping || this->needs_compaction(); });
+		if (this->_stopping) return;
+
+		// One segment at a time. The compaction mutex is taken first, in the same order as compact().
+		bool compacted;
+		lock.unlock();
+		{
+			std::lock_guard<std::mutex> compaction_lock(this->_compaction_mutex);
+			lock.lock();
+			compacted = !this->_stopping && this->needs_compaction() && this->compact_oldest(lock);
+		}
+		if (this->_stopping) return;
+
+		if (!compacted)
+		{
+			this->_compaction_signal.wait_for(lock, std::chrono::seconds(10), [this] { return this->_stopping; });
+			continue;
+		}
+		lock.unlock();
+		std::this_thread::yield();
+		lock.lock();
+	}
+}
+
+size_t response_cache_t::size() const
+{
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	return this->_entries.size();
+}
+
+uint64_t response_cache_t::live_bytes() const
+{
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	return this->_live_bytes;
+}
+
+uint64_t response_cache_t::disk_bytes() const
+{
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	return this->_disk_bytes;
+}
+
+} // namespace http
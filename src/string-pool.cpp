@@ -0,0 +1,64 @@
+#include "string-pool.hpp"
+
+#include <mutex>
+
+namespace json = nlohmann;
+
+namespace spotify_api
+{
+
+// A function-local static avoids depending on static initialization order
+// when handles are default constructed during the initialization of other globals.
+static const std::string *empty_string()
+{
+	static const std::string value;
+	return &value;
+}
+
+interned_string_t::interned_string_t(): _value(empty_string()) {}
+
+interned_string_t interned_string_t::from_json(const json::json &json_value)
+{
+	if (!json_value.is_string()) return interned_string_t();
+	return intern(json_value.get_ref<const std::string &>());
+}
+
+string_pool_t &string_pool_t::global()
+{
+	static string_pool_t pool;
+	return pool;
+}
+
+interned_string_t string_pool_t::intern(std::string_view value)
+{
+	if (value.empty()) return interned_string_t();
+
+	size_t hash = transparent_hash{}(value);
+	// The low bits pick the bucket inside a shard, so use the high bits to pick the shard.
+	shard_t &shard = this->_shards[(hash >> (sizeof(size_t) * 4)) % shard_count];
+
+	{
+		std::shared_lock<std::shared_mutex> read_lock(shard.mutex);
+		auto found = shard.strings.find(value);
+		if (found != shard.strings.end()) return interned_string_t(&*found);
+	}
+
+	// Another thread may have added the string between releasing the shared lock and getting this one,
+	// in which case emplace() returns the existing element.
+	std::unique_lock<std::shared_mutex> write_lock(shard.mutex);
+	auto inserted = shard.strings.emplace(value);
+	return interned_string_t(&*inserted.first);
+}
+
+size_t string_pool_t::size() const
+{
+	size_t total = 0;
+	for (const shard_t &shard : this->_shards)
+	{
+		std::shared_lock<std::shared_mutex> read_lock(shard.mutex);
+		total += shard.strings.size();
+	}
+	return total;
+}
+
+} // namespace spotify_api